@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from "react";
+import React, { useState, useEffect, useRef } from "react";
 import { useNavigate, useLocation } from "react-router-dom";
 import mqtt from "mqtt";
 
@@ -24,8 +24,12 @@ import {
 } from "./cadastro.styles";
 
 const MQTT_URL = "ws://172.20.10.2:9001"; // porta de WebSocket do broker
-const TOPIC_CMD = "portaria/comandos";
-const TOPIC_STATUS = "portaria/status";
+// id fixo da portaria deste painel (PORTARIA_ID no firmware). Vazio: escolhe
+// na tela entre as que têm portaria/<id>/estado/hoje (retida). O cadastro
+// nunca vai para portaria/comandos: todas as portarias entrariam em cadastro.
+const PORTARIA_FIXA = "";
+const TOPIC_STATUS = "portaria/+/status";
+const TOPIC_ESTADO_HOJE = "portaria/+/estado/hoje";
 
 export default function Cadastrar() {
   const navigate = useNavigate();
@@ -36,6 +40,17 @@ export default function Cadastrar() {
   const [mode, setMode] = useState(null); // 'parent' | 'employee'
   const [status, setStatus] = useState("idle"); // 'idle' | 'waiting' | 'success' | 'error' | 'exists'
   const [client, setClient] = useState(null);
+  const [portarias, setPortarias] = useState(PORTARIA_FIXA ? [PORTARIA_FIXA] : []);
+  const [portaria, setPortaria] = useState(
+    PORTARIA_FIXA || localStorage.getItem("portaria") || ""
+  );
+  const portariaRef = useRef(portaria);
+
+  // a escolha vale para as telas de entrada e saída também
+  useEffect(() => {
+    portariaRef.current = portaria;
+    if (!PORTARIA_FIXA && portaria) localStorage.setItem("portaria", portaria);
+  }, [portaria]);
 
   const goHome = () => navigate("/");
   const goCadastro = () => navigate("/cadastro");
@@ -52,10 +67,21 @@ export default function Cadastrar() {
     c.on("connect", () => {
       console.log("MQTT conectado no front");
       c.subscribe(TOPIC_STATUS);
+      if (!PORTARIA_FIXA) c.subscribe(TOPIC_ESTADO_HOJE);
     });
 
     c.on("message", (topic, payload) => {
-      if (topic !== TOPIC_STATUS) return;
+      const partes = topic.split("/");
+      if (partes[2] === "estado") {
+        if (payload.length) {
+          setPortarias((prev) =>
+            prev.includes(partes[1]) ? prev : [...prev, partes[1]].sort()
+          );
+        }
+        return;
+      }
+      // status de outra portaria não é deste painel
+      if (partes[2] !== "status" || partes[1] !== portariaRef.current) return;
       try {
         const msg = JSON.parse(payload.toString());
         console.log("STATUS MQTT:", msg);
@@ -92,7 +118,17 @@ export default function Cadastrar() {
     };
   }, []);
 
+  function selectPortaria(id) {
+    setPortaria(id);
+    setMode(null);
+    setStatus("idle");
+  }
+
   function selectMode(nextMode) {
+    if (!portaria) {
+      setStatus("no_gate");
+      return;
+    }
     setMode(nextMode);
     setStatus("waiting");
 
@@ -101,7 +137,7 @@ export default function Cadastrar() {
         cmd: "start_register",
         tipo: nextMode,
       });
-      client.publish(TOPIC_CMD, payload);
+      client.publish(`portaria/${portaria}/comandos`, payload);
       console.log("Comando de cadastro enviado:", payload);
     } else {
       console.warn("MQTT ainda não conectado no front");
@@ -115,12 +151,17 @@ export default function Cadastrar() {
 
     const statusTextByStatus = {
     idle: "Selecione uma opção para iniciar o cadastro.",
+    no_gate: "Escolha a portaria antes de iniciar o cadastro.",
     waiting: mode ? labelByMode[mode] : "Aguardando cartão...",
     success: "Usuário cadastrado com sucesso!",
     exists: "Usuário já cadastrado.",              // 👈 NOVO
     error: "Falha no cadastro. Tente aproximar novamente.",
   };
 
+  // a salva pode ainda não ter chegado pela retida
+  const opcoesPortaria =
+    portaria && !portarias.includes(portaria) ? [portaria, ...portarias] : portarias;
+
   return (
     <PageWrapper>
       <Card>
@@ -160,6 +201,20 @@ export default function Cadastrar() {
           Escolha o tipo de cadastro e aproxime o cartão do leitor.
         </Subtitle>
 
+        {!PORTARIA_FIXA && (
+          <div style={{ marginBottom: "16px", display: "flex", gap: 8, alignItems: "center", justifyContent: "center" }}>
+            <span>Portaria:</span>
+            <select value={portaria} onChange={(e) => selectPortaria(e.target.value)}>
+              <option value="">-- escolha a portaria --</option>
+              {opcoesPortaria.map((id) => (
+                <option key={id} value={id}>
+                  {id}
+                </option>
+              ))}
+            </select>
+          </div>
+        )}
+
         <OptionsRow>
           <OptionButton
             active={mode === "parent"}
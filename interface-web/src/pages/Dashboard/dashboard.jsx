@@ -37,6 +37,17 @@ import {
 
 const MQTT_URL = "ws://172.20.10.2:9001";
 
+// Histórico vem do agregador (src/agregador), que junta todas as portarias;
+// as consultas por UID vão para todas e as respostas se somam.
+const TOPIC_MOV = "agregador/movimentacoes";
+const TOPIC_CMD_AGREGADOR = "agregador/comandos";
+// Contadores de hoje, quem está dentro e as últimas movimentações: mensagens
+// retidas de cada portaria, entregues pelo broker assim que assina (nenhum
+// pedido à portaria). portaria/<id>/estado/{hoje,dentro/<uid>,ultimos/<k>}
+const TOPIC_ESTADO = "portaria/+/estado/#";
+const TOPIC_CMD_PORTARIAS = "portaria/comandos";
+const TOPIC_STATUS = "portaria/+/status";
+
 const diasOrdem = ["Seg", "Ter", "Qua", "Qui", "Sex"];
 const mapDowToLabel = {
   1: "Seg",
@@ -51,6 +62,12 @@ function parseDateBR(dateStr) {
   return new Date(y, m - 1, d);
 }
 
+// "dd/mm/aaaa" + "hh:mm:ss" -> chave que ordena como texto
+function chaveMov(m) {
+  const [d, mes, a] = (m.data || "").split("/");
+  return `${a}${mes}${d} ${m.hora || ""} ${String(m.offset || 0).padStart(10, "0")}`;
+}
+
 // Mapeia o nome completo que o ESP envia ("Segunda-feira") para rótulo curto ("Seg")
 const mapNomeCompletoToShort = {
   "Domingo": "Dom",
@@ -65,7 +82,9 @@ const mapNomeCompletoToShort = {
 export default function Dashboard() {
   const navigate = useNavigate();
   const location = useLocation();
-  const [insideList, setInsideList] = useState([]);
+  const [estadoHoje, setEstadoHoje] = useState({});       // portaria -> {data, entradas, saidas, dentro}
+  const [estadoDentro, setEstadoDentro] = useState({});   // "portaria/uid" -> {uid, count, data}
+  const [estadoUltimos, setEstadoUltimos] = useState({}); // "portaria/k" -> movimentação
 
   const [movs, setMovs] = useState([]);              // histórico de movimentações
   const [uidOptions, setUidOptions] = useState([]);  // UIDs disponíveis para o select
@@ -89,38 +108,50 @@ export default function Dashboard() {
 
     client.on("connect", () => {
       console.log("MQTT conectado no FRONT!");
-      client.subscribe("portaria/movimentacoes");
-      client.subscribe("portaria/dentro");
-      client.subscribe("portaria/status"); // 👈 para receber uid_week_days
+      client.subscribe(TOPIC_MOV);
+      client.subscribe(TOPIC_ESTADO);
+      client.subscribe(TOPIC_STATUS); // 👈 para receber uid_week_days
 
-      // pedir histórico de movimentações
+      // pedir histórico de movimentações (todas as portarias, em ordem)
       client.publish(
-        "portaria/comandos",
+        TOPIC_CMD_AGREGADOR,
         JSON.stringify({ cmd: "get_history" })
       );
-
-      // pedir lista de quem está dentro hoje (equivalente ao 'p')
-      client.publish(
-        "portaria/comandos",
-        JSON.stringify({ cmd: "get_inside_today" })
-      );
     });
 
+    // Retida vazia = apagada (UID saiu, posição sem movimentação)
+    const atualizar = (setter, chave, valor) =>
+      setter((prev) => {
+        const novo = { ...prev };
+        if (valor) novo[chave] = valor;
+        else delete novo[chave];
+        return novo;
+      });
+
     client.on("message", (topic, msg) => {
       try {
+        const partes = topic.split("/");
+        if (partes[0] === "portaria" && partes[2] === "estado") {
+          const portaria = partes[1];
+          const valor = msg.length ? JSON.parse(msg.toString()) : null;
+          if (partes[3] === "hoje") atualizar(setEstadoHoje, portaria, valor);
+          else if (partes[3] === "dentro") atualizar(setEstadoDentro, `${portaria}/${partes[4]}`, valor);
+          else if (partes[3] === "ultimos") atualizar(setEstadoUltimos, `${portaria}/${partes[4]}`, valor);
+          return;
+        }
+
         const data = JSON.parse(msg.toString());
         console.log("MQTT msg:", topic, data);
 
-        if (topic === "portaria/movimentacoes") {
+        if (topic === TOPIC_MOV) {
           setMovs((prev) => [...prev, data]);
-        } else if (topic === "portaria/dentro") {
-          // payload: { context: "inside", total: X, itens: [ { uid, count }, ... ] }
-          setInsideList(data.itens || []);
-        } else if (topic === "portaria/status") {
+        } else if (topic.endsWith("/status")) {
           // Aqui podem vir vários contexts diferentes. Queremos o "uid_week_days".
           if (data.context === "uid_week_days") {
-            // data: { context, uid, totalDias, dias: [ "Segunda-feira", ... ] }
-            setUidWeekDays(data.dias || []);
+            // data: { context, uid, totalDias, dias: [ "Segunda-feira", ... ] }, uma por portaria
+            setUidWeekDays((prev) =>
+              Array.from(new Set([...prev, ...(data.dias || [])]))
+            );
           }
         }
       } catch (e) {
@@ -165,7 +196,8 @@ export default function Dashboard() {
 
     console.log("Publicando get_uid_week_days:", payload);
 
-    client.publish("portaria/comandos", JSON.stringify(payload));
+    setUidWeekDays([]);
+    client.publish(TOPIC_CMD_PORTARIAS, JSON.stringify(payload));
   }, [selectedUid]);
 
   // 📊 Transformar movimentações em dados pros gráficos (geral, não por UID)
@@ -220,10 +252,37 @@ export default function Dashboard() {
     }));
   }, [uidWeekDays]);
 
-  // últimos 10 registros (mais recentes em cima)
+  // Quem está dentro, somando as portarias; um UID retido de outro dia é sobra
+  const insideList = useMemo(() => {
+    const porUid = {};
+    Object.entries(estadoDentro).forEach(([chave, item]) => {
+      const portaria = chave.split("/")[0];
+      const hoje = estadoHoje[portaria];
+      if (!hoje || item.data !== hoje.data) return;
+      porUid[item.uid] = (porUid[item.uid] || 0) + item.count;
+    });
+    return Object.entries(porUid).map(([uid, count]) => ({ uid, count }));
+  }, [estadoDentro, estadoHoje]);
+
+  const totaisHoje = useMemo(() => {
+    const t = { entradas: 0, saidas: 0 };
+    Object.values(estadoHoje).forEach((h) => {
+      t.entradas += h.entradas || 0;
+      t.saidas += h.saidas || 0;
+    });
+    return t;
+  }, [estadoHoje]);
+
+  // últimos 10 registros (mais recentes em cima): retidas + ao vivo, sem repetir
   const movsRecentes = useMemo(() => {
-    return [...movs].slice(-10).reverse();
-  }, [movs]);
+    const unicas = {};
+    [...Object.values(estadoUltimos), ...movs.slice(-10)].forEach((m) => {
+      unicas[`${m.portaria}/${m.offset}`] = m;
+    });
+    return Object.values(unicas)
+      .sort((a, b) => (chaveMov(a) < chaveMov(b) ? 1 : -1))
+      .slice(0, 10);
+  }, [estadoUltimos, movs]);
 
   return (
     <PageWrapper>
@@ -285,7 +344,9 @@ export default function Dashboard() {
           {/* Log de quem está dentro hoje */}
           <ChartCard>
             <ChartTitle>Quem está dentro da escola</ChartTitle>
-            <ChartSubtitle>Baseado nas movimentações de hoje</ChartSubtitle>
+            <ChartSubtitle>
+              Hoje: {totaisHoje.entradas} entradas, {totaisHoje.saidas} saídas
+            </ChartSubtitle>
 
             <ChartArea>
               <LogList>
@@ -334,6 +395,12 @@ export default function Dashboard() {
                         <span>{m.data}</span>
                         <span> • </span>
                         <span>{m.hora}</span>
+                        {m.portaria && (
+                          <>
+                            <span> • </span>
+                            <span>{m.portaria}</span>
+                          </>
+                        )}
                       </LogMeta>
                     </LogRow>
                   ))
@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from "react";
+import React, { useState, useEffect, useRef } from "react";
 import { useNavigate, useLocation } from "react-router-dom";
 import mqtt from "mqtt";
 
@@ -28,8 +28,12 @@ import {
 } from "./entrada.styles";
 
 const MQTT_URL = "ws://172.20.10.2:9001";
-const TOPIC_CMD = "portaria/comandos";
-const TOPIC_STATUS = "portaria/status";
+// id fixo da portaria deste painel (PORTARIA_ID no firmware). Vazio: escolhe
+// na tela entre as que têm portaria/<id>/estado/hoje (retida). O start_entrada
+// nunca vai para portaria/comandos: todas as portarias abririam o fluxo.
+const PORTARIA_FIXA = "";
+const TOPIC_STATUS = "portaria/+/status";
+const TOPIC_ESTADO_HOJE = "portaria/+/estado/hoje";
 
 export default function Entrada() {
   const navigate = useNavigate();
@@ -41,6 +45,17 @@ export default function Entrada() {
   const [parentStatus, setParentStatus] = useState("waiting");
   const [employeeStatus, setEmployeeStatus] = useState("idle");
   const [client, setClient] = useState(null);
+  const [conectado, setConectado] = useState(false);
+  const [portarias, setPortarias] = useState(PORTARIA_FIXA ? [PORTARIA_FIXA] : []);
+  const [portaria, setPortaria] = useState(
+    PORTARIA_FIXA || localStorage.getItem("portaria") || ""
+  );
+  const portariaRef = useRef(portaria);
+
+  useEffect(() => {
+    portariaRef.current = portaria;
+    if (!PORTARIA_FIXA && portaria) localStorage.setItem("portaria", portaria);
+  }, [portaria]);
 
   useEffect(() => {
     const c = mqtt.connect(MQTT_URL, {
@@ -49,31 +64,43 @@ export default function Entrada() {
 
     setClient(c);
 
+    // último (boot, seq) de status por portaria (tópico)
+    const ultimoSeq = {};
+
     c.on("connect", () => {
       console.log("MQTT conectado (entrada)");
       c.subscribe(TOPIC_STATUS);
-
-      const payload = JSON.stringify({
-        cmd: "start_entrada",
-      });
-      c.publish(TOPIC_CMD, payload);
-      console.log("Comando start_entrada enviado:", payload);
+      if (!PORTARIA_FIXA) c.subscribe(TOPIC_ESTADO_HOJE);
+      setConectado(true);
     });
 
+    c.on("close", () => setConectado(false));
+
     c.on("message", (topic, payload) => {
-      if (topic !== TOPIC_STATUS) return;
+      const partes = topic.split("/");
+      if (partes[2] === "estado") {
+        if (payload.length) {
+          setPortarias((prev) =>
+            prev.includes(partes[1]) ? prev : [...prev, partes[1]].sort()
+          );
+        }
+        return;
+      }
+      // status de outra portaria não é deste painel
+      if (partes[2] !== "status" || partes[1] !== portariaRef.current) return;
       try {
         const msg = JSON.parse(payload.toString());
         console.log("STATUS MQTT ENTRADA:", msg);
 
         if (msg.context !== "entrada") return;
 
-        if (msg.step === "parent" && msg.status) {
-          setParentStatus(msg.status);
-        }
-        if (msg.step === "employee" && msg.status) {
-          setEmployeeStatus(msg.status);
-        }
+        // cada mensagem traz as duas etapas; mesmo (boot, seq) = mensagem
+        // repetida. O seq recomeça a cada boot, o "boot" não se repete.
+        const chave = `${msg.boot}:${msg.seq}`;
+        if (ultimoSeq[topic] === chave) return;
+        ultimoSeq[topic] = chave;
+        if (msg.parent) setParentStatus(msg.parent);
+        if (msg.employee) setEmployeeStatus(msg.employee);
       } catch (e) {
         console.error("Erro ao parsear STATUS entrada:", e);
       }
@@ -85,6 +112,27 @@ export default function Entrada() {
     };
   }, []);
 
+  // abre o fluxo na portaria escolhida a cada (re)conexão ou troca; sem
+  // portaria não manda nada
+  useEffect(() => {
+    if (!client || !conectado || !portaria) return;
+    const payload = JSON.stringify({
+      cmd: "start_entrada",
+    });
+    client.publish(`portaria/${portaria}/comandos`, payload);
+    console.log("Comando start_entrada enviado:", payload);
+  }, [client, conectado, portaria]);
+
+  function selectPortaria(id) {
+    setPortaria(id);
+    setParentStatus("waiting");
+    setEmployeeStatus("idle");
+  }
+
+  // a salva pode ainda não ter chegado pela retida
+  const opcoesPortaria =
+    portaria && !portarias.includes(portaria) ? [portaria, ...portarias] : portarias;
+
   const goHome = () => navigate("/");
   const goCadastro = () => navigate("/cadastro");
   const goDashboard = () => navigate("/dashboard");
@@ -150,6 +198,20 @@ export default function Entrada() {
           na escola.
         </Subtitle>
 
+        {!PORTARIA_FIXA && (
+          <div style={{ marginBottom: "16px", display: "flex", gap: 8, alignItems: "center", justifyContent: "center" }}>
+            <span>Portaria:</span>
+            <select value={portaria} onChange={(e) => selectPortaria(e.target.value)}>
+              <option value="">-- escolha a portaria --</option>
+              {opcoesPortaria.map((id) => (
+                <option key={id} value={id}>
+                  {id}
+                </option>
+              ))}
+            </select>
+          </div>
+        )}
+
         <StepsGrid>
           {/* Etapa 1 – Responsável */}
           <StepCard>
@@ -194,6 +256,8 @@ export default function Entrada() {
           <GlobalStatusText>
             {allOk
               ? "Responsável e funcionário confirmados. Entrada autorizada."
+              : !portaria
+              ? "Escolha a portaria para iniciar a entrada."
               : "Conclua as duas etapas para liberar a entrada."}
           </GlobalStatusText>
         </GlobalStatusArea>
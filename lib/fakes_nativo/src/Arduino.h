@@ -0,0 +1,48 @@
+// Núcleo Arduino mínimo para compilar a portaria no PC (env:native).
+// millis()/delay() usam o relógio virtual de relogio_fake.h, então delay()
+// não dorme de verdade: só avança o tempo.
+#pragma once
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "Esp.h"
+#include "HardwareSerial.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH   0x1
+#define LOW    0x0
+#define INPUT  0x01
+#define OUTPUT 0x03
+
+#define F(s) (s)
+#define PROGMEM
+
+class __FlashStringHelper;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// RNG do ESP32 (esp_random.h); no PC, std::random_device: outro valor a cada execução
+uint32_t esp_random();
+
+void pinMode(uint8_t pino, uint8_t modo);
+void digitalWrite(uint8_t pino, uint8_t valor);
+int  digitalRead(uint8_t pino);
+
+// esp32-hal-time
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char *server1, const char *server2 = nullptr,
+                const char *server3 = nullptr);
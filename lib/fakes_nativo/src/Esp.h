@@ -0,0 +1,26 @@
+// ESP.getFreeHeap() e companhia no PC. Não há heap de verdade para medir:
+// os valores são os definidos por definirHeap() (padrão: 300 KB livres).
+#pragma once
+
+#include <cstdint>
+
+class EspClass {
+public:
+  uint32_t getHeapSize()     { return heapTotal; }
+  uint32_t getFreeHeap()     { return heapLivre; }
+  uint32_t getMinFreeHeap()  { return heapMinimo; }
+  uint32_t getMaxAllocHeap() { return heapMaiorBloco; }
+  uint64_t getEfuseMac()     { return efuseMac; }
+
+  // Extras do PC
+  void definirHeap(uint32_t livre, uint32_t maiorBloco);
+
+private:
+  uint32_t heapTotal      = 327680;
+  uint32_t heapLivre      = 300000;
+  uint32_t heapMinimo     = 300000;
+  uint32_t heapMaiorBloco = 110580;
+  uint64_t efuseMac       = 0x010000C40A24ULL;   // 24:0a:c4:00:00:01
+};
+
+extern EspClass ESP;
@@ -0,0 +1,251 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include "SPIFFS.h"
+#include "relogio_fake.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+SPIFFSFS   SPIFFS;
+LittleFSFS LittleFS;
+
+namespace fs {
+
+struct FileImpl {
+  FILE       *fp = nullptr;
+  std::string path;
+  bool        diretorio = false;
+  std::string dirHost;
+  std::vector<std::string> entradas;
+  size_t      proxEntrada = 0;
+  FS         *dono = nullptr;
+
+  ~FileImpl() { if (fp) fclose(fp); }
+};
+
+size_t File::write(uint8_t c) {
+  if (!impl || !impl->fp || fputc(c, impl->fp) == EOF) return 0;
+  impl->dono->cobrarBytes(1);
+  return 1;
+}
+
+size_t File::write(const uint8_t *buf, size_t n) {
+  if (!impl || !impl->fp) return 0;
+  size_t k = fwrite(buf, 1, n, impl->fp);
+  impl->dono->cobrarBytes(k);
+  return k;
+}
+
+int File::available() {
+  if (!impl || !impl->fp) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  if (!impl || !impl->fp) return -1;
+  int c = fgetc(impl->fp);
+  if (c != EOF) impl->dono->cobrarBytes(1);
+  return c;
+}
+
+size_t File::read(uint8_t *buf, size_t n) {
+  if (!impl || !impl->fp) return 0;
+  size_t k = fread(buf, 1, n, impl->fp);
+  impl->dono->cobrarBytes(k);
+  return k;
+}
+
+int File::peek() {
+  if (!impl || !impl->fp) return -1;
+  int c = fgetc(impl->fp);
+  if (c != EOF) ungetc(c, impl->fp);
+  return c;
+}
+
+void File::flush() {
+  if (impl && impl->fp) fflush(impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode modo) {
+  if (!impl || !impl->fp) return false;
+  int w = (modo == SeekSet) ? SEEK_SET : (modo == SeekCur) ? SEEK_CUR : SEEK_END;
+  return fseek(impl->fp, (long)pos, w) == 0;
+}
+
+size_t File::position() const {
+  return (impl && impl->fp) ? (size_t)ftell(impl->fp) : 0;
+}
+
+size_t File::size() const {
+  if (!impl || !impl->fp) return 0;
+  struct stat st;
+  fflush(impl->fp);
+  if (fstat(fileno(impl->fp), &st) != 0) return 0;
+  return (size_t)st.st_size;
+}
+
+void File::close() {
+  if (impl && impl->fp) {
+    fclose(impl->fp);
+    impl->fp = nullptr;
+  }
+  impl.reset();
+}
+
+File::operator bool() const {
+  return impl && (impl->fp || impl->diretorio);
+}
+
+const char *File::path() const { return impl ? impl->path.c_str() : ""; }
+
+const char *File::name() const {
+  if (!impl) return "";
+  size_t barra = impl->path.rfind('/');
+  return impl->path.c_str() + (barra == std::string::npos ? 0 : barra + 1);
+}
+
+bool File::isDirectory() const { return impl && impl->diretorio; }
+
+File File::openNextFile(const char *modo) {
+  if (!impl || !impl->diretorio) return File();
+  while (impl->proxEntrada < impl->entradas.size()) {
+    const std::string &nome = impl->entradas[impl->proxEntrada++];
+    std::string base = (impl->path == "/") ? "" : impl->path;
+    return impl->dono->open((base + "/" + nome).c_str(), modo);
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (impl) impl->proxEntrada = 0;
+}
+
+// ---------------- FS ----------------
+
+void FS::definirRaiz(const char *dir) {
+  raiz = dir;
+  while (raiz.size() > 1 && raiz.back() == '/') raiz.pop_back();
+}
+
+std::string FS::caminhoHost(const char *path) const {
+  std::string p = path ? path : "/";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return raiz + p;
+}
+
+void FS::definirCustoFlash(uint32_t abrirUs, uint32_t porKbUs) {
+  custoAbrirUs = abrirUs;
+  custoKbUs    = porKbUs;
+}
+
+void FS::cobrarBytes(size_t n) {
+  if (!custoKbUs) return;
+  bytesNaoCobrados += n;
+  if (bytesNaoCobrados >= 1024) {
+    relogioAvancarUs((uint64_t)(bytesNaoCobrados / 1024) * custoKbUs);
+    bytesNaoCobrados %= 1024;
+  }
+}
+
+File FS::open(const char *path, const char *modo, bool) {
+  relogioAvancarUs(custoAbrirUs);
+  std::string host = caminhoHost(path);
+  struct stat st;
+  bool existe = (stat(host.c_str(), &st) == 0);
+
+  auto impl  = std::make_shared<FileImpl>();
+  impl->path = path;
+  impl->dono = this;
+
+  if (existe && S_ISDIR(st.st_mode)) {
+    DIR *d = opendir(host.c_str());
+    if (!d) return File();
+    while (struct dirent *e = readdir(d)) {
+      if (e->d_name[0] == '.') continue;
+      impl->entradas.push_back(e->d_name);
+    }
+    closedir(d);
+    impl->diretorio = true;
+    return File(impl);
+  }
+
+  const char *m = "rb";
+  if (modo[0] == 'w')      m = (modo[1] == '+') ? "w+b" : "wb";
+  else if (modo[0] == 'a') m = "a+b";
+  else if (modo[1] == '+') m = "r+b";
+  if (modo[0] == 'r' && !existe) return File();
+
+  impl->fp = fopen(host.c_str(), m);
+  if (!impl->fp) return File();
+  return File(impl);
+}
+
+bool FS::exists(const char *path) {
+  struct stat st;
+  return stat(caminhoHost(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return ::unlink(caminhoHost(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *de, const char *para) {
+  return ::rename(caminhoHost(de).c_str(), caminhoHost(para).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  std::string host = caminhoHost(path);
+  // cria também os diretórios intermediários (mkdir -p)
+  for (size_t i = 1; i <= host.size(); i++) {
+    if (i == host.size() || host[i] == '/') {
+      std::string parcial = host.substr(0, i);
+      ::mkdir(parcial.c_str(), 0755);
+    }
+  }
+  struct stat st;
+  return stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool FS::rmdir(const char *path) {
+  return ::rmdir(caminhoHost(path).c_str()) == 0;
+}
+
+bool FS::apagarTudo() {
+  File dir = open("/");
+  std::vector<std::string> nomes;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) nomes.push_back(f.path());
+  for (auto &n : nomes) remove(n.c_str());
+  return true;
+}
+
+size_t FS::somarTamanhos() {
+  size_t usado = 0;
+  File dir = open("/");
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) usado += f.size();
+  return usado;
+}
+
+}  // namespace fs
+
+// ---------------- SPIFFS / LittleFS ----------------
+
+// Diretório ausente = partição sem formato: só monta se puder formatar
+bool SPIFFSFS::begin(bool formatOnFail, const char *, uint8_t, const char *) {
+  return exists("/") || (formatOnFail && mkdir("/"));
+}
+
+bool   SPIFFSFS::format()     { return apagarTudo(); }
+size_t SPIFFSFS::totalBytes() { return total; }
+size_t SPIFFSFS::usedBytes()  { return somarTamanhos(); }
+
+bool LittleFSFS::begin(bool formatOnFail, const char *, uint8_t, const char *) {
+  return exists("/") || (formatOnFail && mkdir("/"));
+}
+
+bool   LittleFSFS::format()     { return apagarTudo(); }
+size_t LittleFSFS::totalBytes() { return total; }
+size_t LittleFSFS::usedBytes()  { return somarTamanhos(); }
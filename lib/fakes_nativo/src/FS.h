@@ -0,0 +1,93 @@
+// fs::FS / fs::File no estilo do core ESP32, gravando num diretório do PC.
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+
+class File : public Stream {
+ public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> p) : impl(p) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int    available() override;
+  int    read() override;
+  size_t read(uint8_t *buf, size_t n);
+  int    peek() override;
+  void   flush() override;
+  bool   seek(uint32_t pos, SeekMode modo = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void   close();
+  explicit operator bool() const;
+
+  const char *path() const;
+  const char *name() const;
+  bool        isDirectory() const;
+  File        openNextFile(const char *modo = FILE_READ);
+  void        rewindDirectory();
+
+ private:
+  std::shared_ptr<FileImpl> impl;
+};
+
+class FS {
+ public:
+  explicit FS(const char *raizPadrao) : raiz(raizPadrao) {}
+  virtual ~FS() {}
+
+  File open(const char *path, const char *modo = FILE_READ, bool criar = false);
+  File open(const String &path, const char *modo = FILE_READ, bool criar = false) {
+    return open(path.c_str(), modo, criar);
+  }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *de, const char *para);
+  bool rename(const String &de, const String &para) { return rename(de.c_str(), para.c_str()); }
+  bool mkdir(const char *path);
+  bool rmdir(const char *path);
+
+  // ---- só no PC ----
+  void        definirRaiz(const char *dir);
+  const char *raizHost() const { return raiz.c_str(); }
+  std::string caminhoHost(const char *path) const;
+  // tempo virtual gasto por open() e por KB lido/gravado (0 = de graça)
+  void        definirCustoFlash(uint32_t abrirUs, uint32_t porKbUs);
+  void        cobrarBytes(size_t n);
+
+ protected:
+  // format()/usedBytes() dos diretórios que fazem as vezes de partição
+  bool        apagarTudo();
+  size_t      somarTamanhos();
+
+  std::string raiz;
+  uint32_t    custoAbrirUs     = 0;
+  uint32_t    custoKbUs        = 0;
+  size_t      bytesNaoCobrados = 0;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
@@ -0,0 +1,36 @@
+// Serial do PC: saída vai para stdout; entrada vem de injetar() (o runner
+// nativo lê do stdin/script e injeta aqui).
+#pragma once
+
+#include <deque>
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  void end() {}
+  explicit operator bool() const { return true; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int    availableForWrite() { return 4096; }
+  void   flush() override;
+
+  int available() override { return (int)entrada.size(); }
+  int read() override;
+  int peek() override { return entrada.empty() ? -1 : entrada.front(); }
+
+  // ---- só no PC ----
+  void injetar(const char *texto);
+  void silenciar(bool s) { mudo = s; }
+  size_t bytesEscritos() const { return escritos; }
+
+ private:
+  std::deque<uint8_t> entrada;
+  bool   mudo     = false;
+  size_t escritos = 0;
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS {
+ public:
+  LittleFSFS() : fs::FS("fs_nativo/littlefs") {}
+  bool   begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs");
+  bool   format();
+  size_t totalBytes();
+  size_t usedBytes();
+  void   end() {}
+
+  // ---- só no PC: tamanho simulado da partição ----
+  void definirTotalBytes(size_t n) { total = n; }
+
+ private:
+  size_t total = 1048576;   // partição "littlefs" de 1 MB (partitions_portaria.csv)
+};
+
+extern LittleFSFS LittleFS;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "MFRC522v2.h"
+
+namespace MFRC522Debug {
+
+inline void PCD_DumpVersionToSerial(MFRC522 &, Print &out) {
+  out.println("Firmware Version: 0x00 = (leitor simulado)");
+}
+
+inline void PrintUID(Print &out, const MFRC522::Uid &uid) {
+  for (uint8_t i = 0; i < uid.size; i++) {
+    if (uid.uidByte[i] < 0x10) out.print(" 0");
+    else                       out.print(" ");
+    out.print(String(uid.uidByte[i], HEX));
+  }
+}
+
+}  // namespace MFRC522Debug
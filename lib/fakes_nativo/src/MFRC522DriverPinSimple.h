@@ -0,0 +1,8 @@
+#pragma once
+
+#include "MFRC522DriverSPI.h"
+
+class MFRC522DriverPinSimple : public MFRC522DriverPin {
+ public:
+  explicit MFRC522DriverPinSimple(uint8_t) {}
+};
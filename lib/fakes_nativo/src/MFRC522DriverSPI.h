@@ -0,0 +1,10 @@
+#pragma once
+
+#include "MFRC522v2.h"
+
+class MFRC522DriverPin {};
+
+class MFRC522DriverSPI : public MFRC522Driver {
+ public:
+  explicit MFRC522DriverSPI(MFRC522DriverPin &) {}
+};
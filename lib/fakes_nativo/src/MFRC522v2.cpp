@@ -0,0 +1,30 @@
+#include "MFRC522v2.h"
+
+static int valorHex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool MFRC522::aproximar(const char *uidHex) {
+  size_t len = strlen(uidHex);
+  if (len == 0 || len % 2 != 0 || len > 2 * sizeof(Uid::uidByte)) return false;
+
+  Uid u = {};
+  for (size_t i = 0; i < len; i += 2) {
+    int alto  = valorHex(uidHex[i]);
+    int baixo = valorHex(uidHex[i + 1]);
+    if (alto < 0 || baixo < 0) return false;
+    u.uidByte[u.size++] = (uint8_t)((alto << 4) | baixo);
+  }
+  cartoes.push_back(u);
+  return true;
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+  if (cartoes.empty()) return false;
+  uid = cartoes.front();
+  cartoes.pop_front();
+  return true;
+}
@@ -0,0 +1,39 @@
+// Leitor RC522 de mentira: os cartões "aproximados" ficam numa fila e são
+// lidos na ordem por PICC_IsNewCardPresent()/PICC_ReadCardSerial().
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "Arduino.h"
+
+class MFRC522Driver {};
+
+class MFRC522 {
+ public:
+  struct Uid {
+    uint8_t size;
+    uint8_t uidByte[10];
+    uint8_t sak;
+  };
+
+  explicit MFRC522(MFRC522Driver &) {}
+  MFRC522() {}
+
+  bool PCD_Init() { return true; }
+  bool PICC_IsNewCardPresent() { return !cartoes.empty(); }
+  bool PICC_ReadCardSerial();
+  uint8_t PICC_HaltA() { return 0; }
+  void PCD_StopCrypto1() {}
+
+  // ---- só no PC ----
+  // UID em hex ("a1b2c3d4"); false se não for hex válido de 1 a 10 bytes
+  bool aproximar(const char *uidHex);
+  size_t cartoesPendentes() const { return cartoes.size(); }
+  void descartarCartoes() { cartoes.clear(); }
+
+  Uid uid = {};
+
+ private:
+  std::deque<Uid> cartoes;
+};
@@ -0,0 +1,24 @@
+#include "PubSubClient.h"
+
+#include "relogio_fake.h"
+
+bool PubSubClient::publish(const char *topico, const uint8_t *payload, unsigned int len, bool retida) {
+  if (!conectado) return false;
+  // mesmo limite do cliente real: cabeçalho + tópico + payload cabem no buffer
+  if (5 + 2 + strlen(topico) + len > tamanhoBuffer) return false;
+
+  MensagemMqtt msg{ topico, std::string((const char *)payload, len), retida };
+  if (observador) observador(msg);
+  if (guardar)    publicadas.push_back(msg);
+  relogioAvancarUs(latenciaUs);
+  return true;
+}
+
+void PubSubClient::injetar(const char *topico, const char *payload) {
+  if (!callback) return;
+  // o cliente real descarta a mensagem recebida que não cabe no buffer
+  if (5 + 2 + strlen(topico) + strlen(payload) > tamanhoBuffer) return;
+  std::string t(topico);
+  std::vector<uint8_t> p(payload, payload + strlen(payload));
+  callback(&t[0], p.data(), (unsigned int)p.size());
+}
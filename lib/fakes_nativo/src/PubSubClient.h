@@ -0,0 +1,75 @@
+// PubSubClient de mentira: não abre socket. publish() guarda a mensagem e
+// avisa o observador (o runner nativo imprime ou mede); injetar() entrega
+// uma mensagem ao callback como se viesse do broker.
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+#define MQTT_CONNECTED     0
+#define MQTT_DISCONNECTED -1
+
+struct MensagemMqtt {
+  std::string topico;
+  std::string payload;
+  bool        retida;
+};
+
+class PubSubClient {
+ public:
+  typedef std::function<void(char *, uint8_t *, unsigned int)> Callback;
+  typedef void (*Observador)(const MensagemMqtt &msg);
+
+  PubSubClient() {}
+  template <typename C> explicit PubSubClient(C &) {}
+
+  PubSubClient &setServer(const char *, uint16_t) { return *this; }
+  PubSubClient &setCallback(Callback cb) { callback = cb; return *this; }
+  bool setBufferSize(uint16_t tam) { tamanhoBuffer = tam; return true; }
+  uint16_t getBufferSize() const { return tamanhoBuffer; }
+
+  bool connect(const char *) { conectado = permitirConexao; return conectado; }
+  bool connect(const char *id, const char *, const char *, const char *, uint8_t, bool, const char *) {
+    return connect(id);
+  }
+  void disconnect() { conectado = false; }
+  bool connected() const { return conectado; }
+  int  state() const { return conectado ? MQTT_CONNECTED : MQTT_DISCONNECTED; }
+  bool loop() { return conectado; }
+
+  bool subscribe(const char *topico) { inscricoes.push_back(topico); return true; }
+
+  bool publish(const char *topico, const char *payload) {
+    return publish(topico, (const uint8_t *)payload, strlen(payload), false);
+  }
+  bool publish(const char *topico, const char *payload, bool retida) {
+    return publish(topico, (const uint8_t *)payload, strlen(payload), retida);
+  }
+  bool publish(const char *topico, const uint8_t *payload, unsigned int len) {
+    return publish(topico, payload, len, false);
+  }
+  bool publish(const char *topico, const uint8_t *payload, unsigned int len, bool retida);
+
+  // ---- só no PC ----
+  void definirConectado(bool c) { permitirConexao = c; conectado = c; }
+  void observar(Observador o) { observador = o; }
+  void guardarPublicacoes(bool g) { guardar = g; }
+  // cada publish() bloqueia esse tempo (virtual), como a escrita no socket
+  void definirLatenciaUs(uint32_t us) { latenciaUs = us; }
+  void injetar(const char *topico, const char *payload);
+
+  std::vector<MensagemMqtt> publicadas;
+  std::vector<std::string>  inscricoes;
+
+ private:
+  Callback   callback;
+  Observador observador      = nullptr;
+  bool       conectado       = true;
+  bool       permitirConexao = true;
+  bool       guardar         = false;
+  uint16_t   tamanhoBuffer   = 256;
+  uint32_t   latenciaUs      = 0;
+};
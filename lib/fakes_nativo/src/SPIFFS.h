@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FS.h"
+
+class SPIFFSFS : public fs::FS {
+ public:
+  SPIFFSFS() : fs::FS("fs_nativo/spiffs") {}
+  bool   begin(bool formatOnFail = false, const char *basePath = "/spiffs",
+               uint8_t maxOpenFiles = 10, const char *partitionLabel = NULL);
+  bool   format();
+  size_t totalBytes();
+  size_t usedBytes();
+  void   end() {}
+
+  // ---- só no PC: tamanho simulado da partição ----
+  void definirTotalBytes(size_t n) { total = n; }
+
+ private:
+  size_t total = 1318001;   // ~ o que o SPIFFS entrega numa partição de 1,375 MB
+};
+
+extern SPIFFSFS SPIFFS;
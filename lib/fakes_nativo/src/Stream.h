@@ -0,0 +1,56 @@
+// Print/Stream no estilo Arduino.
+#pragma once
+
+#include <cstdarg>
+#include <cstring>
+
+#include "WString.h"
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t k = 0;
+    while (n--) k += write(*buf++);
+    return k;
+  }
+  size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+  size_t print(const String &v) { return write((const uint8_t *)v.c_str(), v.length()); }
+  size_t print(const char *v) { return write(v); }
+  size_t print(char v) { return write((uint8_t)v); }
+  size_t print(unsigned char v, int base = DEC) { return print(String(v, base)); }
+  size_t print(int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(long long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned long long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(double v, int casas = 2) { return print(String(v, casas)); }
+
+  size_t println() { return write("\r\n"); }
+  template <class T>
+  size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  template <class T>
+  size_t println(const T &v, int arg) { size_t n = print(v, arg); return n + println(); }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void   setTimeout(unsigned long ms) { timeout = ms; }
+  String readStringUntil(char terminador);
+  String readString();
+  size_t readBytes(char *buf, size_t n);
+  size_t readBytes(uint8_t *buf, size_t n) { return readBytes((char *)buf, n); }
+
+ protected:
+  unsigned long timeout = 1000;
+};
@@ -0,0 +1,115 @@
+#include "WString.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+static std::string numeroEmBase(unsigned long long v, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  if (v == 0) return "0";
+  char buf[72];
+  int i = sizeof(buf);
+  while (v) {
+    int d = (int)(v % base);
+    buf[--i] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+    v /= base;
+  }
+  return std::string(buf + i, sizeof(buf) - i);
+}
+
+static std::string comSinal(long long v, unsigned char base) {
+  if (v < 0 && base == 10) return "-" + numeroEmBase((unsigned long long)(-v), base);
+  return numeroEmBase((unsigned long long)v, base);
+}
+
+String::String(unsigned char v, unsigned char base) : s(numeroEmBase(v, base)) {}
+String::String(int v, unsigned char base) : s(comSinal(v, base)) {}
+String::String(unsigned int v, unsigned char base) : s(numeroEmBase(v, base)) {}
+String::String(long v, unsigned char base) : s(comSinal(v, base)) {}
+String::String(unsigned long v, unsigned char base) : s(numeroEmBase(v, base)) {}
+String::String(long long v, unsigned char base) : s(comSinal(v, base)) {}
+String::String(unsigned long long v, unsigned char base) : s(numeroEmBase(v, base)) {}
+
+String::String(float v, unsigned char casas) : String((double)v, casas) {}
+
+String::String(double v, unsigned char casas) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)casas, v);
+  s = buf;
+}
+
+void String::trim() {
+  size_t a = 0, b = s.size();
+  while (a < b && isspace((unsigned char)s[a])) a++;
+  while (b > a && isspace((unsigned char)s[b - 1])) b--;
+  s = s.substr(a, b - a);
+}
+
+void String::toLowerCase() {
+  for (auto &c : s) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (auto &c : s) c = (char)toupper((unsigned char)c);
+}
+
+int String::indexOf(char c, unsigned int de) const {
+  size_t p = s.find(c, de);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const String &t, unsigned int de) const {
+  size_t p = s.find(t.s, de);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t p = s.rfind(c);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned int de) const {
+  return substring(de, length());
+}
+
+String String::substring(unsigned int de, unsigned int ate) const {
+  if (de > ate) { unsigned int t = de; de = ate; ate = t; }
+  if (de >= s.size()) return String();
+  if (ate > s.size()) ate = (unsigned int)s.size();
+  return String(s.substr(de, ate - de));
+}
+
+long String::toInt() const {
+  return strtol(s.c_str(), nullptr, 10);
+}
+
+bool String::endsWith(const String &p) const {
+  return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &o) const {
+  if (s.size() != o.s.size()) return false;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (tolower((unsigned char)s[i]) != tolower((unsigned char)o.s[i])) return false;
+  }
+  return true;
+}
+
+void String::replace(const String &de, const String &para) {
+  if (de.s.empty()) return;
+  size_t p = 0;
+  while ((p = s.find(de.s, p)) != std::string::npos) {
+    s.replace(p, de.s.size(), para.s);
+    p += para.s.size();
+  }
+}
+
+void String::remove(unsigned int idx, unsigned int n) {
+  if (idx >= s.size()) return;
+  s.erase(idx, n);
+}
+
+String operator+(const String &a, const String &b) { String r(a); r += b; return r; }
+String operator+(const String &a, const char *b)   { String r(a); r += b; return r; }
+String operator+(const char *a, const String &b)   { String r(a); r += b; return r; }
+String operator+(const String &a, char b)          { String r(a); r += b; return r; }
@@ -0,0 +1,78 @@
+// String no estilo Arduino, suficiente para o código da portaria rodar no PC.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+
+class String {
+ public:
+  String() {}
+  String(const char *c) : s(c ? c : "") {}
+  String(const std::string &c) : s(c) {}
+  explicit String(char c) : s(1, c) {}
+  String(unsigned char v, unsigned char base = 10);
+  String(int v, unsigned char base = 10);
+  String(unsigned int v, unsigned char base = 10);
+  String(long v, unsigned char base = 10);
+  String(unsigned long v, unsigned char base = 10);
+  String(long long v, unsigned char base = 10);
+  String(unsigned long long v, unsigned char base = 10);
+  String(float v, unsigned char casas = 2);
+  String(double v, unsigned char casas = 2);
+
+  unsigned int length() const { return (unsigned int)s.size(); }
+  const char  *c_str() const { return s.c_str(); }
+  bool         reserve(unsigned int n) { s.reserve(n); return true; }
+
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+
+  int    indexOf(char c, unsigned int de = 0) const;
+  int    indexOf(const String &t, unsigned int de = 0) const;
+  int    lastIndexOf(char c) const;
+  String substring(unsigned int de) const;
+  String substring(unsigned int de, unsigned int ate) const;
+  long   toInt() const;
+  bool   startsWith(const String &p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool   endsWith(const String &p) const;
+  bool   equals(const String &o) const { return s == o.s; }
+  bool   equalsIgnoreCase(const String &o) const;
+  void   replace(const String &de, const String &para);
+  void   remove(unsigned int idx, unsigned int n = (unsigned int)-1);
+
+  char  charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  char  operator[](unsigned int i) const { return charAt(i); }
+  char &operator[](unsigned int i) { return s[i]; }
+
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *o) { if (o) s += o; return *this; }
+  String &operator+=(char o) { s += o; return *this; }
+  String &operator+=(int o) { return *this += String(o); }
+  String &operator+=(unsigned int o) { return *this += String(o); }
+  String &operator+=(long o) { return *this += String(o); }
+  String &operator+=(unsigned long o) { return *this += String(o); }
+  bool    concat(const String &o) { s += o.s; return true; }
+  bool    concat(const char *o, unsigned int n) { s.append(o, n); return true; }
+
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == (o ? o : ""); }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator!=(const char *o) const { return !(*this == o); }
+  bool operator<(const String &o) const { return s < o.s; }
+  bool operator>(const String &o) const { return s > o.s; }
+  bool operator<=(const String &o) const { return s <= o.s; }
+  bool operator>=(const String &o) const { return s >= o.s; }
+
+ private:
+  std::string s;
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char *b);
+String operator+(const char *a, const String &b);
+String operator+(const String &a, char b);
@@ -0,0 +1,91 @@
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+uint8_t WiFiClient::connected() {
+  if (fd < 0) return 0;
+  char c;
+  ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) return 1;
+  if (n == 0) return 0;   // o outro lado fechou
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : 0;
+}
+
+int WiFiClient::available() {
+  int n = 0;
+  if (fd < 0 || ioctl(fd, FIONREAD, &n) < 0) return 0;
+  return n;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t n) {
+  if (fd < 0) return -1;
+  ssize_t k = recv(fd, buf, n, MSG_DONTWAIT);
+  return k > 0 ? (int)k : -1;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+  if (fd < 0 || recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) return -1;
+  return c;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t n) {
+  size_t enviado = 0;
+  while (fd >= 0 && enviado < n) {
+    ssize_t k = send(fd, buf + enviado, n - enviado, MSG_NOSIGNAL);
+    if (k <= 0) {
+      if (k < 0 && errno == EINTR) continue;
+      break;
+    }
+    enviado += (size_t)k;
+  }
+  return enviado;
+}
+
+void WiFiClient::stop() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+}
+
+void WiFiServer::begin(uint16_t novaPorta) {
+  if (novaPorta) porta = novaPorta;
+  if (fd >= 0) return;
+
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return;
+  int um = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+
+  sockaddr_in end = {};
+  end.sin_family      = AF_INET;
+  end.sin_port        = htons(porta);
+  end.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr *)&end, sizeof(end)) < 0 || listen(fd, 4) < 0) {
+    fprintf(stderr, "WiFiServer: porta %u indisponivel\n", (unsigned)porta);
+    close(fd);
+    fd = -1;
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+WiFiClient WiFiServer::accept() {
+  if (fd < 0) return WiFiClient();
+  int c = ::accept(fd, nullptr, nullptr);
+  if (c < 0) return WiFiClient();
+  fcntl(c, F_SETFL, fcntl(c, F_GETFL, 0) & ~O_NONBLOCK);   // escrita bloqueante
+  return WiFiClient(c);
+}
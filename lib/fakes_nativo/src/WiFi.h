@@ -0,0 +1,43 @@
+// WiFiServer/WiFiClient de mentira sobre sockets TCP de verdade do PC, para
+// o servidor HTTP do núcleo (exportacao_http.h) atender curl no env native.
+// Só o que o núcleo usa: begin()/accept() sem bloquear, leitura sem bloquear
+// e escrita bloqueante (como a do ESP32, que espera o buffer do lwIP).
+#pragma once
+
+#include "Arduino.h"
+#include "Stream.h"
+
+class WiFiClient : public Stream {
+ public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd) : fd(fd) {}
+
+  // Cópias dividem o mesmo socket, como no ESP32; stop() fecha para todas
+  uint8_t connected();
+  operator bool() { return fd >= 0; }
+
+  int    available() override;
+  int    read() override;
+  int    read(uint8_t *buf, size_t n);
+  int    peek() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  void   stop();
+
+ private:
+  int fd = -1;
+};
+
+class WiFiServer {
+ public:
+  explicit WiFiServer(uint16_t porta = 80) : porta(porta) {}
+
+  void       begin(uint16_t novaPorta = 0);
+  WiFiClient accept();   // cliente inválido se ninguém estiver esperando
+  WiFiClient available() { return accept(); }
+
+ private:
+  uint16_t porta;
+  int      fd = -1;
+};
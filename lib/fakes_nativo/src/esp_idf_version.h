@@ -0,0 +1,6 @@
+// Os fakes seguem a API do IDF 5 (core Arduino 3.x)
+#pragma once
+
+#define ESP_IDF_VERSION_MAJOR  5
+#define ESP_IDF_VERSION_MINOR  1
+#define ESP_IDF_VERSION_PATCH  0
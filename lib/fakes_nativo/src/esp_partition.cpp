@@ -0,0 +1,143 @@
+#include "esp_partition.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct ParticaoFake {
+  esp_partition_t info;
+  std::string     arquivo;
+  int             fd;
+};
+
+// Mesma linha de partitions_portaria.csv
+static ParticaoFake particoes[] = {
+  { { ESP_PARTITION_TYPE_DATA, 0x40, 0x150000, 0x30000, SPI_FLASH_SEC_SIZE, "cadastro", false },
+    "fs_nativo/cadastro.img", -1 },
+};
+
+struct MapeamentoFake {
+  void  *ptr;
+  size_t tam;
+};
+
+static std::vector<MapeamentoFake> mapeamentos;   // handle = índice + 1
+
+static ParticaoFake *particaoDe(const esp_partition_t *p) {
+  for (ParticaoFake &pf : particoes) {
+    if (&pf.info == p) return &pf;
+  }
+  return nullptr;
+}
+
+static void criarDiretorios(const std::string &arquivo) {
+  for (size_t i = 1; i < arquivo.size(); i++) {
+    if (arquivo[i] == '/') ::mkdir(arquivo.substr(0, i).c_str(), 0755);
+  }
+}
+
+// Abre (e completa com 0xFF até o tamanho da partição) na primeira vez
+static int descritor(ParticaoFake &pf) {
+  if (pf.fd >= 0) return pf.fd;
+  criarDiretorios(pf.arquivo);
+  int fd = ::open(pf.arquivo.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  if ((size_t)st.st_size < pf.info.size) {
+    std::vector<uint8_t> apagado(pf.info.size - st.st_size, 0xFF);
+    if (pwrite(fd, apagado.data(), apagado.size(), st.st_size) != (ssize_t)apagado.size()) {
+      ::close(fd);
+      return -1;
+    }
+  }
+  pf.fd = fd;
+  return fd;
+}
+
+static bool dentro(const ParticaoFake &pf, size_t offset, size_t n) {
+  return offset <= pf.info.size && n <= pf.info.size - offset;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+  for (ParticaoFake &pf : particoes) {
+    if (pf.info.type != type) continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && pf.info.subtype != subtype) continue;
+    if (label && strcmp(label, pf.info.label) != 0) continue;
+    return &pf.info;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset, void *dst, size_t n) {
+  ParticaoFake *pf = particaoDe(p);
+  if (!pf || !dst) return ESP_ERR_INVALID_ARG;
+  if (!dentro(*pf, offset, n)) return ESP_ERR_INVALID_SIZE;
+  int fd = descritor(*pf);
+  if (fd < 0) return ESP_FAIL;
+  return pread(fd, dst, n, offset) == (ssize_t)n ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset, const void *src, size_t n) {
+  ParticaoFake *pf = particaoDe(p);
+  if (!pf || !src) return ESP_ERR_INVALID_ARG;
+  if (!dentro(*pf, offset, n)) return ESP_ERR_INVALID_SIZE;
+  int fd = descritor(*pf);
+  if (fd < 0) return ESP_FAIL;
+  return pwrite(fd, src, n, offset) == (ssize_t)n ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t n) {
+  ParticaoFake *pf = particaoDe(p);
+  if (!pf) return ESP_ERR_INVALID_ARG;
+  if (offset % pf->info.erase_size || n % pf->info.erase_size) return ESP_ERR_INVALID_SIZE;
+  if (!dentro(*pf, offset, n)) return ESP_ERR_INVALID_SIZE;
+  int fd = descritor(*pf);
+  if (fd < 0) return ESP_FAIL;
+  std::vector<uint8_t> apagado(n, 0xFF);
+  return pwrite(fd, apagado.data(), n, offset) == (ssize_t)n ? ESP_OK : ESP_FAIL;
+}
+
+// O arquivo inteiro é mapeado MAP_SHARED: o que esp_partition_write() grava
+// depois aparece no mapeamento, como na flash depois de invalidar o cache.
+esp_err_t esp_partition_mmap(const esp_partition_t *p, size_t offset, size_t n,
+                             esp_partition_mmap_memory_t memory, const void **ptr,
+                             esp_partition_mmap_handle_t *handle) {
+  (void)memory;
+  ParticaoFake *pf = particaoDe(p);
+  if (!pf || !ptr || !handle) return ESP_ERR_INVALID_ARG;
+  if (!dentro(*pf, offset, n)) return ESP_ERR_INVALID_SIZE;
+  int fd = descritor(*pf);
+  if (fd < 0) return ESP_FAIL;
+  void *base = ::mmap(nullptr, pf->info.size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) return ESP_FAIL;
+  mapeamentos.push_back({ base, pf->info.size });
+  *ptr    = (const uint8_t *)base + offset;
+  *handle = (esp_partition_mmap_handle_t)mapeamentos.size();
+  return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+  if (handle == 0 || handle > mapeamentos.size()) return;
+  MapeamentoFake &m = mapeamentos[handle - 1];
+  if (m.ptr) ::munmap(m.ptr, m.tam);
+  m.ptr = nullptr;
+}
+
+void particaoDefinirArquivo(const char *label, const char *arquivo) {
+  for (ParticaoFake &pf : particoes) {
+    if (strcmp(pf.info.label, label) != 0) continue;
+    if (pf.fd >= 0) ::close(pf.fd);
+    pf.fd      = -1;
+    pf.arquivo = arquivo;
+  }
+}
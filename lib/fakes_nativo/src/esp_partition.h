@@ -0,0 +1,64 @@
+// esp_partition_* no PC (API do IDF 5). Cada partição é um arquivo do host
+// com o tamanho da partição; esp_partition_mmap() é um mmap() desse arquivo,
+// então a busca lê direto das páginas mapeadas como no cache da flash.
+//
+// Só as partições usadas pela portaria existem (por enquanto, "cadastro").
+// Apagar grava 0xFF, como na flash; esp_partition_write() não confere se o
+// trecho estava apagado.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_idf_version.h"
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK                    0
+#define ESP_FAIL                 -1
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_SIZE  0x104
+#define ESP_ERR_NOT_FOUND     0x105
+#endif
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP  = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+#define ESP_PARTITION_SUBTYPE_ANY  0xff
+
+typedef enum {
+  ESP_PARTITION_MMAP_DATA,
+  ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef uint32_t esp_partition_mmap_handle_t;
+
+#define SPI_FLASH_SEC_SIZE  4096
+
+struct esp_partition_t {
+  esp_partition_type_t    type;
+  esp_partition_subtype_t subtype;
+  uint32_t                address;
+  uint32_t                size;
+  uint32_t                erase_size;
+  char                    label[17];
+  bool                    encrypted;
+};
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset, void *dst, size_t n);
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset, const void *src, size_t n);
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t n);
+esp_err_t esp_partition_mmap(const esp_partition_t *p, size_t offset, size_t n,
+                             esp_partition_mmap_memory_t memory, const void **ptr,
+                             esp_partition_mmap_handle_t *handle);
+void      esp_partition_munmap(esp_partition_mmap_handle_t handle);
+
+// ---- só no PC ----
+// Arquivo do host que faz as vezes da partição (criado com 0xFF se não
+// existir). Padrão: fs_nativo/<label>.img.
+void particaoDefinirArquivo(const char *label, const char *arquivo);
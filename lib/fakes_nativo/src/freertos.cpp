@@ -0,0 +1,148 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "Arduino.h"
+
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct FilaFake {
+  UBaseType_t comprimento;
+  UBaseType_t tamanhoItem;
+  std::deque<std::vector<uint8_t>> itens;
+  UBaseType_t contagem = 0;     // semáforos usam só o contador
+  bool        semaforo = false;
+};
+
+struct TarefaFake {
+  std::string nome;
+  uint32_t    pilha;
+};
+
+static std::vector<TarefaFake *> tarefas;
+
+QueueHandle_t xQueueCreate(UBaseType_t comprimento, UBaseType_t tamanhoItem) {
+  FilaFake *f = new FilaFake();
+  f->comprimento = comprimento;
+  f->tamanhoItem = tamanhoItem;
+  return f;
+}
+
+void vQueueDelete(QueueHandle_t fila) { delete fila; }
+
+static BaseType_t enfileirar(QueueHandle_t fila, const void *item, bool naFrente) {
+  if (!fila || fila->itens.size() >= fila->comprimento) return pdFALSE;
+  const uint8_t *p = (const uint8_t *)item;
+  std::vector<uint8_t> v(p, p + fila->tamanhoItem);
+  if (naFrente) fila->itens.push_front(v);
+  else          fila->itens.push_back(v);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t fila, const void *item, TickType_t) {
+  return enfileirar(fila, item, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t fila, const void *item, TickType_t) {
+  return enfileirar(fila, item, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t fila, const void *item, TickType_t) {
+  return enfileirar(fila, item, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t fila, void *item, TickType_t) {
+  if (!fila || fila->itens.empty()) return pdFALSE;
+  memcpy(item, fila->itens.front().data(), fila->tamanhoItem);
+  fila->itens.pop_front();
+  return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t fila, void *item, TickType_t) {
+  if (!fila || fila->itens.empty()) return pdFALSE;
+  memcpy(item, fila->itens.front().data(), fila->tamanhoItem);
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t fila) {
+  if (!fila) return 0;
+  return fila->semaforo ? fila->contagem : (UBaseType_t)fila->itens.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t fila) {
+  return fila ? fila->comprimento - uxQueueMessagesWaiting(fila) : 0;
+}
+
+BaseType_t xQueueReset(QueueHandle_t fila) {
+  if (fila) {
+    fila->itens.clear();
+    fila->contagem = 0;
+  }
+  return pdPASS;
+}
+
+// ---------------- Semáforos ----------------
+
+static SemaphoreHandle_t novoSemaforo(UBaseType_t maximo, UBaseType_t inicial) {
+  FilaFake *s   = new FilaFake();
+  s->comprimento = maximo;
+  s->tamanhoItem = 0;
+  s->contagem    = inicial;
+  s->semaforo    = true;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return novoSemaforo(1, 0); }
+SemaphoreHandle_t xSemaphoreCreateMutex() { return novoSemaforo(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return novoSemaforo(0xffff, 0xffff); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maximo, UBaseType_t inicial) {
+  return novoSemaforo(maximo, inicial);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  if (!s || s->contagem >= s->comprimento) return pdFALSE;
+  s->contagem++;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t) {
+  if (!s || s->contagem == 0) return pdFALSE;
+  s->contagem--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s) { return xSemaphoreGive(s); }
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t t) { return xSemaphoreTake(s, t); }
+void       vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+// ---------------- Tarefas ----------------
+
+BaseType_t xTaskCreate(TaskFunction_t, const char *nome, uint32_t pilha,
+                       void *, UBaseType_t, TaskHandle_t *handle) {
+  TarefaFake *t = new TarefaFake{ nome ? nome : "", pilha };
+  tarefas.push_back(t);
+  if (handle) *handle = t;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcao, const char *nome, uint32_t pilha,
+                                   void *param, UBaseType_t prioridade, TaskHandle_t *handle,
+                                   BaseType_t) {
+  return xTaskCreate(funcao, nome, pilha, param, prioridade, handle);
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+void vTaskDelete(TaskHandle_t) {}
+TickType_t xTaskGetTickCount() { return (TickType_t)(millis() / portTICK_PERIOD_MS); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t t) {
+  return t ? t->pilha / 2 : 4096;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+const char *pcTaskGetName(TaskHandle_t t) { return t ? t->nome.c_str() : "main"; }
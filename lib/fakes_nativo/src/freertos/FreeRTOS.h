@@ -0,0 +1,33 @@
+// FreeRTOS de mentira para o PC: tudo roda numa thread só, então filas e
+// semáforos nunca bloqueiam (uma espera que não pode ser atendida falha na hora).
+#pragma once
+
+#include <cstdint>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef struct FilaFake    *QueueHandle_t;
+typedef struct FilaFake    *SemaphoreHandle_t;
+typedef struct TarefaFake  *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE   ((BaseType_t)1)
+#define pdFALSE  ((BaseType_t)0)
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS   ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY     0
+#define tskNO_AFFINITY       0x7FFFFFFF
+
+typedef struct { int dummy; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux))
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t comprimento, UBaseType_t tamanhoItem);
+void          vQueueDelete(QueueHandle_t fila);
+BaseType_t    xQueueSend(QueueHandle_t fila, const void *item, TickType_t espera);
+BaseType_t    xQueueSendToBack(QueueHandle_t fila, const void *item, TickType_t espera);
+BaseType_t    xQueueSendToFront(QueueHandle_t fila, const void *item, TickType_t espera);
+BaseType_t    xQueueReceive(QueueHandle_t fila, void *item, TickType_t espera);
+BaseType_t    xQueuePeek(QueueHandle_t fila, void *item, TickType_t espera);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t fila);
+UBaseType_t   uxQueueSpacesAvailable(QueueHandle_t fila);
+BaseType_t    xQueueReset(QueueHandle_t fila);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maximo, UBaseType_t inicial);
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t s);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t s, TickType_t espera);
+BaseType_t        xSemaphoreGiveRecursive(SemaphoreHandle_t s);
+BaseType_t        xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t espera);
+void              vSemaphoreDelete(SemaphoreHandle_t s);
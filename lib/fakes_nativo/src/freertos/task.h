@@ -0,0 +1,17 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// As tarefas só são registradas (nome/prioridade); quem roda a lógica no PC
+// é o próprio programa nativo, chamando as funções de processamento direto.
+BaseType_t   xTaskCreate(TaskFunction_t funcao, const char *nome, uint32_t pilha,
+                         void *param, UBaseType_t prioridade, TaskHandle_t *handle);
+BaseType_t   xTaskCreatePinnedToCore(TaskFunction_t funcao, const char *nome, uint32_t pilha,
+                                     void *param, UBaseType_t prioridade, TaskHandle_t *handle,
+                                     BaseType_t nucleo);
+void         vTaskDelay(TickType_t ticks);
+void         vTaskDelete(TaskHandle_t t);
+TickType_t   xTaskGetTickCount();
+UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t t);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char  *pcTaskGetName(TaskHandle_t t);
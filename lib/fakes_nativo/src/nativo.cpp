@@ -0,0 +1,149 @@
+#include "Arduino.h"
+#include "relogio_fake.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <random>
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+void EspClass::definirHeap(uint32_t livre, uint32_t maiorBloco) {
+  heapLivre      = livre;
+  heapMaiorBloco = maiorBloco;
+  if (livre < heapMinimo) heapMinimo = livre;
+}
+
+// ---------------- Print / Stream ----------------
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n >= sizeof(buf)) n = sizeof(buf) - 1;
+  return write((const uint8_t *)buf, (size_t)n);
+}
+
+String Stream::readStringUntil(char terminador) {
+  String r;
+  int c;
+  while ((c = read()) >= 0 && c != terminador) r += (char)c;
+  return r;
+}
+
+String Stream::readString() {
+  String r;
+  int c;
+  while ((c = read()) >= 0) r += (char)c;
+  return r;
+}
+
+size_t Stream::readBytes(char *buf, size_t n) {
+  size_t k = 0;
+  int c;
+  while (k < n && (c = read()) >= 0) buf[k++] = (char)c;
+  return k;
+}
+
+// ---------------- Serial ----------------
+
+size_t HardwareSerial::write(uint8_t c) {
+  escritos++;
+  if (!mudo) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t n) {
+  escritos += n;
+  if (!mudo) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
+
+int HardwareSerial::read() {
+  if (entrada.empty()) return -1;
+  int c = entrada.front();
+  entrada.pop_front();
+  return c;
+}
+
+void HardwareSerial::injetar(const char *texto) {
+  while (texto && *texto) entrada.push_back((uint8_t)*texto++);
+}
+
+// ---------------- Relógio virtual ----------------
+
+static uint64_t agoraUs        = 0;
+static bool     horaDefinida   = false;
+static double   escalaDelay    = 1.0;   // multiplica cada delay() (ex.: tempos de LED)
+static int64_t  epochLocalBase = 0;   // segundos locais quando agoraUs == baseUs
+static uint64_t baseUs         = 0;
+
+unsigned long millis() { return (unsigned long)(agoraUs / 1000); }
+unsigned long micros() { return (unsigned long)agoraUs; }
+void delay(unsigned long ms) { agoraUs += (uint64_t)(ms * 1000 * escalaDelay); }
+void delayMicroseconds(unsigned int us) { agoraUs += us; }
+void yield() {}
+
+uint32_t esp_random() {
+  static std::random_device rd;
+  return (uint32_t)rd();
+}
+
+void relogioAvancarMs(uint64_t ms) { agoraUs += ms * 1000; }
+void relogioAvancarUs(uint64_t us) { agoraUs += us; }
+uint64_t relogioAgoraUs() { return agoraUs; }
+void relogioEscalaDelay(double fator) { escalaDelay = fator; }
+
+void relogioDefinirEpochLocal(int64_t segundosLocais) {
+  horaDefinida   = true;
+  epochLocalBase = segundosLocais;
+  baseUs         = agoraUs;
+}
+
+bool relogioDefinirDataHora(const char *dataHora) {
+  int d, m, a, hh, mm, ss;
+  if (sscanf(dataHora, "%d/%d/%d %d:%d:%d", &d, &m, &a, &hh, &mm, &ss) != 6) return false;
+
+  struct tm t = {};
+  t.tm_mday = d;
+  t.tm_mon  = m - 1;
+  t.tm_year = a - 1900;
+  t.tm_hour = hh;
+  t.tm_min  = mm;
+  t.tm_sec  = ss;
+  relogioDefinirEpochLocal((int64_t)timegm(&t));   // guardado como UTC "ingênuo" = hora local
+  return true;
+}
+
+void relogioSemHora() { horaDefinida = false; }
+
+bool getLocalTime(struct tm *info, uint32_t) {
+  if (!horaDefinida) return false;
+  time_t t = (time_t)(epochLocalBase + (int64_t)((agoraUs - baseUs) / 1000000));
+  return gmtime_r(&t, info) != nullptr;
+}
+
+void configTime(long, int, const char *, const char *, const char *) {}
+
+// ---------------- Pinos ----------------
+
+static uint8_t estadoPinos[64];
+static void (*callbackPino)(uint8_t, uint8_t) = nullptr;
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pino, uint8_t valor) {
+  if (pino < sizeof(estadoPinos)) estadoPinos[pino] = valor;
+  if (callbackPino) callbackPino(pino, valor);
+}
+
+int digitalRead(uint8_t pino) { return pino < sizeof(estadoPinos) ? estadoPinos[pino] : LOW; }
+int pinoEstado(uint8_t pino) { return digitalRead(pino); }
+void pinoAoMudar(void (*callback)(uint8_t, uint8_t)) { callbackPino = callback; }
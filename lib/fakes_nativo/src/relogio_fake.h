@@ -0,0 +1,22 @@
+// Controle do tempo virtual no PC.
+//
+// millis()/micros() começam em 0 e só andam com delay()/relogioAvancarMs().
+// getLocalTime() falha (como sem NTP) até relogioDefinirDataHora() ser chamado.
+#pragma once
+
+#include <cstdint>
+
+// "dd/mm/aaaa hh:mm:ss" no horário local. false se o texto for inválido.
+bool relogioDefinirDataHora(const char *dataHora);
+void relogioDefinirEpochLocal(int64_t segundosLocais);
+void relogioSemHora();
+void relogioAvancarMs(uint64_t ms);
+void relogioAvancarUs(uint64_t us);
+uint64_t relogioAgoraUs();
+
+// delay(ms) passa a avançar ms * fator (1.0 = normal, 0 = delays instantâneos)
+void relogioEscalaDelay(double fator);
+
+// Estado dos LEDs (último valor de digitalWrite por pino)
+int  pinoEstado(uint8_t pino);
+void pinoAoMudar(void (*callback)(uint8_t pino, uint8_t valor));
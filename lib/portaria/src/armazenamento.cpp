@@ -0,0 +1,261 @@
+#include "armazenamento.h"
+
+#include <LittleFS.h>
+#include <SPIFFS.h>
+
+#include "log_serial.h"
+
+char              bufLeituraLog[LEITOR_BLOCO];
+SemaphoreHandle_t mtxLeituraLog = NULL;
+
+// =========== Sistema de arquivos ===========
+#define PARTICAO_LITTLEFS  "littlefs"
+#define PARTICAO_SPIFFS    "spiffs"
+
+static bool   montarLittleFS(bool formatar) { return LittleFS.begin(formatar, "/littlefs", 10, PARTICAO_LITTLEFS); }
+static bool   formatarLittleFS()            { return LittleFS.format(); }
+static size_t totalLittleFS()               { return LittleFS.totalBytes(); }
+static size_t usadosLittleFS()              { return LittleFS.usedBytes(); }
+
+static bool   montarSPIFFS(bool formatar)   { return SPIFFS.begin(formatar, "/spiffs", 10, PARTICAO_SPIFFS); }
+static bool   formatarSPIFFS()              { return SPIFFS.format(); }
+static size_t totalSPIFFS()                 { return SPIFFS.totalBytes(); }
+static size_t usadosSPIFFS()                { return SPIFFS.usedBytes(); }
+
+const BackendArquivos BACKEND_LITTLEFS = {
+  "littlefs", LittleFS, montarLittleFS, formatarLittleFS, totalLittleFS, usadosLittleFS, true
+};
+const BackendArquivos BACKEND_SPIFFS = {
+  "spiffs", SPIFFS, montarSPIFFS, formatarSPIFFS, totalSPIFFS, usadosSPIFFS, false
+};
+
+#ifdef PORTARIA_FS_SPIFFS
+const BackendArquivos &backendArquivos = BACKEND_SPIFFS;
+#else
+const BackendArquivos &backendArquivos = BACKEND_LITTLEFS;
+#endif
+
+#ifndef PORTARIA_FS_SPIFFS
+// Copia via "<path>.mig" + rename: um reset no meio não deixa arquivo pela metade
+static bool migrarArquivo(File &origem, const String &path, size_t &bytes) {
+  String tmp = path + ".mig";
+  File w = LittleFS.open(tmp, FILE_WRITE);
+  if (!w) return false;
+  bool ok = true;
+  size_t n;
+  while (ok && (n = origem.read((uint8_t*)bufLeituraLog, sizeof(bufLeituraLog))) > 0) {
+    ok = w.write((const uint8_t*)bufLeituraLog, n) == n;
+    bytes += n;
+  }
+  w.close();
+  return ok && LittleFS.rename(tmp.c_str(), path.c_str());
+}
+
+// Tudo que sobrou na partição SPIFFS de versões antigas vem para o LittleFS.
+// Cada arquivo é apagado do SPIFFS depois de copiado; nos boots seguintes a
+// partição está vazia e isso custa só a montagem.
+static void migrarDoSpiffs() {
+  if (!SPIFFS.begin(false, "/spiffs", 4, PARTICAO_SPIFFS)) return;   // sem partição antiga
+
+  uint32_t t0 = millis();
+  size_t arquivos = 0;
+  size_t bytes    = 0;
+  TravaLeituraLog trava;
+  for (;;) {
+    File dir = SPIFFS.open("/");
+    File f   = dir ? dir.openNextFile() : File();
+    if (!f || f.isDirectory()) break;
+    String path = f.path();
+    bool ok = migrarArquivo(f, path, bytes);
+    f.close();
+    dir.close();
+    if (!ok) {
+      LOG_ERRO("ERRO ao migrar %s do SPIFFS; tenta de novo no proximo boot.", path.c_str());
+      break;
+    }
+    SPIFFS.remove(path.c_str());
+    arquivos++;
+  }
+  SPIFFS.end();
+
+  if (arquivos) {
+    LOG_INFO("Migrado do SPIFFS para o LittleFS: %u arquivo(s), %lu bytes, %lu ms",
+             (unsigned)arquivos, (unsigned long)bytes, (unsigned long)(millis() - t0));
+  }
+}
+#endif
+
+bool montarArmazenamento() {
+  if (!backendArquivos.montar(true)) return false;
+#ifndef PORTARIA_FS_SPIFFS
+  migrarDoSpiffs();
+#endif
+  return true;
+}
+
+File abrirArquivo(const char *path, const char *modo) {
+  return backendArquivos.fs.open(path, modo);
+}
+
+bool arquivoExiste(const char *path) {
+  return backendArquivos.fs.exists(path);
+}
+
+bool removerArquivo(const char *path) {
+  return backendArquivos.fs.remove(path);
+}
+
+size_t lerTrechoArquivo(const char *path, size_t offset, void *buf, size_t n) {
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return 0;
+  size_t lidos = f.seek(offset) ? f.read((uint8_t*)buf, n) : 0;
+  f.close();
+  return lidos;
+}
+
+bool substituirArquivo(const char *tmp, const char *path) {
+  fs::FS &fs = backendArquivos.fs;
+  if (!backendArquivos.renomeiaPorCima && fs.exists(path) && !fs.remove(path)) return false;
+  return fs.rename(tmp, path);
+}
+
+bool appendLine(const char* path, const String& line, size_t* offsetLinha) {
+  File f = abrirArquivo(path, FILE_APPEND);
+  if (!f) return false;
+  if (offsetLinha) *offsetLinha = f.size();
+  String l = line + "\n";   // uma escrita só: não sobra linha sem '\n' se cair no meio
+  bool ok = f.write((const uint8_t*)l.c_str(), l.length()) == l.length();
+  f.close();
+  return ok;
+}
+
+static const char HEX_MIN[] = "0123456789abcdef";
+
+static void hexFixo(uint32_t v, uint8_t digitos, char *dst) {
+  for (int8_t i = digitos - 1; i >= 0; i--) {
+    dst[i] = HEX_MIN[v & 0x0F];
+    v >>= 4;
+  }
+}
+
+static int valorHex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool lerHexFixo(const char *p, uint8_t digitos, uint32_t &v) {
+  v = 0;
+  for (uint8_t i = 0; i < digitos; i++) {
+    int d = valorHex(p[i]);
+    if (d < 0) return false;
+    v = (v << 4) | (uint32_t)d;
+  }
+  return true;
+}
+
+bool montarMolduraRegistro(const char *corpo, size_t len, char *moldura) {
+  if (len > REGISTRO_CORPO_MAX) return false;
+  moldura[0] = ' ';
+  moldura[1] = '#';
+  hexFixo((uint32_t)len, 2, moldura + 2);
+  moldura[4] = ':';
+  hexFixo(crc32Atualizar(0, corpo, len), 8, moldura + 5);
+  moldura[REGISTRO_MOLDURA_TAM] = '\0';
+  return true;
+}
+
+bool appendRegistro(const char *path, const String &corpo, size_t *offsetLinha) {
+  char buf[REGISTRO_CORPO_MAX + REGISTRO_MOLDURA_TAM + 2];
+  size_t len = corpo.length();
+  if (!montarMolduraRegistro(corpo.c_str(), len, buf + len)) return false;
+  memcpy(buf, corpo.c_str(), len);
+  buf[len + REGISTRO_MOLDURA_TAM] = '\n';
+  size_t total = len + REGISTRO_MOLDURA_TAM + 1;
+
+  File f = abrirArquivo(path, FILE_APPEND);
+  if (!f) return false;
+  if (offsetLinha) *offsetLinha = f.size();
+  bool ok = f.write((const uint8_t*)buf, total) == total;
+  f.close();
+  return ok;
+}
+
+static bool temMoldura(const char *linha, size_t len) {
+  if (len < REGISTRO_MOLDURA_TAM) return false;
+  const char *m = linha + len - REGISTRO_MOLDURA_TAM;
+  return m[0] == ' ' && m[1] == '#' && m[4] == ':';
+}
+
+size_t corpoRegistro(const char *linha, size_t len) {
+  return temMoldura(linha, len) ? len - REGISTRO_MOLDURA_TAM : len;
+}
+
+SituacaoRegistro verificarRegistro(const char *linha, size_t len) {
+  if (!temMoldura(linha, len)) return REGISTRO_SEM_MOLDURA;
+  const char *m = linha + len - REGISTRO_MOLDURA_TAM;
+  size_t corpo = len - REGISTRO_MOLDURA_TAM;
+  uint32_t tam, crc;
+  if (!lerHexFixo(m + 2, 2, tam) || !lerHexFixo(m + 5, 8, crc)) return REGISTRO_CORROMPIDO;
+  if (tam != corpo || crc != crc32Atualizar(0, linha, corpo)) return REGISTRO_CORROMPIDO;
+  return REGISTRO_OK;
+}
+
+// Tabela de 16 entradas (meio byte por vez): 64 bytes de flash em vez de 1 KB
+uint32_t crc32Atualizar(uint32_t crc, const void *dados, size_t n) {
+  static const uint32_t TABELA[16] = {
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+    0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+    0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+    0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL,
+  };
+  const uint8_t *p = (const uint8_t*)dados;
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ TABELA[crc & 0x0F];
+    crc = (crc >> 4) ^ TABELA[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+bool gravarComCrc(File &f, const void *dados, size_t n, uint32_t &crc) {
+  crc = crc32Atualizar(crc, dados, n);
+  return f.write((const uint8_t*)dados, n) == n;
+}
+
+bool lerComCrc(File &f, void *dados, size_t n, uint32_t &crc) {
+  if (f.read((uint8_t*)dados, n) != n) return false;
+  crc = crc32Atualizar(crc, dados, n);
+  return true;
+}
+
+static inline char minusculo(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+bool trechoIgual(const Trecho &t, const char *s, size_t sLen) {
+  if (t.len != sLen) return false;
+  for (size_t i = 0; i < sLen; i++) {
+    if (minusculo(t.p[i]) != minusculo(s[i])) return false;
+  }
+  return true;
+}
+
+bool trechoIgual(const Trecho &t, const char *s) {
+  return trechoIgual(t, s, strlen(s));
+}
+
+void trechoCopiar(const Trecho &t, char *dst, size_t cap) {
+  size_t n = (t.len < cap - 1) ? t.len : cap - 1;
+  for (size_t i = 0; i < n; i++) dst[i] = minusculo(t.p[i]);
+  dst[n] = '\0';
+}
+
+Trecho trechoAparado(const char *p, size_t len) {
+  while (len && isspace((unsigned char)*p)) { p++; len--; }
+  while (len && isspace((unsigned char)p[len - 1])) len--;
+  Trecho t = { p, len };
+  return t;
+}
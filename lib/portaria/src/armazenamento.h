@@ -0,0 +1,171 @@
+// Acesso aos arquivos: backend do sistema de arquivos, append de linhas e
+// leitura do log em blocos.
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// =========== Sistema de arquivos ===========
+// Todo acesso a arquivo do núcleo passa por aqui. O backend é escolhido na
+// compilação: LittleFS na partição "littlefs" (padrão) ou SPIFFS com
+// -DPORTARIA_FS_SPIFFS. No PC os dois são diretórios (lib/fakes_nativo).
+//
+// O SPIFFS fica lento com log só de append conforme a partição enche (coleta
+// de lixo de vários ms dentro do appendLine()); o LittleFS não tem esse pico
+// e ainda troca um arquivo por outro com rename() atômico.
+struct BackendArquivos {
+  const char *nome;
+  fs::FS     &fs;
+  bool      (*montar)(bool formatarSeFalhar);
+  bool      (*formatar)();
+  size_t    (*bytesTotais)();
+  size_t    (*bytesUsados)();
+  bool        renomeiaPorCima;   // rename() substitui o destino de uma vez
+};
+
+extern const BackendArquivos BACKEND_LITTLEFS;
+extern const BackendArquivos BACKEND_SPIFFS;
+extern const BackendArquivos &backendArquivos;   // o da compilação
+
+// Monta o backend e, no LittleFS, traz o que ainda estiver na partição SPIFFS
+// antiga (uma vez: cada arquivo copiado é apagado de lá).
+bool   montarArmazenamento();
+
+File   abrirArquivo(const char *path, const char *modo = FILE_READ);
+bool   arquivoExiste(const char *path);
+bool   removerArquivo(const char *path);
+// Lê até 'n' bytes a partir de 'offset'; devolve quantos leu
+size_t lerTrechoArquivo(const char *path, size_t offset, void *buf, size_t n);
+// Põe 'tmp' (já fechado) no lugar de 'path'. No SPIFFS, que não renomeia por
+// cima, há um instante sem 'path': quem lê no boot deve aceitar o 'tmp'.
+bool   substituirArquivo(const char *tmp, const char *path);
+
+// Se offsetLinha != NULL, devolve o byte onde a linha começou no arquivo
+bool appendLine(const char* path, const String& line, size_t* offsetLinha = NULL);
+
+// =========== Registros com tamanho e CRC ===========
+// Cada linha do log de movimentações termina em " #LL:CCCCCCCC": LL é o
+// tamanho do corpo (bytes, hex) e CCCCCCCC o CRC-32 do corpo. A linha inteira
+// vai numa única escrita; um reset no meio deixa um registro sem '\n' ou com
+// CRC errado, que a recuperação do boot descarta. Linhas sem a moldura (logs
+// de versões antigas) continuam sendo lidas normalmente.
+#define REGISTRO_MOLDURA_TAM  13     // " #LL:CCCCCCCC"
+#define REGISTRO_CORPO_MAX    0xFF
+
+enum SituacaoRegistro {
+  REGISTRO_OK,
+  REGISTRO_SEM_MOLDURA,
+  REGISTRO_CORROMPIDO
+};
+
+// Escreve a moldura do corpo em 'moldura' (REGISTRO_MOLDURA_TAM + 1 bytes)
+bool   montarMolduraRegistro(const char *corpo, size_t len, char *moldura);
+bool   appendRegistro(const char *path, const String &corpo, size_t *offsetLinha = NULL);
+// Tamanho do corpo sem a moldura, sem conferir o CRC (leituras do dia a dia)
+size_t corpoRegistro(const char *linha, size_t len);
+// Confere tamanho e CRC (recuperação no boot)
+SituacaoRegistro verificarRegistro(const char *linha, size_t len);
+
+// CRC-32 (o mesmo do zlib); comece com crc = 0 e encadeie os trechos
+uint32_t crc32Atualizar(uint32_t crc, const void *dados, size_t n);
+
+// Grava/lê 'n' bytes acumulando o CRC; false se o arquivo não deu tudo
+bool gravarComCrc(File &f, const void *dados, size_t n, uint32_t &crc);
+bool lerComCrc(File &f, void *dados, size_t n, uint32_t &crc);
+
+// =========== Leitura do log sem alocação ===========
+// O log é lido em blocos de LEITOR_BLOCO bytes e cada linha/campo é devolvido
+// como um Trecho (ponteiro + tamanho) apontando para dentro do buffer, sem
+// criar String por linha. Um Trecho só vale até a próxima leitura.
+#define LEITOR_BLOCO  2048
+
+struct Trecho {
+  const char *p;
+  size_t      len;
+};
+
+// Comparação sem diferenciar maiúsculas (UIDs em hex)
+bool trechoIgual(const Trecho &t, const char *s, size_t sLen);
+bool trechoIgual(const Trecho &t, const char *s);
+
+// Copia para 'dst' (terminado em '\0', minúsculo), truncando em cap-1
+void trechoCopiar(const Trecho &t, char *dst, size_t cap);
+
+Trecho trechoAparado(const char *p, size_t len);
+
+// Lê um arquivo linha a linha usando o buffer fornecido, a partir da posição atual
+class LeitorLinhas {
+ public:
+  LeitorLinhas(File &arquivo, char *buffer, size_t capacidade)
+    : f(arquivo), buf(buffer), cap(capacidade), offBuf(arquivo.position()) {}
+
+  // 'linha' sem o '\n'; vale até a próxima chamada
+  bool proxima(Trecho &linha) {
+    for (;;) {
+      const char *nl = (fim > ini) ? (const char*)memchr(buf + ini, '\n', fim - ini) : NULL;
+      if (nl) {
+        size_t iniLinha = ini;
+        ini = (nl - buf) + 1;
+        if (pulando) {           // resto de uma linha maior que o buffer
+          pulando = false;
+          continue;
+        }
+        linha.p   = buf + iniLinha;
+        linha.len = (nl - buf) - iniLinha;
+        offLinha  = offBuf + iniLinha;
+        return true;
+      }
+
+      // sem '\n' no que sobrou: move o resto pro começo e lê mais um bloco
+      if (ini > 0) {
+        memmove(buf, buf + ini, fim - ini);
+        offBuf += ini;
+        fim    -= ini;
+        ini     = 0;
+      }
+      if (fim == cap) {          // linha não cabe no buffer: descarta
+        offBuf += fim;
+        fim     = 0;
+        pulando = true;
+      }
+
+      size_t n = f.read((uint8_t*)buf + fim, cap - fim);
+      if (n == 0) {
+        if (fim > ini && !pulando) {   // última linha sem '\n'
+          linha.p   = buf + ini;
+          linha.len = fim - ini;
+          offLinha  = offBuf + ini;
+          ini = fim;
+          return true;
+        }
+        return false;
+      }
+      fim += n;
+    }
+  }
+
+  size_t offsetLinha() const { return offLinha; }
+
+ private:
+  File  &f;
+  char  *buf;
+  size_t cap;
+  size_t ini      = 0;
+  size_t fim      = 0;
+  size_t offBuf   = 0;     // offset no arquivo de buf[0]
+  size_t offLinha = 0;
+  bool   pulando  = false;
+};
+
+// Buffer único para varreduras do log. Consultas (loop/MQTT) e o registro de
+// movimentações (TaskProcessaCartoes) podem ler o log, então o uso é serializado.
+extern char              bufLeituraLog[LEITOR_BLOCO];
+extern SemaphoreHandle_t mtxLeituraLog;
+
+struct TravaLeituraLog {
+  TravaLeituraLog()  { if (mtxLeituraLog) xSemaphoreTake(mtxLeituraLog, portMAX_DELAY); }
+  ~TravaLeituraLog() { if (mtxLeituraLog) xSemaphoreGive(mtxLeituraLog); }
+};
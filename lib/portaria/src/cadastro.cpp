@@ -0,0 +1,281 @@
+#include "cadastro.h"
+
+#include "armazenamento.h"
+#include "comandos.h"
+#include "config.h"
+#include "estado.h"
+#include "fluxo.h"
+#include "imagem_cadastro.h"
+#include "serializador.h"
+#include "sinc_cadastro.h"
+
+String uidToString(const MFRC522::Uid& uid) {
+  String s = "";
+  for (byte i = 0; i < uid.size; i++) {
+    if (uid.uidByte[i] < 0x10) s += "0";
+    s += String(uid.uidByte[i], HEX);
+  }
+  s.toLowerCase();
+  return s;
+}
+
+
+
+void listRegistered(const char* fileName) {
+  File f = abrirArquivo(fileName, FILE_READ);
+  if (!f) {
+    Serial.print("Nenhum arquivo ainda (");
+    Serial.print(fileName);
+    Serial.println(" nao existe).");
+    return;
+  }
+  Serial.print("== UIDs cadastrados em ");
+  Serial.print(fileName);
+  Serial.println(" ==");
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    line.trim();
+    if (line.length()) Serial.println(line);
+  }
+  f.close();
+  Serial.println("== fim ==");
+}
+
+// conta e lista os UIDs cadastrados
+size_t countRegisteredAndShow(const char* fileName) {
+  File f = abrirArquivo(fileName, FILE_READ);
+  if (!f) {
+    Serial.println("0");
+    return 0;
+  }
+
+  size_t count = 0;
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    line.trim();
+    if (line.length()) {
+      count++;
+    }
+  }
+  f.close();
+
+  Serial.println(count);
+
+  if (count == 0) {
+    return 0;
+  }
+
+  File f2 = abrirArquivo(fileName, FILE_READ);
+  if (!f2) {
+    return count;
+  }
+
+  while (f2.available()) {
+    String line = f2.readStringUntil('\n');
+    line.trim();
+    if (line.length()) {
+      Serial.println(line);
+    }
+  }
+  f2.close();
+
+  return count;
+}
+
+static uint8_t papelDoArquivo(const char* fileName) {
+  if (strcmp(fileName, CARDS_FILE) == 0)  return PAPEL_USUARIO;
+  if (strcmp(fileName, ADMINS_FILE) == 0) return PAPEL_FUNCIONARIO;
+  return 0;
+}
+
+// Varre o arquivo linha a linha (sem imagem do cadastro)
+static bool constaNoArquivo(const char* fileName, const String &uid) {
+  File f = abrirArquivo(fileName, FILE_READ);
+  if (!f) return false;
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    line.trim();
+    line.toLowerCase();
+    if (line.length() && line == uid) {
+      f.close();
+      return true;
+    }
+  }
+  f.close();
+  return false;
+}
+
+uint8_t papeisDoUid(const String &uid) {
+  uint8_t papeis = 0;
+  if (consultarImagemCadastro(uid, papeis)) return papeis;
+  if (constaNoArquivo(CARDS_FILE, uid))  papeis |= PAPEL_USUARIO;
+  if (constaNoArquivo(ADMINS_FILE, uid)) papeis |= PAPEL_FUNCIONARIO;
+  return papeis;
+}
+
+// Verifica se UID está em um arquivo (usuarios ou funcionarios)
+bool isRegistered(const char* fileName, const String &uid) {
+  uint8_t papel  = papelDoArquivo(fileName);
+  uint8_t papeis = 0;
+  if (papel && consultarImagemCadastro(uid, papeis)) return (papeis & papel) != 0;
+  return constaNoArquivo(fileName, uid);
+}
+
+// Remove UID de um arquivo
+static bool tryRemoveUidFrom(const char* path, const String& uidNorm) {
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) {
+    Serial.printf("Aviso: arquivo %s nao encontrado.\n", path);
+    return false;
+  }
+
+  String newContent = "";
+  bool found = false;
+
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    line.trim();
+    if (!line.length()) continue;
+
+    String cmp = line;
+    cmp.toLowerCase();
+    if (cmp == uidNorm) {
+      found = true;
+    } else {
+      newContent += line + "\n";
+    }
+  }
+  f.close();
+
+  if (!found) return false;
+
+  // grava ao lado e troca: um reset no meio não deixa o cadastro pela metade
+  String tmp = String(path) + ".tmp";
+  File w = abrirArquivo(tmp.c_str(), FILE_WRITE);
+  if (!w) {
+    Serial.printf("Erro ao abrir %s para sobrescrever.\n", path);
+    return false;
+  }
+  bool ok = w.print(newContent) == newContent.length();
+  w.close();
+  if (!ok || !substituirArquivo(tmp.c_str(), path)) {
+    Serial.printf("Erro ao sobrescrever %s.\n", path);
+    removerArquivo(tmp.c_str());
+    return false;
+  }
+
+  anotarCadastro(uidNorm, papelDoArquivo(path), false);
+  avancarVersaoCadastro();
+  Serial.printf("✅ UID removido de %s com sucesso!\n", path);
+  return true;
+}
+
+// Deleta UID de usuarios ou funcionarios
+bool deleteCard(const String &uidToRemoveRaw) {
+  String uid = uidToRemoveRaw;
+  uid.trim();
+  uid.toLowerCase();
+
+  if (tryRemoveUidFrom(CARDS_FILE, uid)) {
+    return true;
+  }
+
+  if (tryRemoveUidFrom(ADMINS_FILE, uid)) {
+    return true;
+  }
+
+  Serial.println("UID nao encontrado em CARDS_FILE nem em ADMINS_FILE.");
+  return false;
+}
+
+// {"context":"cadastro","boot":B,"seq":N,"event":...,"status":...,"tipo":...[,"uid"][,"reason"][,"id"]}
+static void publicarStatusCadastro(const char *evento, const char *status, const char *tipo,
+                                   const char *uid = NULL, const char *motivo = NULL) {
+  if (!mqttClient.connected()) return;
+  char buf[192];
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+  s.objeto().texto("context", "cadastro").natural("boot", idBootStatus()).natural("seq", proximoSeqStatus());
+  s.texto("event", evento).texto("status", status).texto("tipo", tipo);
+  if (uid)    s.texto("uid", uid);
+  if (motivo) s.texto("reason", motivo);
+  s.idRequisicao().fechar();
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+// Cadastro de cartão
+void registerCard(const char* fileName, const char* tipoCadastro) {
+  Serial.print("\n[CADASTRO] Aproxime um cartao para cadastrar no arquivo ");
+  Serial.println(fileName);
+  unsigned long t0 = millis();
+
+  publicarStatusCadastro("cadastro_start", "waiting", tipoCadastro);
+
+  while (true) {
+    if (millis() - t0 > 10000) {
+      Serial.println("[CADASTRO] Tempo esgotado (10s). Cancelado.");
+      digitalWrite(LED_RED, HIGH); delay(200);
+      digitalWrite(LED_RED, LOW);
+
+      publicarStatusCadastro("cadastro_timeout", "error", tipoCadastro);
+
+      return;
+    }
+
+    if (!mfrc522.PICC_IsNewCardPresent()) { delay(50); continue; }
+    if (!mfrc522.PICC_ReadCardSerial())   { delay(50); continue; }
+
+    String uidString = uidToString(mfrc522.uid);
+    Serial.print("[CADASTRO] UID lido: ");
+    Serial.println(uidString);
+
+    // 1) JÁ CADASTRADO -> LED AMARELO + status "exists"
+    if (isRegistered(fileName, uidString)) {
+      Serial.println("[CADASTRO] UID já cadastrado nesse arquivo.");
+      digitalWrite(LED_YELLOW, HIGH); delay(300);
+      digitalWrite(LED_YELLOW, LOW);
+
+      publicarStatusCadastro("cadastro_already_registered", "exists", tipoCadastro, uidString.c_str());
+    }
+    // 2) NOVO -> grava no arquivo, LED VERDE + status "success"
+    else {
+      bool ok = appendLine(fileName, uidString);
+      if (ok) {
+        anotarCadastro(uidString, papelDoArquivo(fileName), true);
+        avancarVersaoCadastro();
+        Serial.print("[CADASTRO] Salvo em ");
+        Serial.println(fileName);
+
+        digitalWrite(LED_GREEN, HIGH); delay(400);
+        digitalWrite(LED_GREEN, LOW);
+
+        publicarStatusCadastro("cadastro_success", "success", tipoCadastro, uidString.c_str());
+      } else {
+        Serial.println("[CADASTRO] ERRO ao salvar no arquivo.");
+        digitalWrite(LED_RED, HIGH); delay(400);
+        digitalWrite(LED_RED, LOW);
+
+        publicarStatusCadastro("cadastro_error", "error", tipoCadastro, NULL, "fs_write_failed");
+      }
+    }
+
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+    break;
+  }
+}
+
+void checkCardRegistered(const String &uidString) {
+  if (isRegistered(CARDS_FILE, uidString)) {
+    Serial.println("✅ Cartao cadastrado em usuarios.txt! LED VERDE...");
+    digitalWrite(LED_GREEN, HIGH);
+    digitalWrite(LED_RED, LOW);
+    delay(2000);
+    digitalWrite(LED_GREEN, LOW);
+  } else {
+    Serial.println("❌ Cartao NAO cadastrado em usuarios.txt! LED VERMELHO...");
+    digitalWrite(LED_RED, HIGH);
+    digitalWrite(LED_GREEN, LOW);
+    delay(2000);
+    digitalWrite(LED_RED, LOW);
+  }
+}
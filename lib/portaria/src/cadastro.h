@@ -0,0 +1,17 @@
+// Cadastro de cartões em CARDS_FILE (usuários) e ADMINS_FILE (funcionários).
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522v2.h>
+
+String uidToString(const MFRC522::Uid& uid);
+
+void   listRegistered(const char* fileName);
+size_t countRegisteredAndShow(const char* fileName);   // conta e lista os UIDs cadastrados
+bool   isRegistered(const char* fileName, const String &uid);
+// PAPEL_USUARIO | PAPEL_FUNCIONARIO numa consulta só (imagem do cadastro ou,
+// sem ela, os dois arquivos)
+uint8_t papeisDoUid(const String &uid);
+bool   deleteCard(const String &uidToRemoveRaw);
+void   registerCard(const char* fileName, const char* tipoCadastro);
+void   checkCardRegistered(const String &uidString);
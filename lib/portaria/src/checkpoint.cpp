@@ -0,0 +1,179 @@
+#include "checkpoint.h"
+
+#include "armazenamento.h"
+#include "config.h"
+#include "datas.h"
+#include "estado.h"
+#include "log_serial.h"
+#include "movimentacoes.h"
+#include "relatorios.h"
+
+static const char *CHECKPOINT_TMP  = "/estado.tmp";   // só existe durante a gravação
+static const char *PRESENCA_ANTIGO = "/presenca.bin";   // versões antigas gravavam a presença à parte
+
+#define CHECKPOINT_MAGIC   0x434B5031UL   // "CKP1"
+#define CHECKPOINT_VERSAO  1
+
+struct CabecalhoCheckpoint {
+  uint32_t magic;
+  uint16_t versao;
+  uint16_t tamPresenca;    // sizeof dos registros: muda se UID_MAX_LEN/PRESENCA_SEMANAS mudarem
+};
+
+static uint32_t      registrosNoCheckpoint = 0;
+static unsigned long ultimoCheckpointMs    = 0;
+
+bool salvarCheckpoint() {
+  if (movimentacoesSemHora() > 0) return false;
+
+  uint32_t t0 = millis();
+  File f = abrirArquivo(CHECKPOINT_TMP, FILE_WRITE);
+  if (!f) {
+    LOG_ERRO("ERRO ao criar checkpoint.");
+    return false;
+  }
+
+  CabecalhoCheckpoint cab = { CHECKPOINT_MAGIC, CHECKPOINT_VERSAO,
+                              (uint16_t)(UID_MAX_LEN + 1 + PRESENCA_SEMANAS) };
+  uint32_t crc = 0;
+  bool ok = gravarComCrc(f, &cab, sizeof(cab), crc);
+
+  uint32_t registros;
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  ok = ok && gravarEstadoDerivado(f, crc);
+  size_t offset = offsetEstadoDerivado();
+  registros     = registrosEstadoDerivado();
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+
+  ok = ok && f.write((const uint8_t*)&crc, sizeof(crc)) == sizeof(crc);
+  size_t tamanho = f.size();
+  f.close();
+
+  // no SPIFFS, se cair entre o remove e o rename, o boot usa o .tmp
+  ok = ok && substituirArquivo(CHECKPOINT_TMP, CHECKPOINT_FILE);
+  if (!ok) {
+    LOG_ERRO("ERRO ao gravar checkpoint.");
+    return false;
+  }
+
+  registrosNoCheckpoint = registros;
+  ultimoCheckpointMs    = millis();
+  LOG_INFO("Checkpoint gravado: offset %lu, %u bytes, %lu ms",
+           (unsigned long)offset, (unsigned)tamanho, (unsigned long)(millis() - t0));
+  return true;
+}
+
+void salvarCheckpointPeriodico() {
+  uint32_t pendentes = registrosEstadoDerivado() - registrosNoCheckpoint;
+  if (pendentes == 0) return;
+  if (pendentes < CHECKPOINT_REGISTROS && millis() - ultimoCheckpointMs < CHECKPOINT_INTERVALO_MS) return;
+  if (!salvarCheckpoint()) ultimoCheckpointMs = millis();   // não tenta de novo a cada volta
+}
+
+size_t offsetCheckpoint() {
+  const char *path = arquivoExiste(CHECKPOINT_FILE) ? CHECKPOINT_FILE : CHECKPOINT_TMP;
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return SIZE_MAX;
+
+  CabecalhoCheckpoint cab;
+  uint32_t offset;
+  bool ok = f.read((uint8_t*)&cab, sizeof(cab)) == sizeof(cab) &&
+            cab.magic == CHECKPOINT_MAGIC && cab.versao == CHECKPOINT_VERSAO &&
+            f.read((uint8_t*)&offset, sizeof(offset)) == sizeof(offset);
+  f.close();
+  return ok ? (size_t)offset : SIZE_MAX;
+}
+
+// O offset tem que caber no log e cair logo depois de um '\n'; senão o log
+// foi trocado ou truncado e o checkpoint não vale para ele.
+static bool offsetConfereComLog(size_t offset) {
+  if (offset == 0) return true;
+  uint8_t c = 0;
+  return lerTrechoArquivo(MOVIMENTACOES_FILE, offset - 1, &c, 1) == 1 && c == '\n';
+}
+
+static bool carregarArquivoCheckpoint(const char *path) {
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return false;
+
+  CabecalhoCheckpoint cab;
+  uint32_t crc = 0;
+  uint32_t crcGravado;
+  bool ok = lerComCrc(f, &cab, sizeof(cab), crc) &&
+            cab.magic == CHECKPOINT_MAGIC &&
+            cab.versao == CHECKPOINT_VERSAO &&
+            cab.tamPresenca == UID_MAX_LEN + 1 + PRESENCA_SEMANAS &&
+            lerEstadoDerivado(f, crc) &&
+            f.read((uint8_t*)&crcGravado, sizeof(crcGravado)) == sizeof(crcGravado) &&
+            crcGravado == crc &&
+            f.position() == f.size();
+  f.close();
+
+  ok = ok && offsetConfereComLog(offsetEstadoDerivado());
+  if (!ok) zerarEstadoDerivado();
+  return ok;
+}
+
+// Aplica as linhas do log a partir de 'desde' nas tabelas em RAM
+static size_t reaplicarLog(size_t desde) {
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (!f) return 0;
+  if (!f.seek(desde)) {
+    f.close();
+    return 0;
+  }
+
+  TravaLeituraLog trava;
+  LeitorLinhas leitor(f, bufLeituraLog, sizeof(bufLeituraLog));
+  Trecho linha;
+  MovLinha mov;
+  char uidFunc[UID_MAX_LEN + 1];
+  char uidUser[UID_MAX_LEN + 1];
+  size_t linhas = 0;
+
+  while (leitor.proxima(linha)) {
+    if (!parseMovLine(linha.p, linha.len, mov)) continue;
+    trechoCopiar(mov.func, uidFunc, sizeof(uidFunc));
+    trechoCopiar(mov.user, uidUser, sizeof(uidUser));
+    aplicarMovimentacaoEstado(uidFunc, uidUser, mov.recebeu,
+                              diaNumFromStr(mov.data.p, mov.data.len),
+                              segundosFromHoraStr(mov.hora.p, mov.hora.len),
+                              leitor.offsetLinha() + linha.len + 1);
+    linhas++;
+  }
+  avancarOffsetEstado(f.size());
+  f.close();
+  return linhas;
+}
+
+void restaurarEstadoDerivado() {
+  uint32_t t0 = millis();
+
+  bool doCheckpoint = carregarArquivoCheckpoint(CHECKPOINT_FILE);
+  if (!doCheckpoint && carregarArquivoCheckpoint(CHECKPOINT_TMP)) {
+    doCheckpoint = substituirArquivo(CHECKPOINT_TMP, CHECKPOINT_FILE);
+  }
+
+  size_t desde = offsetEstadoDerivado();
+  if (!doCheckpoint) {
+    // sem checkpoint: só as semanas que a presença guarda (via índice)
+    zerarEstadoDerivado();
+    int32_t primeiroDia = -1;
+    if (ultimaChaveIndexada >= 0) {
+      primeiroDia = segundaDoDia(ultimaChaveIndexada) - 7 * (PRESENCA_SEMANAS - 1);
+    }
+    desde = offsetMovimentacoesDesde(primeiroDia);
+    if (desde == SIZE_MAX) desde = 0;
+  }
+
+  size_t linhas = reaplicarLog(desde);
+  LOG_INFO("Estado derivado: %s + %u linha(s) do log a partir do byte %lu, %lu ms",
+           doCheckpoint ? "checkpoint" : "sem checkpoint", (unsigned)linhas,
+           (unsigned long)desde, (unsigned long)(millis() - t0));
+
+  if (!doCheckpoint || linhas > 0) salvarCheckpoint();
+  else                             registrosNoCheckpoint = registrosEstadoDerivado();
+  ultimoCheckpointMs = millis();
+
+  if (arquivoExiste(PRESENCA_ANTIGO)) removerArquivo(PRESENCA_ANTIGO);
+}
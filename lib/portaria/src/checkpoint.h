@@ -0,0 +1,31 @@
+// Checkpoint do estado derivado do log (presença semanal, primeira entrada do
+// dia, quem está dentro hoje) junto com o offset do log que ele já cobre.
+//
+// Sem ele, cada boot reconstruía as tabelas varrendo semanas de log. Com ele o
+// boot carrega o arquivo e reaplica só as linhas gravadas depois do offset,
+// então o custo não cresce com o histórico.
+//
+// O arquivo novo é gravado em CHECKPOINT_TMP e só então toma o lugar de
+// CHECKPOINT_FILE; o CRC32 no fim descarta um arquivo pela metade. Um reset
+// em qualquer ponto deixa pelo menos um checkpoint inteiro (ou nenhum, e aí
+// o boot reconstrói do log como antes).
+#pragma once
+
+#include <Arduino.h>
+
+// Offset do log coberto pelo checkpoint gravado, sem carregar nem conferir o
+// CRC (só para limitar a recuperação do fim do log). SIZE_MAX se não houver.
+size_t offsetCheckpoint();
+
+// Boot (depois do índice e dos horários limite): checkpoint + linhas depois
+// dele; sem checkpoint válido, reaplica as últimas PRESENCA_SEMANAS semanas
+// do log. Grava um checkpoint novo se reaplicou alguma coisa.
+void restaurarEstadoDerivado();
+
+// Grava agora. false se há movimentações esperando o NTP (o estado ainda não
+// as contém) ou se a escrita falhou.
+bool salvarCheckpoint();
+
+// Chamada a cada volta do loop(): grava depois de CHECKPOINT_REGISTROS
+// movimentações, ou de CHECKPOINT_INTERVALO_MS se houver alguma pendente.
+void salvarCheckpointPeriodico();
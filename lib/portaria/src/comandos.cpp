@@ -0,0 +1,716 @@
+#include "comandos.h"
+
+#include "freertos/queue.h"
+
+#include "cadastro.h"
+#include "estado.h"
+#include "fluxo.h"
+#include "log_serial.h"
+#include "metricas.h"
+#include "movimentacoes.h"
+#include "relatorios.h"
+#include "serializador.h"
+#include "sinc_cadastro.h"
+#include "telemetria.h"
+
+const char *ArgsComando::texto(const char *nome, const char *padrao) const {
+  for (uint8_t i = 0; i < n; i++) {
+    if (strcmp(nomes[i], nome) == 0 && valores[i]) return valores[i];
+  }
+  return padrao;
+}
+
+int ArgsComando::inteiro(const char *nome, int padrao) const {
+  const char *v = texto(nome);
+  return (v && *v) ? atoi(v) : padrao;
+}
+
+// ======================= Tratadores =======================
+
+// iniciar fluxo de ENTRADA (USUARIO -> FUNCIONARIO)
+static void cmdIniciarEntrada(const ArgsComando &a) {
+  modoAtual                = MODO_ENTRADA;
+  aguardandoSegundoEntrada = false;
+  aguardandoSegundoSaida   = false;
+  leituraHabilitada        = true;
+
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("MQTT: fluxo de ENTRADA iniciado (USUARIO -> FUNCIONARIO).");
+  } else {
+    Serial.println("Fluxo de ENTRADA iniciado. Aproxime o cartao do USUARIO.");
+  }
+  publicarStatusFluxo("entrada", "waiting", "idle");
+}
+
+// iniciar fluxo de SAÍDA (FUNCIONARIO -> USUARIO)
+static void cmdIniciarSaida(const ArgsComando &a) {
+  modoAtual                = MODO_SAIDA;
+  aguardandoSegundoEntrada = false;
+  aguardandoSegundoSaida   = false;
+  leituraHabilitada        = true;
+
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("MQTT: fluxo de SAIDA iniciado (FUNCIONARIO -> USUARIO).");
+  } else {
+    Serial.println("Fluxo de SAIDA iniciado. Aproxime o cartao do FUNCIONARIO.");
+  }
+  publicarStatusFluxo("saida", "idle", "waiting");
+}
+
+static void cmdCadastrar(const ArgsComando &a) {
+  const char *tipo = a.texto("tipo");
+
+  // o "waiting" sai do registerCard (cadastro_start, com o "id" do comando)
+  if (strcmp(tipo, "parent") == 0) {
+    registerCard(CARDS_FILE, "parent");
+  } else if (strcmp(tipo, "employee") == 0) {
+    registerCard(ADMINS_FILE, "employee");
+  }
+}
+
+static void cmdCadastrarUsuario(const ArgsComando &)     { registerCard(CARDS_FILE, "parent"); }
+static void cmdCadastrarFuncionario(const ArgsComando &) { registerCard(ADMINS_FILE, "employee"); }
+static void cmdListarUsuarios(const ArgsComando &)       { listRegistered(CARDS_FILE); }
+static void cmdListarFuncionarios(const ArgsComando &)   { listRegistered(ADMINS_FILE); }
+static void cmdContarUsuarios(const ArgsComando &)       { countRegisteredAndShow(CARDS_FILE); }
+static void cmdContarFuncionarios(const ArgsComando &)   { countRegisteredAndShow(ADMINS_FILE); }
+
+static void cmdDeletar(const ArgsComando &a) {
+  deleteCard(String(a.texto("uid")));
+}
+
+static void cmdHistorico(const ArgsComando &a) {
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("Comando MQTT: get_history -> enviando arquivo de movimentacoes");
+  } else {
+    listMovimentacoes();
+  }
+  publishMovHistoryToMQTT(a.inteiro("apos", -1));
+}
+
+static void cmdDentroHoje(const ArgsComando &a) {
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("Comando MQTT: get_inside_today -> enviando lista de usuarios dentro hoje");
+    publishUsuariosDentroHojeToMQTT();
+    return;
+  }
+  listarUsuariosDentroHoje();  // continua aparecendo na Serial
+  if (mqttClient.connected()) {
+    publishUsuariosDentroHojeToMQTT();  // e manda pro front também
+  }
+}
+
+// dias da semana em que o UID apareceu (semanasAtras opcional: 0 = semana atual)
+static void cmdDiasSemana(const ArgsComando &a) {
+  const char *uid = a.texto("uid", "");   // obrigatório: já validado
+  int semanasAtras = a.inteiro("semanasAtras", 0);
+
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("Comando MQTT: get_uid_week_days para UID %s", uid);
+    publishDiasSemanaPorUidToMQTT(String(uid), semanasAtras);
+  } else {
+    consultarDiasSemanaPorUidSerial(String(uid), semanasAtras);
+  }
+}
+
+static void cmdAtrasos(const ArgsComando &a) {
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("Comando MQTT: get_late_today -> enviando atrasados de hoje");
+    publishAtrasosHojeToMQTT();
+  } else {
+    listarAtrasosHoje();
+  }
+}
+
+// define limite de atraso: {"cmd":"set_late_cutoff","horario":"08:20"[,"uid":"..."]}
+static void cmdLimiteAtraso(const ArgsComando &a) {
+  const char* horario = a.texto("horario");
+  const char* uidJson = a.texto("uid", "");
+  int32_t seg = segundosFromHoraStr(horario, strlen(horario));
+  bool ok = (seg >= 0) && definirHorarioLimite(String(uidJson), (uint32_t)seg);
+
+  if (a.origem == ORIGEM_SERIAL) {
+    Serial.println(ok ? "Limite de atraso atualizado." : "Uso: set_late_cutoff HH:MM [uid]");
+  }
+
+  if (mqttClient.connected()) {
+    char buf[128];
+    Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+    s.objeto().texto("context", "late_cutoff").texto("uid", uidJson).texto("status", ok ? "success" : "error");
+    s.idRequisicao().fechar();
+    s.publicar(MQTT_TOPIC_STATUS);
+  }
+}
+
+// histogramas de latência + telemetria; "zerar" != 0 zera os histogramas depois
+static void cmdMetricas(const ArgsComando &a) {
+  if (a.origem == ORIGEM_MQTT) {
+    LOG_INFO("Comando MQTT: get_metrics -> enviando histogramas de latencia");
+    publishMetricasToMQTT();
+    publicarTelemetria();
+  } else {
+    listarMetricasSerial();
+    listarTelemetriaSerial();
+  }
+  if (a.inteiro("zerar", 0) != 0) zerarMetricas();
+}
+
+static void cmdZerarMetricas(const ArgsComando &) {
+  zerarMetricas();
+  Serial.println("Metricas de latencia zeradas.");
+}
+
+// só Serial: leva segundos (enche a partição antes de medir)
+static void cmdMedirAppend(const ArgsComando &a) {
+  int pct = a.inteiro("ocupacao", 80);
+  int n   = a.inteiro("n", 200);
+  if (pct < 0 || pct > 95 || n < 1 || n > 2000) {
+    Serial.println("Uso: B [ocupacao 0-95] [n 1-2000]");
+    return;
+  }
+  medirAppendSerial((uint8_t)pct, (uint16_t)n);
+}
+
+// {"cmd":"roster_import","parte":0,"partes":N,"uids":"uid:papeis,...","crc":"..."}
+// Roda aqui mesmo: "uids" não cabe nos dados da fila de comandos longos. Só
+// grava a parte; a troca dos arquivos segue no loop() (sinc_cadastro.cpp).
+static void cmdImportarCadastro(const ArgsComando &a) {
+  importarParteCadastro(a.inteiro("parte", -1), a.inteiro("partes", 0), a.texto("uids", ""), a.texto("crc"));
+}
+
+// {"cmd":"roster_diff","desde":versao,"add":"...","del":"..."}
+static void cmdDiffCadastro(const ArgsComando &a) {
+  aplicarDiffCadastro(a.inteiro("desde", -1), a.texto("add", ""), a.texto("del", ""));
+}
+
+static void cmdExportarCadastro(const ArgsComando &) {
+  exportarCadastroToMQTT();
+}
+
+static void cmdVersaoCadastro(const ArgsComando &) {
+  publicarVersaoCadastro();
+}
+
+// {"cmd":"set_format","topico":"movimentacoes|status|dentro|estado|metrics|todos","format":"json|msgpack"}
+static void cmdFormato(const ArgsComando &a) {
+  const char *canal = a.texto("topico");
+  FormatoCarga formato;
+  bool ok = formatoPorNome(a.texto("format"), formato) && definirFormatoCanal(canal, formato);
+
+  if (a.origem == ORIGEM_SERIAL) {
+    Serial.println(ok ? "Formato atualizado." : "Uso: set_format <movimentacoes|status|dentro|metrics|todos> <json|msgpack> (estado e todos: so json)");
+  } else {
+    LOG_INFO("Comando MQTT: set_format %s %s", canal, a.texto("format"));
+  }
+  if (ok && formato == FORMATO_MSGPACK) {
+    LOG_AVISO("MQTT: %s agora em portaria/%s/mp/...; o topico JSON para de receber.", canal, PORTARIA_ID);
+  }
+
+  if (mqttClient.connected()) {
+    char buf[128];
+    Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+    s.objeto().texto("context", "format").texto("topico", canal).texto("format", a.texto("format"));
+    s.texto("status", ok ? "success" : "error").idRequisicao().fechar();
+    s.publicar(MQTT_TOPIC_STATUS);
+  }
+}
+
+static void cmdAjuda(const ArgsComando &) {
+  mostrarAjudaComandos();
+}
+
+// ======================= Tabela =======================
+
+#define SEM_ARGS        {}
+#define TEXTO(n)        { n, ARG_TEXTO,   true  }
+#define INTEIRO(n)      { n, ARG_INTEIRO, true  }
+#define INTEIRO_OPC(n)  { n, ARG_INTEIRO, false }
+#define TEXTO_OPC(n)    { n, ARG_TEXTO,   false }
+
+static const Comando COMANDOS[] = {
+  { NULL,                'c', SEM_ARGS,                               0,             cmdCadastrarUsuario,     "cadastrar novo usuario" },
+  { NULL,                'a', SEM_ARGS,                               0,             cmdCadastrarFuncionario, "cadastrar novo admin" },
+  { NULL,                'l', SEM_ARGS,                               0,             cmdListarUsuarios,       "listar usuarios (apenas UIDs)" },
+  { NULL,                'L', SEM_ARGS,                               0,             cmdListarFuncionarios,   "listar admins (apenas UIDs)" },
+  { NULL,                'u', SEM_ARGS,                               0,             cmdContarUsuarios,       "quantidade + UIDs de usuarios" },
+  { NULL,                'f', SEM_ARGS,                               0,             cmdContarFuncionarios,   "quantidade + UIDs de admins" },
+  { "get_late_today",    't', SEM_ARGS,                               0,             cmdAtrasos,              "usuarios atrasados (primeira entrada apos o limite hoje)" },
+  { "get_inside_today",  'p', SEM_ARGS,                               COMANDO_LONGO, cmdDentroHoje,           "usuarios que estao dentro (baseado em entradas/saidas)" },
+  { "start_entrada",     'e', SEM_ARGS,                               0,             cmdIniciarEntrada,       "iniciar fluxo de ENTRADA (USUARIO -> FUNCIONARIO)" },
+  { "start_saida",       's', SEM_ARGS,                               0,             cmdIniciarSaida,         "iniciar fluxo de SAIDA   (FUNCIONARIO -> USUARIO)" },
+  { NULL,                'd', { TEXTO("uid") },                       0,             cmdDeletar,              "deletar UID" },
+  { "get_history",       'm', { INTEIRO_OPC("apos") },                COMANDO_LONGO, cmdHistorico,            "listar movimentacoes + enviar historico via MQTT (apos: so depois desse offset)" },
+  { "get_uid_week_days", 'h', { TEXTO("uid"), INTEIRO_OPC("semanasAtras") }, 0,      cmdDiasSemana,           "dias da semana em que o UID apareceu (semanasAtras: 0 = atual)" },
+  { "get_metrics",       'x', { INTEIRO_OPC("zerar") },               0,             cmdMetricas,             "latencias do caminho do cartao + heap/pilhas/fila" },
+  { NULL,                'X', SEM_ARGS,                               0,             cmdZerarMetricas,        "zerar latencias" },
+  { NULL,                'B', { INTEIRO_OPC("ocupacao"), INTEIRO_OPC("n") }, 0,        cmdMedirAppend,          "latencia do append com a particao ocupada (padrao 80%, 200 vezes)" },
+  { "set_late_cutoff",   0,   { TEXTO("horario"), TEXTO_OPC("uid") }, 0,             cmdLimiteAtraso,         "limite de atraso HH:MM (padrao, ou so do UID)" },
+  { "start_register",    0,   { TEXTO("tipo") },                      COMANDO_LONGO, cmdCadastrar,            "cadastro pelo painel: tipo parent|employee" },
+  { "roster_import",     0,   { INTEIRO("parte"), INTEIRO("partes"), TEXTO_OPC("uids"), TEXTO("crc") }, 0, cmdImportarCadastro, "importa o cadastro em partes (a ultima troca tudo)" },
+  { "roster_diff",       0,   { INTEIRO("desde"), TEXTO_OPC("add"), TEXTO_OPC("del") }, 0, cmdDiffCadastro,    "acrescenta/remove UIDs se o cadastro ainda estiver na versao 'desde'" },
+  { "roster_export",     0,   SEM_ARGS,                               COMANDO_LONGO, cmdExportarCadastro,     "cadastro inteiro em partes (formato do roster_import)" },
+  { "roster_version",    'v', SEM_ARGS,                               0,             cmdVersaoCadastro,       "versao do cadastro" },
+  { "set_format",        0,   { TEXTO("topico"), TEXTO("format") },   0,             cmdFormato,              "formato dos payloads do topico: json|msgpack" },
+  { NULL,                '?', SEM_ARGS,                               0,             cmdAjuda,                NULL },
+};
+
+static const size_t NUM_COMANDOS = sizeof(COMANDOS) / sizeof(COMANDOS[0]);
+
+const Comando *buscarComando(const char *nome) {
+  if (!nome) return NULL;
+  for (size_t i = 0; i < NUM_COMANDOS; i++) {
+    if (COMANDOS[i].nome && strcmp(COMANDOS[i].nome, nome) == 0) return &COMANDOS[i];
+  }
+  return NULL;
+}
+
+// Atalho exato primeiro ('l' e 'L' são comandos diferentes); senão ignora maiúsculas
+const Comando *buscarComandoSerial(const char *token) {
+  if (!token || !*token) return NULL;
+  if (token[1] != '\0') return buscarComando(token);
+
+  for (size_t i = 0; i < NUM_COMANDOS; i++) {
+    if (COMANDOS[i].letra && COMANDOS[i].letra == token[0]) return &COMANDOS[i];
+  }
+  for (size_t i = 0; i < NUM_COMANDOS; i++) {
+    if (COMANDOS[i].letra && tolower(COMANDOS[i].letra) == tolower(token[0])) return &COMANDOS[i];
+  }
+  return NULL;
+}
+
+// "<uid> [semanasAtras]"
+static String usoArgs(const Comando &c) {
+  String uso;
+  for (uint8_t k = 0; k < COMANDO_MAX_ARGS && c.args[k].nome; k++) {
+    uso += c.args[k].obrigatorio ? " <" : " [";
+    uso += c.args[k].nome;
+    uso += c.args[k].obrigatorio ? ">" : "]";
+  }
+  return uso;
+}
+
+static bool inteiroValido(const char *v) {
+  char *fim;
+  strtol(v, &fim, 10);
+  return fim != v && *fim == '\0';
+}
+
+// Confere os argumentos com o esquema do comando; devolve o nome do primeiro
+// que falta ou não é do tipo certo (NULL = tudo certo)
+static const char *validarArgs(const Comando &c, const ArgsComando &a) {
+  for (uint8_t k = 0; k < a.n; k++) {
+    const ArgComando &esq = c.args[k];
+    const char *v = a.valores[k];
+    if (!v || !*v) {
+      if (esq.obrigatorio) return esq.nome;
+      continue;
+    }
+    if (esq.tipo == ARG_INTEIRO && !inteiroValido(v)) return esq.nome;
+  }
+  return NULL;
+}
+
+// ======================= Id de requisição =======================
+
+static char   idAtual[ID_REQUISICAO_MAX + 1] = "";
+static int8_t formatoAtual = FORMATO_NENHUM;
+static bool   continuaAtual = false;   // o pedido em execução segue no loop() (continuarNoLoop)
+static const char *recusaAtual = NULL;  // motivo do "error" (recusarComandoAtual)
+
+const char *idRequisicaoAtual() {
+  return idAtual;
+}
+
+bool formatoRequisicaoAtual(FormatoCarga &formato) {
+  if (formatoAtual == FORMATO_NENHUM) return false;
+  formato = (FormatoCarga)formatoAtual;
+  return true;
+}
+
+// o id volta dentro de um JSON: só aceita o que não precisa de escape
+static bool idValido(const char *id) {
+  size_t n = 0;
+  for (const char *p = id; *p; p++, n++) {
+    if (n >= ID_REQUISICAO_MAX) return false;
+    if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-') return false;
+  }
+  return n > 0;
+}
+
+// {"context":"cmd","cmd":"get_history","id":"...","status":"queued|done|error"[,"reason":"..."]}
+static void publicarAckComando(const char *cmd, const char *id, int8_t formato, const char *status,
+                               const char *motivo = NULL) {
+  if (!id || !*id || !mqttClient.connected()) return;
+  char buf[160];
+  Serializador s(buf, sizeof(buf), formato == FORMATO_NENHUM ? formatoCanal(CANAL_STATUS) : (FormatoCarga)formato);
+  s.objeto().texto("context", "cmd").texto("cmd", cmd).texto("id", id).texto("status", status);
+  if (motivo) s.texto("reason", motivo);
+  s.fechar();
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+static void executarComando(const Comando &c, const ArgsComando &a, const char *id, int8_t formato) {
+  snprintf(idAtual, sizeof(idAtual), "%s", id ? id : "");
+  formatoAtual = formato;
+  c.tratar(a);
+  if (recusaAtual) publicarAckComando(c.nome, idAtual, formatoAtual, "error", recusaAtual);
+  else             publicarAckComando(c.nome, idAtual, formatoAtual, continuaAtual ? "queued" : "done");
+  idAtual[0]    = '\0';
+  formatoAtual  = FORMATO_NENHUM;
+  continuaAtual = false;
+  recusaAtual   = NULL;
+}
+
+// ======================= MQTT =======================
+
+// JSON plano ({"chave": valor, ...}) lido direto no payload, sem cópia: a aspa
+// de fechamento ou o delimitador depois de cada chave/valor vira '\0' e os
+// campos apontam para dentro do próprio buffer. Objetos e listas aninhados
+// não são aceitos; null vira valor NULL.
+#define JSON_MAX_CAMPOS  8
+
+struct CampoJson {
+  const char *nome;
+  const char *valor;
+};
+
+static char *pularEspacos(char *p, char *fim) {
+  while (p < fim && isspace((unsigned char)*p)) p++;
+  return p;
+}
+
+static int valorHex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = (char)tolower((unsigned char)c);
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// p aponta para a aspa de abertura. Tira os escapes no lugar (\uXXXX fora do
+// ASCII vira '?'), termina o texto com '\0' e deixa p depois da aspa final.
+static char *lerTextoJson(char *&p, char *fim) {
+  char *ini = ++p;
+  char *dst = ini;
+  while (p < fim) {
+    char c = *p++;
+    if (c == '"') {
+      *dst = '\0';
+      return ini;
+    }
+    if (c == '\\') {
+      if (p >= fim) return NULL;
+      char e = *p++;
+      switch (e) {
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          if (fim - p < 4) return NULL;
+          int v = 0;
+          for (uint8_t k = 0; k < 4; k++) {
+            int h = valorHex(p[k]);
+            if (h < 0) return NULL;
+            v = (v << 4) | h;
+          }
+          p += 4;
+          c = (v > 0 && v < 0x80) ? (char)v : '?';
+          break;
+        }
+        default: c = e;   // \" \\ \/
+      }
+    }
+    *dst++ = c;
+  }
+  return NULL;
+}
+
+// false = JSON inválido. Campos além de 'max' são ignorados.
+static bool lerObjetoJson(char *buf, size_t len, CampoJson *campos, uint8_t max, uint8_t &n) {
+  char *fim = buf + len;
+  char *p   = pularEspacos(buf, fim);
+  n = 0;
+  if (p >= fim || *p != '{') return false;
+  p = pularEspacos(p + 1, fim);
+  if (p < fim && *p == '}') return true;
+
+  while (p < fim) {
+    if (*p != '"') return false;
+    char *nome = lerTextoJson(p, fim);
+    if (!nome) return false;
+    p = pularEspacos(p, fim);
+    if (p >= fim || *p != ':') return false;
+    p = pularEspacos(p + 1, fim);
+    if (p >= fim) return false;
+
+    const char *valor;
+    char seguinte;
+    if (*p == '"') {
+      valor = lerTextoJson(p, fim);
+      if (!valor) return false;
+      p = pularEspacos(p, fim);
+      if (p >= fim) return false;
+      seguinte = *p;
+    } else if (*p == '{' || *p == '[') {
+      return false;
+    } else {
+      // número ou literal: termina no lugar do delimitador, guardado antes
+      char *ini = p;
+      while (p < fim && *p != ',' && *p != '}' && !isspace((unsigned char)*p)) p++;
+      if (p == ini || p >= fim) return false;
+      seguinte = *p;
+      *p = '\0';
+      if (isspace((unsigned char)seguinte)) {
+        p = pularEspacos(p + 1, fim);
+        if (p >= fim) return false;
+        seguinte = *p;
+      }
+      valor = (strcmp(ini, "null") == 0) ? NULL : ini;
+    }
+
+    if (n < max) {
+      campos[n].nome  = nome;
+      campos[n].valor = valor;
+      n++;
+    }
+    if (seguinte == '}') return true;
+    if (seguinte != ',') return false;
+    p = pularEspacos(p + 1, fim);
+  }
+  return false;
+}
+
+static const char *campoJson(const CampoJson *campos, uint8_t n, const char *nome) {
+  for (uint8_t i = 0; i < n; i++) {
+    if (strcmp(campos[i].nome, nome) == 0) return campos[i].valor;
+  }
+  return NULL;
+}
+
+// Comando longo esperando o loop(): cópia dos argumentos, porque o payload
+// é reaproveitado pelo PubSubClient na próxima mensagem
+struct TarefaComando {
+  const Comando *comando;
+  char           id[ID_REQUISICAO_MAX + 1];
+  int8_t         formato;                    // "format" do pedido (FORMATO_NENHUM = do canal)
+  int8_t         valor[COMANDO_MAX_ARGS];   // posição em 'dados' (-1 = ausente)
+  char           dados[COMANDO_DADOS_MAX];
+};
+
+static QueueHandle_t filaComandos = NULL;
+
+bool inicializarComandos() {
+  if (filaComandos == NULL) {
+    filaComandos = xQueueCreate(FILA_COMANDOS_TAM, sizeof(TarefaComando));
+  }
+  if (filaComandos == NULL) {
+    LOG_ERRO("ERRO: nao foi possivel criar filaComandos!");
+    return false;
+  }
+  return true;
+}
+
+static bool enfileirarComando(const Comando &c, const ArgsComando &a, const char *id, int8_t formato) {
+  TarefaComando t;
+  t.comando = &c;
+  t.formato = formato;
+  snprintf(t.id, sizeof(t.id), "%s", id ? id : "");
+  size_t usado = 0;
+  for (uint8_t i = 0; i < COMANDO_MAX_ARGS; i++) {
+    t.valor[i] = -1;
+    if (i >= a.n || !a.valores[i]) continue;
+    size_t tam = strlen(a.valores[i]) + 1;
+    if (usado + tam > sizeof(t.dados)) return false;
+    memcpy(t.dados + usado, a.valores[i], tam);
+    t.valor[i] = (int8_t)usado;
+    usado += tam;
+  }
+  return filaComandos != NULL && xQueueSend(filaComandos, &t, 0) == pdTRUE;
+}
+
+bool continuarNoLoop(const Comando &c) {
+  ArgsComando a;
+  a.origem = ORIGEM_MQTT;
+  a.n      = 0;
+  if (!enfileirarComando(c, a, idAtual, formatoAtual)) return false;
+  continuaAtual = true;
+  return true;
+}
+
+void recusarComandoAtual(const char *motivo) {
+  recusaAtual = motivo;
+}
+
+bool processarProximoComando() {
+  TarefaComando t;
+  if (filaComandos == NULL || xQueueReceive(filaComandos, &t, 0) != pdTRUE) return false;
+
+  const Comando &c = *t.comando;
+  ArgsComando a;
+  a.origem = ORIGEM_MQTT;
+  a.n      = 0;
+  for (uint8_t i = 0; i < COMANDO_MAX_ARGS && c.args[i].nome; i++) {
+    a.nomes[a.n]   = c.args[i].nome;
+    a.valores[a.n] = t.valor[i] >= 0 ? t.dados + t.valor[i] : NULL;
+    a.n++;
+  }
+  executarComando(c, a, t.id, t.formato);
+  return true;
+}
+
+// O payload chega no buffer do próprio PubSubClient, que pode ser escrito:
+// o parser termina as strings ali mesmo. Comandos longos só são enfileirados.
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  LOG_DEBUG("MQTT mensagem recebida em [%s]: %.*s", topic, (int)length, (const char*)payload);
+
+  if (strcmp(topic, MQTT_TOPIC_CMD) != 0 && strcmp(topic, MQTT_TOPIC_CMD_TODAS) != 0) return;
+
+  CampoJson campos[JSON_MAX_CAMPOS];
+  uint8_t   numCampos;
+  if (!lerObjetoJson((char*)payload, length, campos, JSON_MAX_CAMPOS, numCampos)) {
+    LOG_AVISO("JSON invalido no comando MQTT");
+    return;
+  }
+
+  const char* cmd = campoJson(campos, numCampos, "cmd");
+  if (!cmd) return;
+
+  const char *id = campoJson(campos, numCampos, "id");
+  if (id && !idValido(id)) {
+    LOG_AVISO("Comando MQTT %s: id invalido ignorado", cmd);
+    id = NULL;
+  }
+
+  // "format": json|msgpack para as respostas deste pedido
+  const char *textoFormato = campoJson(campos, numCampos, "format");
+  FormatoCarga formatoPedido;
+  int8_t formato = FORMATO_NENHUM;
+  bool formatoOk = !textoFormato || formatoPorNome(textoFormato, formatoPedido);
+  if (textoFormato && formatoOk) formato = (int8_t)formatoPedido;
+
+  const Comando *c = buscarComando(cmd);
+  if (!c) {
+    LOG_AVISO("Comando MQTT desconhecido: %s", cmd);
+    publicarAckComando(cmd, id, formato, "error", "unknown_cmd");
+    return;
+  }
+
+  ArgsComando a;
+  a.origem = ORIGEM_MQTT;
+  a.n      = 0;
+  for (uint8_t i = 0; i < COMANDO_MAX_ARGS && c->args[i].nome; i++) {
+    a.nomes[a.n]   = c->args[i].nome;
+    a.valores[a.n] = campoJson(campos, numCampos, c->args[i].nome);
+    a.n++;
+  }
+
+  const char *invalido = formatoOk ? validarArgs(*c, a) : "format";
+  if (invalido) {
+    LOG_AVISO("Comando MQTT %s: argumento '%s' ausente ou invalido", cmd, invalido);
+    publicarAckComando(cmd, id, formato, "error", "bad_args");
+    return;
+  }
+
+  if (!(c->flags & COMANDO_LONGO)) {
+    executarComando(*c, a, id, formato);
+    return;
+  }
+
+  if (!enfileirarComando(*c, a, id, formato)) {
+    LOG_AVISO("Comando MQTT %s descartado: filaComandos cheia", cmd);
+    publicarAckComando(cmd, id, formato, "error", "busy");
+    return;
+  }
+  publicarAckComando(cmd, id, formato, "queued");
+}
+
+// ======================= Serial =======================
+
+void mostrarAjudaComandos() {
+  Serial.println("Comandos na Serial (uma linha cada; ENTER executa):");
+  for (size_t i = 0; i < NUM_COMANDOS; i++) {
+    const Comando &c = COMANDOS[i];
+    if (!c.ajuda) continue;
+
+    String uso = "'";
+    if (c.letra) uso += c.letra;
+    else         uso += c.nome;
+    uso += usoArgs(c);
+    uso += "' = ";
+    uso += c.ajuda;
+    if (c.nome && c.letra) {
+      uso += "  [MQTT: ";
+      uso += c.nome;
+      uso += "]";
+    }
+    Serial.println(uso);
+  }
+  Serial.println("'?' = esta ajuda");
+}
+
+static void executarLinhaConsole(char *linha) {
+  // separa em tokens no próprio buffer
+  char *tokens[COMANDO_MAX_ARGS + 1];
+  uint8_t numTokens = 0;
+  char *p = linha;
+  while (*p && numTokens < COMANDO_MAX_ARGS + 1) {
+    while (*p == ' ' || *p == '\t') *p++ = '\0';
+    if (!*p) break;
+    tokens[numTokens++] = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+  }
+  if (numTokens == 0) return;
+
+  const Comando *c = buscarComandoSerial(tokens[0]);
+  if (!c) {
+    Serial.print("Comando desconhecido: ");
+    Serial.print(tokens[0]);
+    Serial.println(" ('?' mostra a ajuda)");
+    return;
+  }
+
+  ArgsComando a;
+  a.origem = ORIGEM_SERIAL;
+  a.n      = 0;
+  for (uint8_t i = 0; i < COMANDO_MAX_ARGS && c->args[i].nome; i++) {
+    a.nomes[a.n]   = c->args[i].nome;
+    a.valores[a.n] = (1 + i < numTokens) ? tokens[1 + i] : NULL;
+    a.n++;
+  }
+
+  if (validarArgs(*c, a)) {
+    Serial.print("Uso: ");
+    Serial.print(tokens[0]);
+    Serial.println(usoArgs(*c));
+    return;
+  }
+
+  executarComando(*c, a, NULL, FORMATO_NENHUM);
+}
+
+static char   linhaConsole[CONSOLE_LINHA_MAX + 1];
+static size_t tamLinhaConsole   = 0;
+static bool   linhaConsoleLonga = false;
+
+void processarConsoleSerial() {
+  while (Serial.available()) {
+    int ch = Serial.read();
+    if (ch < 0) break;
+
+    if (ch == '\n' || ch == '\r') {
+      if (linhaConsoleLonga) {
+        Serial.println("Linha muito longa, ignorada.");
+      } else if (tamLinhaConsole) {
+        linhaConsole[tamLinhaConsole] = '\0';
+        executarLinhaConsole(linhaConsole);
+      }
+      tamLinhaConsole   = 0;
+      linhaConsoleLonga = false;
+      continue;
+    }
+
+    if (tamLinhaConsole < CONSOLE_LINHA_MAX) linhaConsole[tamLinhaConsole++] = (char)ch;
+    else                                     linhaConsoleLonga = true;
+  }
+}
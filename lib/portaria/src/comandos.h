@@ -0,0 +1,93 @@
+// Comandos recebidos via MQTT (portaria/comandos) e via Serial.
+//
+// Os dois caminhos usam a mesma tabela (nome MQTT, atalho de uma letra na
+// Serial, argumentos com tipo). Na Serial cada comando é uma linha: o atalho
+// ou o nome seguido dos argumentos separados por espaço, por exemplo
+// "d a1b2c3d4", "h a1b2c3d4 1" ou "set_late_cutoff 08:20 a1b2c3d4".
+//
+// No MQTT o JSON é lido direto no buffer do PubSubClient, sem cópia. Comandos
+// marcados COMANDO_LONGO vão para a filaComandos e rodam no loop() depois
+// que o callback retorna. Se o pedido tiver "id", ele volta nas respostas e
+// num {"context":"cmd","cmd":...,"id":...,"status":...} em portaria/status.
+// "format" (json|msgpack) escolhe o formato dessas respostas (serializador.h).
+#pragma once
+
+#include <Arduino.h>
+
+#include "serializador.h"
+
+#define COMANDO_MAX_ARGS    4
+#define CONSOLE_LINHA_MAX   64
+#define ID_REQUISICAO_MAX   23     // "id" maior ou com caractere fora de [A-Za-z0-9_-] é ignorado
+#define FILA_COMANDOS_TAM   4
+#define COMANDO_DADOS_MAX   96     // soma dos argumentos de um comando na filaComandos
+#define FORMATO_NENHUM      (-1)   // pedido sem "format": vale o do canal
+
+enum OrigemComando {
+  ORIGEM_SERIAL,
+  ORIGEM_MQTT
+};
+
+enum TipoArg {
+  ARG_TEXTO,
+  ARG_INTEIRO
+};
+
+struct ArgComando {
+  const char *nome;
+  TipoArg     tipo;
+  bool        obrigatorio;
+};
+
+#define COMANDO_LONGO  0x01   // pode levar segundos: sai do callback MQTT
+
+// Argumentos já validados; os ponteiros valem só durante o tratamento
+struct ArgsComando {
+  OrigemComando origem;
+  uint8_t       n;
+  const char   *nomes[COMANDO_MAX_ARGS];
+  const char   *valores[COMANDO_MAX_ARGS];
+
+  const char *texto(const char *nome, const char *padrao = NULL) const;
+  int         inteiro(const char *nome, int padrao) const;
+};
+
+struct Comando {
+  const char *nome;                        // "cmd" no MQTT (NULL = só Serial)
+  char        letra;                       // atalho na Serial ('\0' = nenhum)
+  ArgComando  args[COMANDO_MAX_ARGS];      // na ordem da Serial
+  uint8_t     flags;
+  void      (*tratar)(const ArgsComando &a);
+  const char *ajuda;
+};
+
+const Comando *buscarComando(const char *nome);          // pelo nome MQTT
+const Comando *buscarComandoSerial(const char *token);   // atalho ou nome
+
+// Cria a filaComandos. Chamado por inicializarPortaria().
+bool inicializarComandos();
+
+void mqttCallback(char* topic, byte* payload, unsigned int length);
+
+// Parte do loop(): executa um comando longo pendente. false se não havia nenhum.
+bool processarProximoComando();
+
+// Chamado de dentro do tratamento de um comando: o resto do trabalho vai para
+// a filaComandos como c.tratar (sem argumentos), com o mesmo "id" e "format".
+// O pedido atual responde "queued" em vez de "done". false com a fila cheia.
+bool continuarNoLoop(const Comando &c);
+
+// Chamado de dentro do tratamento: o pedido atual responde "error" com
+// "reason":motivo em vez de "done"/"queued"
+void recusarComandoAtual(const char *motivo);
+
+// "id" do pedido MQTT em execução ("" se não houver), para as respostas
+const char *idRequisicaoAtual();
+// "format" do pedido MQTT em execução; false se não veio
+bool formatoRequisicaoAtual(FormatoCarga &formato);
+
+void mostrarAjudaComandos();
+
+// Parte do loop(): junta o que chegou na Serial até '\n' e executa a linha.
+// Nunca espera por entrada; uma linha pode chegar aos pedaços em vários loops.
+void processarConsoleSerial();
@@ -0,0 +1,44 @@
+// Pinos, arquivos e tópicos MQTT da portaria.
+#pragma once
+
+#include <stdint.h>
+
+// Variáveis das LEDs e Arquivos
+#define LED_RED     27
+#define LED_GREEN    4
+#define LED_YELLOW  22
+
+extern const char* CARDS_FILE;
+extern const char* ADMINS_FILE;
+extern const char* MOVIMENTACOES_FILE;
+extern const char* MOVIMENTACOES_IDX;
+extern const char* CHECKPOINT_FILE;
+
+#define UID_MAX_LEN   20    // UID de até 10 bytes em hex
+
+#define FILA_CARTOES_TAM  8
+
+#define MOV_SEM_HORA_MAX  32   // movimentações antes do NTP que ainda ganham data/hora de parede
+
+#define MQTT_RETENTATIVA_MIN_MS   2000UL    // espera entre tentativas de conectar no broker,
+#define MQTT_RETENTATIVA_MAX_MS  60000UL    // dobrando a cada falha até o máximo
+
+#define CHECKPOINT_REGISTROS     50         // checkpoint do estado derivado a cada 50 movimentações
+#define CHECKPOINT_INTERVALO_MS  600000UL   // ou a cada 10 min, se houver alguma ainda fora dele
+
+#define MQTT_BUFFER_TAM  1024   // envio e recepção; o padrão do PubSubClient (256) não comporta roster_import
+
+#define TELEMETRIA_INTERVALO_MS  60000UL   // no máximo um envio em MQTT_TOPIC_METRICS por minuto
+
+// --------- MQTT CONFIG ---------
+extern const char*    PORTARIA_ID;
+extern const char*    MQTT_BROKER;
+extern const uint16_t MQTT_PORT;
+extern const char*    MQTT_CLIENT_ID;
+extern const char*    MQTT_TOPIC_MOV;
+extern const char*    MQTT_TOPIC_CMD;
+extern const char*    MQTT_TOPIC_STATUS;
+extern const char*    MQTT_TOPIC_INSIDE;
+extern const char*    MQTT_TOPIC_METRICS;
+extern const char*    MQTT_TOPIC_ESTADO;
+extern const char*    MQTT_TOPIC_CMD_TODAS;
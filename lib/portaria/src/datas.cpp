@@ -0,0 +1,145 @@
+#include "datas.h"
+
+#include "log_serial.h"
+
+#include <atomic>
+
+// =========== Datas como número de dias ===========
+// As consultas trabalham com "dias desde 01/01/1970" (inteiro), calculado só
+// com aritmética do calendário civil (algoritmo days_from_civil de H. Hinnant),
+// sem getLocalTime/mktime/localtime por linha do log.
+int32_t diasDesdeEpoch(int ano, int mes, int dia) {
+  ano -= (mes <= 2);
+  const int32_t era = (ano >= 0 ? ano : ano - 399) / 400;
+  const int32_t yoe = ano - era * 400;                                  // [0, 399]
+  const int32_t doy = (153 * (mes + (mes > 2 ? -3 : 9)) + 2) / 5 + dia - 1; // [0, 365]
+  const int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;            // [0, 146096]
+  return era * 146097 + doe - 719468;
+}
+
+// 0=Domingo, 1=Segunda, ..., 6=Sabado (01/01/1970 foi quinta-feira)
+int diaSemanaFromDiaNum(int32_t diaNum) {
+  return (int)(((diaNum % 7) + 11) % 7);
+}
+
+// "dd/mm/aaaa" -> dias desde epoch, lendo os dígitos direto. -1 se inválida.
+int32_t diaNumFromStr(const char *p, size_t len) {
+  if (len < 10 || p[2] != '/' || p[5] != '/') return -1;
+
+  static const uint8_t posDigitos[8] = { 0, 1, 3, 4, 6, 7, 8, 9 };
+  for (int i = 0; i < 8; i++) {
+    char c = p[posDigitos[i]];
+    if (c < '0' || c > '9') return -1;
+  }
+
+  int dia = (p[0] - '0') * 10 + (p[1] - '0');
+  int mes = (p[3] - '0') * 10 + (p[4] - '0');
+  int ano = (p[6] - '0') * 1000 + (p[7] - '0') * 100 + (p[8] - '0') * 10 + (p[9] - '0');
+  if (dia < 1 || dia > 31 || mes < 1 || mes > 12 || ano == 0) return -1;
+
+  return diasDesdeEpoch(ano, mes, dia);
+}
+
+int32_t diaNumFromStr(const String &dataStr) {
+  return diaNumFromStr(dataStr.c_str(), dataStr.length());
+}
+
+int32_t diaNumFromTm(const struct tm &t) {
+  return diasDesdeEpoch(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+}
+
+// Inverso de diasDesdeEpoch (civil_from_days, mesmo algoritmo)
+void dataFromDiaNum(int32_t diaNum, int &ano, int &mes, int &dia) {
+  diaNum += 719468;
+  const int32_t era = (diaNum >= 0 ? diaNum : diaNum - 146096) / 146097;
+  const int32_t doe = diaNum - era * 146097;                                 // [0, 146096]
+  const int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+  const int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);               // [0, 365]
+  const int32_t mp  = (5 * doy + 2) / 153;                                   // [0, 11]
+  dia = doy - (153 * mp + 2) / 5 + 1;
+  mes = mp < 10 ? mp + 3 : mp - 9;
+  ano = yoe + era * 400 + (mes <= 2);
+}
+
+// relogioSincronizado() é chamado do loop() e da tarefa dos cartões
+static std::atomic<bool>     relogioOk(false);
+static std::atomic<bool>     relogioJaTestado(false);
+static std::atomic<uint32_t> relogioUltimoTeste(0);
+
+// Helpers de data/hora
+// getLocalTime() com espera 0: sem NTP o padrão (5 s) segurava cada registro
+bool obterDataHoraAtual(String &dataStr, String &horaStr) {
+  struct tm timeinfo;
+  if (!getLocalTime(&timeinfo, 0)) {
+    LOG_AVISO("Falha ao obter data/hora do sistema (sem NTP?).");
+    return false;
+  }
+
+  char bufData[11];
+  char bufHora[9];
+
+  strftime(bufData, sizeof(bufData), "%d/%m/%Y", &timeinfo);
+  strftime(bufHora, sizeof(bufHora), "%H:%M:%S", &timeinfo);
+
+  dataStr = String(bufData);
+  horaStr = String(bufHora);
+  // já marca aqui: sem isso, por até 1 s depois do NTP um registro com data
+  // entrava no índice antes das pendências sem hora (que ficavam de fora)
+  relogioOk = true;
+  return true;
+}
+
+// Sem NTP o getLocalTime() ainda dorme ~10 ms por chamada: testa no máximo
+// uma vez por segundo e, depois que sincronizou, não testa mais.
+bool relogioSincronizado() {
+  if (relogioOk) return true;
+  uint32_t agora = millis();
+  if (relogioJaTestado && agora - relogioUltimoTeste < 1000) return false;
+  relogioJaTestado   = true;
+  relogioUltimoTeste = agora;
+
+  struct tm t;
+  if (getLocalTime(&t, 0)) relogioOk = true;
+  return relogioOk;
+}
+
+bool dataHoraDeMillis(uint32_t ms, String &dataStr, String &horaStr) {
+  struct tm agora;
+  if (!getLocalTime(&agora, 0)) return false;
+
+  int64_t seg = (int64_t)diaNumFromTm(agora) * 86400 +
+                agora.tm_hour * 3600 + agora.tm_min * 60 + agora.tm_sec;
+  seg -= (uint32_t)(millis() - ms) / 1000;
+
+  int32_t diaNum = (int32_t)(seg / 86400);
+  int32_t noDia  = (int32_t)(seg % 86400);
+  int ano, mes, dia;
+  dataFromDiaNum(diaNum, ano, mes, dia);
+
+  char bufData[16];
+  char bufHora[12];
+  snprintf(bufData, sizeof(bufData), "%02d/%02d/%04d", dia, mes, ano);
+  snprintf(bufHora, sizeof(bufHora), "%02d:%02d:%02d",
+           (int)(noDia / 3600), (int)((noDia / 60) % 60), (int)(noDia % 60));
+  dataStr = String(bufData);
+  horaStr = String(bufHora);
+  return true;
+}
+
+// =========== Semana atual (SEG–SEX) como intervalo de dias ===========
+// Calcula [segunda, sexta] uma vez por consulta; depois cada linha do log
+// custa só uma comparação de inteiros.
+bool semanaAtualDiaNum(int32_t &segunda, int32_t &sexta) {
+  struct tm hoje;
+  if (!getLocalTime(&hoje, 0)) {
+    LOG_AVISO("semanaAtualDiaNum: falha ao obter hora atual.");
+    return false;
+  }
+
+  int32_t diaHoje = diaNumFromTm(hoje);
+  // Diff até segunda-feira: (0..6) -> (6,0,1,2,3,4,5) para Dom..Sab
+  int diffToMonday = (diaSemanaFromDiaNum(diaHoje) + 6) % 7;
+  segunda = diaHoje - diffToMonday;
+  sexta   = segunda + 4;
+  return true;
+}
@@ -0,0 +1,21 @@
+// Datas do log como número de dias e helpers de data/hora do relógio (NTP).
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+int32_t diasDesdeEpoch(int ano, int mes, int dia);
+int     diaSemanaFromDiaNum(int32_t diaNum);      // 0=Domingo ... 6=Sabado
+int32_t diaNumFromStr(const char *p, size_t len); // "dd/mm/aaaa", -1 se inválida
+int32_t diaNumFromStr(const String &dataStr);
+int32_t diaNumFromTm(const struct tm &t);
+void    dataFromDiaNum(int32_t diaNum, int &ano, int &mes, int &dia);
+
+bool obterDataHoraAtual(String &dataStr, String &horaStr);
+
+// Já tem hora de parede (NTP)? Não espera a sincronização: antes dela os
+// registros levam millis() e são corrigidos depois com dataHoraDeMillis().
+bool relogioSincronizado();
+// Data/hora de parede de um instante passado dado em millis(); false sem NTP
+bool dataHoraDeMillis(uint32_t ms, String &dataStr, String &horaStr);
+bool semanaAtualDiaNum(int32_t &segunda, int32_t &sexta);
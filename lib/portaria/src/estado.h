@@ -0,0 +1,47 @@
+// Estado compartilhado entre o loop, o callback MQTT e a TaskProcessaCartoes.
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522v2.h>
+#include <PubSubClient.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "config.h"
+
+// Definidos pelo programa (src/main.cpp no ESP32, src/host no PC)
+extern MFRC522      mfrc522;
+extern PubSubClient mqttClient;
+
+// Item da filaCartoes: copiado byte a byte pela fila, então não pode ter String
+struct EventoCartao {
+  char     uid[UID_MAX_LEN + 1];
+  uint32_t detectadoUs;    // micros() quando o leitor devolveu o UID
+  uint32_t enfileiradoUs;  // micros() logo antes do xQueueSend
+};
+
+// Fila e semáforos
+extern QueueHandle_t     filaCartoes;
+extern SemaphoreHandle_t semAcessoLiberado;
+extern SemaphoreHandle_t mtxEstado;   // protege as tabelas derivadas do log (presença, atrasos)
+
+// --------- ESTADO DE MODO / ENTRADA / SAÍDA ---------
+enum TipoOperacao {
+  MODO_ENTRADA,
+  MODO_SAIDA
+};
+
+extern TipoOperacao modoAtual;
+
+// ENTRADA: primeiro cartão = usuário, depois funcionário
+extern bool   aguardandoSegundoEntrada;
+extern String uidUsuarioEntradaPendente;
+
+// SAÍDA: primeiro cartão = funcionário, depois usuário
+extern bool   aguardandoSegundoSaida;
+extern String uidFuncionarioSaidaPendente;
+
+// Só processa leitura de cartão quando TRUE
+extern bool leituraHabilitada;
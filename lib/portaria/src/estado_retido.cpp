@@ -0,0 +1,282 @@
+#include "estado_retido.h"
+
+#include "armazenamento.h"
+#include "config.h"
+#include "datas.h"
+#include "estado.h"
+#include "log_serial.h"
+#include "movimentacoes.h"
+#include "relatorios.h"
+
+struct UltimaMov {
+  uint32_t offset;
+  char     func[UID_MAX_LEN + 1];
+  char     user[UID_MAX_LEN + 1];
+  char     data[11];
+  char     hora[9];
+  bool     entrada;
+  bool     ocupada;
+};
+
+// O que está retido no broker em estado/dentro/<uid>
+struct DentroRetido {
+  char uid[UID_MAX_LEN + 1];
+  int  count;
+};
+
+// Tudo abaixo sob mtxEstado
+static int32_t      diaCarregado = -1;   // dia dos contadores; -1 = ainda não lido do log neste boot
+static char         dataCarregada[11] = "";
+static uint32_t     entradasHoje = 0;
+static uint32_t     saidasHoje   = 0;
+static UltimaMov    ultimas[ESTADO_ULTIMOS];
+static uint32_t     numUltimas = 0;      // a próxima vai em numUltimas % ESTADO_ULTIMOS
+static DentroRetido *dentroRetido = NULL;   // cresce com garantirCapacidade (relatorios.h)
+static size_t        capDentroRetido = 0;
+static int           numDentroRetido = 0;
+
+static volatile bool carregar     = false;   // ler o dia do log no próximo manterEstadoRetido()
+static volatile bool publicarTudo = false;
+
+static void travar()    { if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY); }
+static void destravar() { if (mtxEstado) xSemaphoreGive(mtxEstado); }
+
+static void copiarTexto(char *dst, size_t cap, const char *src, size_t len) {
+  if (len >= cap) len = cap - 1;
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+static void guardarUltima(UltimaMov *vetor, uint32_t &n, uint32_t offset, const char *func, size_t lenFunc,
+                          const char *user, size_t lenUser, bool entrada,
+                          const char *data, size_t lenData, const char *hora, size_t lenHora) {
+  UltimaMov &u = vetor[n++ % ESTADO_ULTIMOS];
+  u.offset  = offset;
+  u.entrada = entrada;
+  u.ocupada = true;
+  copiarTexto(u.func, sizeof(u.func), func, lenFunc);
+  copiarTexto(u.user, sizeof(u.user), user, lenUser);
+  copiarTexto(u.data, sizeof(u.data), data, lenData);
+  copiarTexto(u.hora, sizeof(u.hora), hora, lenHora);
+}
+
+static uint32_t totalDentroRetido() {
+  uint32_t total = 0;
+  for (int i = 0; i < numDentroRetido; i++) total += dentroRetido[i].count;
+  return total;
+}
+
+// ======================= Publicação =======================
+
+// payload NULL = retida vazia: o broker apaga
+static void publicarRetida(const char *sufixo, const Serializador *payload) {
+  char topico[96];
+  snprintf(topico, sizeof(topico), "%s/%s", MQTT_TOPIC_ESTADO, sufixo);
+  bool ok = payload ? payload->publicar(topico, true)
+                    : mqttClient.publish(topico, (const uint8_t *)"", 0, true);
+  if (!ok) LOG_AVISO("MQTT: falha ao publicar %s", topico);
+}
+
+static void publicarHoje(const char *data, uint32_t entradas, uint32_t saidas, uint32_t dentro) {
+  char buf[128];
+  Serializador s(buf, sizeof(buf), formatoCanal(CANAL_ESTADO));
+  s.objeto().texto("portaria", PORTARIA_ID).texto("data", data);
+  s.natural("entradas", entradas).natural("saidas", saidas).natural("dentro", dentro).fechar();
+  publicarRetida("hoje", &s);
+}
+
+static void publicarDentroUid(const char *uid, int count, const char *data) {
+  char sufixo[48];
+  char buf[96];
+  snprintf(sufixo, sizeof(sufixo), "dentro/%.*s", UID_MAX_LEN, uid);
+  Serializador s(buf, sizeof(buf), formatoCanal(CANAL_ESTADO));
+  s.objeto().texto("uid", uid).inteiro("count", count).texto("data", data).fechar();
+  publicarRetida(sufixo, count > 0 ? &s : NULL);
+}
+
+// u == NULL apaga a posição (sobra de antes do boot)
+static void publicarUltima(uint32_t slot, const UltimaMov *u) {
+  char sufixo[24];
+  char buf[192];
+  snprintf(sufixo, sizeof(sufixo), "ultimos/%lu", (unsigned long)slot);
+  Serializador s(buf, sizeof(buf), formatoCanal(CANAL_ESTADO));
+  if (u) {
+    Trecho func = { u->func, strlen(u->func) }, user = { u->user, strlen(u->user) };
+    Trecho data = { u->data, strlen(u->data) }, hora = { u->hora, strlen(u->hora) };
+    serializarMovimentacao(s, u->offset, func, user, u->entrada ? "entrada" : "saída", data, hora);
+  }
+  publicarRetida(sufixo, u ? &s : NULL);
+}
+
+// Tudo de novo, da RAM; UIDs retidos que não estão mais dentro são apagados
+static void publicarEstadoCompleto() {
+  ContagemDentro *itens;
+  int numItens = 0;
+  size_t total = 0;
+  coletarUsuariosDentroHoje(itens, numItens, total);
+
+  travar();
+  char data[sizeof(dataCarregada)];
+  memcpy(data, dataCarregada, sizeof(data));
+  uint32_t entradas = entradasHoje, saidas = saidasHoje;
+
+  // retidos que não estão mais dentro: copiados para apagar fora da trava
+  DentroRetido *apagar = numDentroRetido ? (DentroRetido *)malloc(numDentroRetido * sizeof(DentroRetido)) : NULL;
+  int numApagar = 0;
+  if (numDentroRetido && !apagar) LOG_ERRO("ERRO: sem memoria para apagar os dentro/<uid> retidos.");
+  for (int i = 0; apagar && i < numDentroRetido; i++) {
+    bool ficou = false;
+    for (int k = 0; k < numItens && !ficou; k++) {
+      ficou = itens[k].ehUsuario && strcmp(itens[k].uid, dentroRetido[i].uid) == 0;
+    }
+    if (!ficou) apagar[numApagar++] = dentroRetido[i];
+  }
+  numDentroRetido = 0;
+  for (int k = 0; k < numItens; k++) {
+    if (!itens[k].ehUsuario || itens[k].count <= 0) continue;
+    if (!garantirCapacidade(dentroRetido, capDentroRetido, (size_t)numDentroRetido + 1)) {
+      LOG_ERRO("ERRO: sem memoria para a tabela de dentro retido; UID %s fora.", itens[k].uid);
+      continue;
+    }
+    DentroRetido &d = dentroRetido[numDentroRetido++];
+    memcpy(d.uid, itens[k].uid, sizeof(d.uid));
+    d.count = itens[k].count;
+  }
+  uint32_t dentro = totalDentroRetido();
+  destravar();
+
+  if (data[0]) publicarHoje(data, entradas, saidas, dentro);
+  for (int i = 0; i < numApagar; i++) publicarDentroUid(apagar[i].uid, 0, data);
+  for (int k = 0; k < numItens; k++) {
+    if (itens[k].ehUsuario && itens[k].count > 0) publicarDentroUid(itens[k].uid, itens[k].count, data);
+  }
+  free(apagar);
+  free(itens);
+  for (uint32_t s = 0; s < ESTADO_ULTIMOS; s++) {
+    travar();
+    UltimaMov u = ultimas[s];
+    destravar();
+    publicarUltima(s, u.ocupada ? &u : NULL);
+  }
+}
+
+// ======================= Movimentações =======================
+
+void anotarMovimentacaoRetida(const char *uidFunc, const char *uidUser, bool entrada,
+                              const String &dataStr, const String &horaStr, size_t offsetLinha) {
+  int32_t dia = diaNumFromStr(dataStr);
+  if (dia < 0) return;
+  if (diaCarregado < 0) {   // lido do log no loop (a linha já está lá)
+    carregar = true;
+    return;
+  }
+
+  int count = contagemDentro(uidUser, dia);
+
+  travar();
+  if (dia > diaCarregado) {
+    // dia novo: os retidos de ontem ficam com 0 e são apagados no loop
+    for (int i = 0; i < numDentroRetido; i++) dentroRetido[i].count = 0;
+    diaCarregado = dia;
+    copiarTexto(dataCarregada, sizeof(dataCarregada), dataStr.c_str(), dataStr.length());
+    entradasHoje = 0;
+    saidasHoje   = 0;
+    publicarTudo = true;
+  }
+  bool doDia = (dia == diaCarregado);
+  if (doDia) {
+    if (entrada) entradasHoje++;
+    else         saidasHoje++;
+
+    int i = 0;
+    while (i < numDentroRetido && strcmp(dentroRetido[i].uid, uidUser) != 0) i++;
+    if (i == numDentroRetido && count > 0) {
+      if (garantirCapacidade(dentroRetido, capDentroRetido, (size_t)numDentroRetido + 1)) {
+        copiarTexto(dentroRetido[i].uid, sizeof(dentroRetido[i].uid), uidUser, strlen(uidUser));
+        numDentroRetido++;
+      } else {
+        LOG_ERRO("ERRO: sem memoria para a tabela de dentro retido; UID %s fora.", uidUser);
+      }
+    }
+    if (i < numDentroRetido) {
+      dentroRetido[i].count = count;
+      if (count <= 0) dentroRetido[i] = dentroRetido[--numDentroRetido];
+    }
+  }
+  uint32_t slot = numUltimas % ESTADO_ULTIMOS;
+  guardarUltima(ultimas, numUltimas, (uint32_t)offsetLinha, uidFunc, strlen(uidFunc), uidUser, strlen(uidUser),
+                entrada, dataStr.c_str(), dataStr.length(), horaStr.c_str(), horaStr.length());
+  UltimaMov u = ultimas[slot];
+  char data[sizeof(dataCarregada)];
+  memcpy(data, dataCarregada, sizeof(data));
+  uint32_t entradas = entradasHoje, saidas = saidasHoje, dentro = totalDentroRetido();
+  destravar();
+
+  if (!mqttClient.connected()) return;   // estadoRetidoConectado() publica tudo na volta
+  if (doDia) {
+    publicarDentroUid(uidUser, count, data);
+    publicarHoje(data, entradas, saidas, dentro);
+  }
+  publicarUltima(slot, &u);
+}
+
+// Contadores e últimas do dia 'dataStr' lidos do log, a partir do índice
+static void carregarDiaDoLog(const String &dataStr) {
+  static UltimaMov lidas[ESTADO_ULTIMOS];
+  uint32_t numLidas = 0, entradas = 0, saidas = 0;
+  int32_t dia = diaNumFromStr(dataStr);
+  uint32_t t0 = millis();
+  memset(lidas, 0, sizeof(lidas));
+
+  {
+    TravaLeituraLog trava;
+    File f = abrirMovimentacoesDesde(dia);
+    if (f) {
+      LeitorLinhas leitor(f, bufLeituraLog, sizeof(bufLeituraLog));
+      Trecho linha;
+      MovLinha mov;
+      while (leitor.proxima(linha)) {
+        if (!linha.len || linha.p[0] == '#' || !parseMovLine(linha.p, linha.len, mov)) continue;
+        if (diaNumFromStr(mov.data.p, mov.data.len) != dia) continue;
+        if (mov.recebeu) entradas++;
+        else             saidas++;
+        guardarUltima(lidas, numLidas, (uint32_t)leitor.offsetLinha(), mov.func.p, mov.func.len,
+                      mov.user.p, mov.user.len, mov.recebeu,
+                      mov.data.p, mov.data.len, mov.hora.p, mov.hora.len);
+      }
+      f.close();
+    }
+  }
+
+  travar();
+  diaCarregado = dia;
+  copiarTexto(dataCarregada, sizeof(dataCarregada), dataStr.c_str(), dataStr.length());
+  entradasHoje = entradas;
+  saidasHoje   = saidas;
+  memcpy(ultimas, lidas, sizeof(ultimas));
+  numUltimas = numLidas;
+  destravar();
+  LOG_INFO("Estado retido: %lu entrada(s) e %lu saida(s) em %s lidas do log, %lu ms",
+           (unsigned long)entradas, (unsigned long)saidas, dataStr.c_str(), (unsigned long)(millis() - t0));
+}
+
+void estadoRetidoConectado() {
+  if (diaCarregado < 0) carregar = true;
+  publicarTudo = true;
+}
+
+void manterEstadoRetido() {
+  if (!carregar && !publicarTudo) return;
+
+  if (carregar) {
+    if (!relogioSincronizado()) return;   // espera o NTP
+    String dataStr, horaStr;
+    if (!obterDataHoraAtual(dataStr, horaStr)) return;
+    carregar = false;   // uma movimentação durante a leitura pede outra
+    carregarDiaDoLog(dataStr);
+    publicarTudo = true;
+  }
+  if (!mqttClient.connected()) return;
+  publicarTudo = false;
+  publicarEstadoCompleto();
+}
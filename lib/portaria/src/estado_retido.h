@@ -0,0 +1,33 @@
+// Estado da portaria em mensagens retidas no broker, para o painel abrir com
+// tudo na hora sem pedir nada à portaria (nem varrer a flash):
+//
+//   portaria/<id>/estado/hoje            {"data":...,"entradas":N,"saidas":N,"dentro":N}
+//   portaria/<id>/estado/dentro/<uid>    {"uid":...,"count":N,"data":...}; vazia = saiu
+//   portaria/<id>/estado/ultimos/<k>     uma das ESTADO_ULTIMOS últimas movimentações
+//                                        (mesmo JSON de portaria/<id>/movimentacoes)
+//
+// Cada movimentação publica só o que mudou: o contador do dia, o UID que
+// entrou/saiu e uma posição de "ultimos" (k = n % ESTADO_ULTIMOS). O painel
+// assina portaria/+/estado/# e ordena "ultimos" por data/hora/offset.
+//
+// A cada conexão com o broker tudo é publicado de novo a partir da RAM (o
+// que mudou desconectado, UIDs que saíram, posições vazias de "ultimos").
+// Depois de um boot os contadores e as últimas do dia são lidos uma vez do
+// log, a partir do índice do dia. Um dentro/<uid> retido antes do boot pode
+// sobrar: o painel ignora os que têm "data" diferente da de estado/hoje.
+#pragma once
+
+#include <Arduino.h>
+
+#define ESTADO_ULTIMOS  10
+
+// Depois de gravar uma movimentação com data/hora de parede (já aplicada no
+// estado derivado). Chamada com ou sem broker.
+void anotarMovimentacaoRetida(const char *uidFunc, const char *uidUser, bool entrada,
+                              const String &dataStr, const String &horaStr, size_t offsetLinha);
+
+// MQTT (re)conectado: o próximo manterEstadoRetido() publica tudo
+void estadoRetidoConectado();
+
+// Parte do loop(): carrega o dia do log quando preciso e publica o que estiver pendente
+void manterEstadoRetido();
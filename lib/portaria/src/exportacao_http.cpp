@@ -0,0 +1,381 @@
+#include "exportacao_http.h"
+
+#include <WiFi.h>
+
+#include "armazenamento.h"
+#include "config.h"
+#include "datas.h"
+#include "log_serial.h"
+#include "movimentacoes.h"
+#include "serializador.h"
+
+enum EtapaExportacao {
+  EXPORTACAO_LIVRE,
+  EXPORTACAO_PEDIDO,    // lendo linha do pedido e cabeçalhos
+  EXPORTACAO_ENVIANDO
+};
+
+enum FormatoExportacao {
+  EXPORTAR_TXT,
+  EXPORTAR_CSV,
+  EXPORTAR_NDJSON
+};
+
+// "XXX\r\n" antes dos dados do pedaço, "\r\n" depois
+#define CHUNK_RESERVA  8
+#define SAIDA_MAX      1400   // dados por pedaço (cabe num segmento TCP)
+#define LINHA_MAX      256    // uma linha do CSV/NDJSON
+
+static WiFiServer        servidor(EXPORTACAO_HTTP_PORTA);
+static bool              servidorIniciado = false;
+static WiFiClient        cliente;
+static EtapaExportacao   etapa = EXPORTACAO_LIVRE;
+static FormatoExportacao formato;
+static uint32_t          inicioMs;
+
+static char   pedido[EXPORTACAO_PEDIDO_MAX + 1];
+static size_t lenPedido;
+
+static File     arquivo;
+static size_t   pos, fim;          // trecho do log ainda por enviar
+static int32_t  diaDesde;          // -1 = sem since
+static bool     cabecalhoCsv;      // falta a primeira linha do CSV
+static uint32_t bytesEnviados;
+
+static char bufLog[EXPORTACAO_BLOCO];
+static char bufSaida[CHUNK_RESERVA + SAIDA_MAX + 2];
+
+// ======================= Respostas =======================
+
+static void encerrar() {
+  if (arquivo) arquivo.close();
+  cliente.stop();
+  etapa = EXPORTACAO_LIVRE;
+}
+
+static void responderErro(int codigo, const char *texto, const char *extra = NULL) {
+  char resp[256];
+  int n = snprintf(resp, sizeof(resp),
+                   "HTTP/1.1 %d %s\r\nContent-Type: text/plain; charset=utf-8\r\n%s"
+                   "Content-Length: %u\r\nConnection: close\r\n\r\n%s\n",
+                   codigo, texto, extra ? extra : "", (unsigned)strlen(texto) + 1, texto);
+  cliente.write((const uint8_t *)resp, n);
+  LOG_AVISO("HTTP: %d %s", codigo, texto);
+  encerrar();
+}
+
+// Um pedaço do chunked com os 'n' bytes em bufSaida + CHUNK_RESERVA
+static bool enviarPedaco(size_t n) {
+  char cab[CHUNK_RESERVA];
+  int  k = snprintf(cab, sizeof(cab), "%x\r\n", (unsigned)n);
+  char *ini = bufSaida + CHUNK_RESERVA - k;
+  memcpy(ini, cab, k);
+  memcpy(bufSaida + CHUNK_RESERVA + n, "\r\n", 2);
+  size_t total = k + n + 2;
+  if (cliente.write((const uint8_t *)ini, total) != total) return false;
+  bytesEnviados += n;
+  return true;
+}
+
+// ======================= Pedido =======================
+
+// dd/mm/aaaa ou aaaa-mm-dd (com %2F no lugar da barra)
+static int32_t lerDiaDesde(const char *p, size_t len) {
+  char   data[11];
+  size_t n = 0;
+  for (size_t i = 0; i < len && n < sizeof(data) - 1; i++) {
+    if (p[i] == '%' && i + 2 < len && p[i + 1] == '2' && (p[i + 2] == 'F' || p[i + 2] == 'f')) {
+      data[n++] = '/';
+      i += 2;
+    } else {
+      data[n++] = p[i];
+    }
+  }
+  data[n] = '\0';
+  if (n == 10 && data[4] == '-' && data[7] == '-') {
+    int ano = atoi(data), mes = atoi(data + 5), dia = atoi(data + 8);
+    if (mes < 1 || mes > 12 || dia < 1 || dia > 31) return -1;
+    return diasDesdeEpoch(ano, mes, dia);
+  }
+  return diaNumFromStr(data, n);
+}
+
+// "Range: bytes=a-b" sobre 'total' bytes. 0 = sem Range (ou não entendido:
+// responde inteiro), 1 = ok, -1 = fora do arquivo (416)
+static int lerRange(const char *cabecalhos, size_t total, size_t &a, size_t &b) {
+  const char *r = cabecalhos;
+  while ((r = strchr(r, '\n')) != NULL) {
+    r++;
+    if (strncasecmp(r, "Range:", 6) == 0) break;
+  }
+  if (!r) return 0;
+  r += 6;
+  while (*r == ' ') r++;
+  if (strncmp(r, "bytes=", 6) != 0) return 0;
+  r += 6;
+
+  char *fimNum;
+  if (*r == '-') {                        // últimos n bytes
+    unsigned long n = strtoul(r + 1, &fimNum, 10);
+    if (fimNum == r + 1 || n == 0) return -1;
+    a = n >= total ? 0 : total - n;
+    b = total ? total - 1 : 0;
+    return total ? 1 : -1;
+  }
+  unsigned long ini = strtoul(r, &fimNum, 10);
+  if (fimNum == r || *fimNum != '-') return 0;
+  r = fimNum + 1;
+  unsigned long ult = strtoul(r, &fimNum, 10);
+  if (fimNum == r) ult = total ? total - 1 : 0;   // "a-": até o fim
+  if (ini >= total || ult < ini) return -1;
+  a = ini;
+  b = ult >= total ? total - 1 : ult;
+  return 1;
+}
+
+static void atenderPedido() {
+  // "GET /caminho?consulta HTTP/1.1"
+  char *sp1 = strchr(pedido, ' ');
+  char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : NULL;
+  if (!sp1 || !sp2) {
+    responderErro(400, "Bad Request");
+    return;
+  }
+  if (sp1 - pedido != 3 || strncmp(pedido, "GET", 3) != 0) {
+    responderErro(405, "Method Not Allowed", "Allow: GET\r\n");
+    return;
+  }
+  char  *caminho  = sp1 + 1;
+  size_t lenCam   = sp2 - caminho;
+  char  *consulta = (char *)memchr(caminho, '?', lenCam);
+  size_t lenRota  = consulta ? (size_t)(consulta - caminho) : lenCam;
+
+  struct Rota {
+    const char       *caminho;
+    FormatoExportacao formato;
+    const char       *tipo;
+  };
+  static const Rota ROTAS[] = {
+    { "/movimentacoes.txt",    EXPORTAR_TXT,    "text/plain; charset=utf-8" },
+    { "/movimentacoes.csv",    EXPORTAR_CSV,    "text/csv; charset=utf-8" },
+    { "/movimentacoes.ndjson", EXPORTAR_NDJSON, "application/x-ndjson" },
+  };
+  const Rota *rota = NULL;
+  for (const Rota &r : ROTAS) {
+    if (strlen(r.caminho) == lenRota && strncmp(caminho, r.caminho, lenRota) == 0) rota = &r;
+  }
+  if (!rota) {
+    responderErro(404, "Not Found");
+    return;
+  }
+  formato = rota->formato;
+
+  diaDesde = -1;
+  if (consulta) {
+    const char *p = consulta + 1, *fimConsulta = sp2;
+    while (p < fimConsulta) {
+      const char *e = (const char *)memchr(p, '&', fimConsulta - p);
+      if (!e) e = fimConsulta;
+      if (e - p > 6 && strncmp(p, "since=", 6) == 0) {
+        diaDesde = lerDiaDesde(p + 6, e - p - 6);
+        if (diaDesde < 0) {
+          responderErro(400, "Bad Request: since=dd/mm/aaaa ou aaaa-mm-dd");
+          return;
+        }
+      }
+      p = e + 1;
+    }
+  }
+
+  arquivo = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  size_t total = arquivo ? arquivo.size() : 0;
+  pos = 0;
+  fim = total;
+
+  char extra[96] = "";
+  int  codigo    = 200;
+  if (formato == EXPORTAR_TXT) {
+    size_t a, b;
+    int range = lerRange(sp2, total, a, b);
+    if (range < 0) {
+      snprintf(extra, sizeof(extra), "Content-Range: bytes */%u\r\n", (unsigned)total);
+      responderErro(416, "Range Not Satisfiable", extra);
+      return;
+    }
+    if (range > 0) {   // o Range vale mais que o since
+      codigo = 206;
+      pos    = a;
+      fim    = b + 1;
+      snprintf(extra, sizeof(extra), "Content-Range: bytes %u-%u/%u\r\n",
+               (unsigned)a, (unsigned)b, (unsigned)total);
+    }
+  }
+  if (codigo == 200 && diaDesde >= 0) {
+    size_t off = offsetMovimentacoesDesde(diaDesde);
+    pos = off > total ? total : off;   // SIZE_MAX: nenhum dia >= since
+  }
+
+  char resp[320];
+  int  n = snprintf(resp, sizeof(resp),
+                    "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n%s%sTransfer-Encoding: chunked\r\n"
+                    "Connection: close\r\n\r\n",
+                    codigo, codigo == 206 ? "Partial Content" : "OK", rota->tipo,
+                    formato == EXPORTAR_TXT ? "Accept-Ranges: bytes\r\n" : "", extra);
+  if (cliente.write((const uint8_t *)resp, n) != (size_t)n) {
+    encerrar();
+    return;
+  }
+  LOG_INFO("HTTP: %.*s, bytes %u..%u do log", (int)lenCam, caminho, (unsigned)pos, (unsigned)fim);
+  cabecalhoCsv  = (formato == EXPORTAR_CSV);
+  bytesEnviados = 0;
+  etapa         = EXPORTACAO_ENVIANDO;
+}
+
+// ======================= Envio =======================
+
+static size_t lerLog(char *dst, size_t n) {
+  if (!arquivo) return 0;
+  TravaLeituraLog trava;   // completarMovimentacoesSemHora() reescreve linhas no lugar
+  arquivo.seek(pos);
+  return arquivo.read((uint8_t *)dst, n);
+}
+
+// Linha do log já no formato da exportação; 0 = não entra (comentário, corrompida, antes do since)
+static size_t renderizarLinha(const char *linha, size_t len, size_t offset, char *dst, size_t cap) {
+  MovLinha mov;
+  if (!len || linha[0] == '#' || !parseMovLine(linha, len, mov)) return 0;
+  if (diaDesde >= 0 && diaNumFromStr(mov.data.p, mov.data.len) < diaDesde) return 0;
+  const char *acao = mov.recebeu ? "recebeu" : "liberou";
+
+  if (formato == EXPORTAR_CSV) {
+    int n = snprintf(dst, cap, "%s,%u,%.*s,%.*s,%s,%.*s,%.*s\n", PORTARIA_ID, (unsigned)offset,
+                     (int)mov.func.len, mov.func.p, (int)mov.user.len, mov.user.p, acao,
+                     (int)mov.data.len, mov.data.p, (int)mov.hora.len, mov.hora.p);
+    return (n > 0 && (size_t)n < cap) ? n : 0;
+  }
+  Serializador s(dst, cap - 1, FORMATO_JSON);
+  serializarMovimentacao(s, offset, mov.func, mov.user, acao, mov.data, mov.hora);
+  if (!s.ok()) return 0;
+  dst[s.tamanho()] = '\n';
+  return s.tamanho() + 1;
+}
+
+// Próximo pedaço em bufSaida; false quando não há mais nada
+static bool montarPedaco(size_t &n) {
+  char  *saida = bufSaida + CHUNK_RESERVA;
+  n = 0;
+  if (cabecalhoCsv) {
+    const char *cab = "portaria,offset,funcionario,usuario,acao,data,hora\n";
+    n = strlen(cab);
+    memcpy(saida, cab, n);
+    cabecalhoCsv = false;
+  }
+
+  while (pos < fim) {
+    size_t quer = fim - pos;
+    if (formato == EXPORTAR_TXT) {
+      if (quer > SAIDA_MAX - n) quer = SAIDA_MAX - n;
+      size_t lidos = lerLog(saida + n, quer);
+      if (lidos == 0) {   // o arquivo encolheu?
+        fim = pos;
+        break;
+      }
+      pos += lidos;
+      n   += lidos;
+      return true;
+    }
+
+    if (quer > sizeof(bufLog)) quer = sizeof(bufLog);
+    size_t lidos = lerLog(bufLog, quer);
+    if (lidos == 0) {
+      fim = pos;
+      break;
+    }
+    size_t usados = 0;
+    bool   cheio  = false;
+    while (usados < lidos) {
+      const char *ini = bufLog + usados;
+      const char *nl  = (const char *)memchr(ini, '\n', lidos - usados);
+      size_t len;
+      if (nl) {
+        len = nl - ini;
+      } else if (pos + lidos == fim) {
+        len = lidos - usados;   // última linha sem '\n'
+      } else {
+        break;                  // continua na próxima leitura
+      }
+      char   linha[LINHA_MAX];
+      size_t k = renderizarLinha(ini, len, pos + usados, linha, sizeof(linha));
+      if (n + k > SAIDA_MAX) {
+        cheio = true;
+        break;
+      }
+      memcpy(saida + n, linha, k);
+      n      += k;
+      usados += len + (nl ? 1 : 0);
+    }
+    if (usados == 0 && !cheio) usados = lidos;   // linha maior que o bloco: pula
+    pos += usados;
+    if (cheio || n > SAIDA_MAX - LINHA_MAX) break;
+  }
+  return n > 0;
+}
+
+// ======================= Loop =======================
+
+void iniciarExportacaoHttp(uint16_t porta) {
+  if (servidorIniciado) return;
+  servidor.begin(porta);
+  servidorIniciado = true;
+  LOG_INFO("HTTP: exportacao do log na porta %u", (unsigned)porta);
+}
+
+bool exportacaoHttpOcupada() {
+  return etapa != EXPORTACAO_LIVRE;
+}
+
+void atenderExportacaoHttp() {
+  if (!servidorIniciado) return;
+
+  if (etapa == EXPORTACAO_LIVRE) {
+    cliente = servidor.accept();
+    if (!cliente) return;
+    etapa     = EXPORTACAO_PEDIDO;
+    lenPedido = 0;
+    inicioMs  = millis();
+  }
+
+  if (etapa == EXPORTACAO_PEDIDO) {
+    while (cliente.available() > 0 && lenPedido < EXPORTACAO_PEDIDO_MAX) {
+      int k = cliente.read((uint8_t *)pedido + lenPedido, EXPORTACAO_PEDIDO_MAX - lenPedido);
+      if (k <= 0) break;
+      lenPedido += k;
+    }
+    pedido[lenPedido] = '\0';
+    if (strstr(pedido, "\r\n\r\n")) {
+      atenderPedido();
+    } else if (lenPedido >= EXPORTACAO_PEDIDO_MAX) {
+      responderErro(431, "Request Header Fields Too Large");
+    } else if (!cliente.connected() || millis() - inicioMs > EXPORTACAO_PEDIDO_MS) {
+      encerrar();
+    }
+    return;
+  }
+
+  uint32_t t0 = millis();
+  do {
+    size_t n;
+    if (!montarPedaco(n)) {
+      cliente.write((const uint8_t *)"0\r\n\r\n", 5);
+      LOG_INFO("HTTP: exportacao concluida, %lu bytes em %lu ms", (unsigned long)bytesEnviados,
+               (unsigned long)(millis() - inicioMs));
+      encerrar();
+      return;
+    }
+    if (!enviarPedaco(n)) {
+      LOG_AVISO("HTTP: cliente desconectou apos %lu bytes", (unsigned long)bytesEnviados);
+      encerrar();
+      return;
+    }
+  } while (millis() - t0 < EXPORTACAO_FATIA_MS);
+}
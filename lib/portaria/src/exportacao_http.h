@@ -0,0 +1,38 @@
+// Exportação do log de movimentações por HTTP, para backups inteiros sem
+// passar pelo MQTT (uma mensagem por linha no get_history):
+//
+//   GET /movimentacoes.txt      o arquivo como está, com a moldura de cada registro
+//   GET /movimentacoes.csv      portaria,offset,funcionario,usuario,acao,data,hora
+//   GET /movimentacoes.ndjson   uma linha = o JSON de portaria/<id>/movimentacoes
+//
+//   ?since=dd/mm/aaaa (ou aaaa-mm-dd): só a partir desse dia, pelo índice de datas
+//   Range: bytes=a-b | a- | -n     só no .txt (206 + Content-Range); nos outros é ignorado
+//
+//   curl -o backup.txt http://<ip>/movimentacoes.txt
+//   curl -H 'Range: bytes=4096-' http://<ip>/movimentacoes.txt     (o que faltou)
+//   curl 'http://<ip>/movimentacoes.ndjson?since=2025-10-13'
+//
+// A resposta vai em Transfer-Encoding: chunked, lida do arquivo num buffer
+// fixo e enviada aos pedaços a cada volta do loop() (até EXPORTACAO_FATIA_MS
+// por volta), sem String nem alocação: o MQTT e os cartões seguem atendidos
+// durante um backup. Um cliente por vez; os outros esperam na fila do socket.
+// O que for gravado depois do pedido fica para o próximo.
+#pragma once
+
+#include <Arduino.h>
+
+#define EXPORTACAO_HTTP_PORTA      80
+#define EXPORTACAO_BLOCO           1024    // bytes do log por leitura
+#define EXPORTACAO_PEDIDO_MAX      512     // linha do pedido + cabeçalhos
+#define EXPORTACAO_PEDIDO_MS       3000UL  // espera pelo pedido completo
+#define EXPORTACAO_FATIA_MS        20UL    // envio por volta do loop()
+
+// Abre o servidor (uma vez; chamadas seguintes não fazem nada). No ESP32,
+// depois que o WiFi conecta; no PC, com a porta do --http.
+void iniciarExportacaoHttp(uint16_t porta = EXPORTACAO_HTTP_PORTA);
+
+// Parte do loop(): aceita um cliente, lê o pedido e envia o próximo pedaço
+void atenderExportacaoHttp();
+
+// Tem um cliente sendo atendido
+bool exportacaoHttpOcupada();
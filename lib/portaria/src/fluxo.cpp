@@ -0,0 +1,413 @@
+#include "fluxo.h"
+
+#include "cadastro.h"
+#include "estado.h"
+#include "imagem_cadastro.h"
+#include "log_serial.h"
+#include "metricas.h"
+#include "movimentacoes.h"
+#include "serializador.h"
+#include "telemetria.h"
+
+#include <atomic>
+
+// micros() da leitura do cartão em processamento (0 = desconhecido)
+static uint32_t toqueDetectadoUs = 0;
+
+// TaskProcessaCartoes (fluxos) e loop (comandos, cadastro) publicam status
+static std::atomic<uint32_t> seqStatus(0);
+
+// Sorteado a cada boot: o seq recomeça em 0 e sozinho não separa uma
+// mensagem repetida da primeira depois de um reboot
+static const uint16_t bootStatus = (uint16_t)esp_random();
+
+uint16_t idBootStatus() {
+  return bootStatus;
+}
+
+uint16_t proximoSeqStatus() {
+  return (uint16_t)(seqStatus.fetch_add(1) & 0xFFFF);
+}
+
+void publicarStatusFluxo(const char *contexto, const char *parent, const char *employee) {
+  if (!mqttClient.connected()) return;
+  char buf[96];
+  Serializador s(buf, sizeof(buf), formatoCanal(CANAL_STATUS));
+  s.objeto().texto("context", contexto).natural("boot", idBootStatus()).natural("seq", proximoSeqStatus());
+  s.texto("parent", parent).texto("employee", employee).fechar();
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+// --------- ENTRADA ----------
+// Primeiro: USUÁRIO, depois: FUNCIONÁRIO
+void processarEntradaCartao(const String &uidLido) {
+  String uid = uidLido;
+  uid.trim();
+  uid.toLowerCase();
+
+  uint32_t t0 = micros();
+  uint8_t papeis     = papeisDoUid(uid);
+  bool ehUsuario     = papeis & PAPEL_USUARIO;
+  bool ehFuncionario = papeis & PAPEL_FUNCIONARIO;
+  metricaRegistrar(MET_CONSULTA_PAPEL, micros() - t0);
+  if (ehUsuario || ehFuncionario) marcarBoot(BOOT_PRIMEIRO_TOQUE);
+
+  // ==================== PRIMEIRO CARTÃO (USUÁRIO) ====================
+  if (!aguardandoSegundoEntrada) {
+    // PRIMEIRO CARTÃO: deve ser USUÁRIO
+    if (!ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (ENTRADA): primeiro cartao nao cadastrado.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("entrada", "error", "idle");
+
+      return;
+    }
+
+    if (ehFuncionario && !ehUsuario) {
+      LOG_AVISO("Falha (ENTRADA): primeiro cartao deve ser de USUARIO, mas e FUNCIONARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("entrada", "error", "idle");
+
+      return;
+    }
+
+    if (ehUsuario && ehFuncionario) {
+      LOG_AVISO("Falha (ENTRADA): UID em usuarios E funcionarios (configuracao invalida).");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("entrada", "error", "idle");
+
+      return;
+    }
+
+    // aqui deu tudo certo para o usuário
+    uidUsuarioEntradaPendente = uid;
+    aguardandoSegundoEntrada  = true;
+
+    LOG_INFO("ENTRADA: cartao de USUARIO OK (%s). Aproxime agora o cartao do FUNCIONARIO.",
+             uidUsuarioEntradaPendente.c_str());
+
+    digitalWrite(LED_YELLOW, HIGH);
+    delay(300);
+    digitalWrite(LED_YELLOW, LOW);
+
+    publicarStatusFluxo("entrada", "success", "waiting");   // responsável OK, aguardando o funcionário
+
+    return;
+  }
+
+  // ==================== SEGUNDO CARTÃO (FUNCIONÁRIO) ====================
+  else {
+    // SEGUNDO CARTÃO: deve ser FUNCIONARIO
+    if (uid == uidUsuarioEntradaPendente) {
+      LOG_AVISO("Falha (ENTRADA): mesmo cartao nao pode ser USUARIO e FUNCIONARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoEntrada = false;
+      leituraHabilitada        = false;
+
+      publicarStatusFluxo("entrada", "success", "error");
+
+      return;
+    }
+
+    if (!ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (ENTRADA): segundo cartao nao cadastrado.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoEntrada = false;
+      leituraHabilitada        = false;
+
+      publicarStatusFluxo("entrada", "success", "error");
+
+      return;
+    }
+
+    if (ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (ENTRADA): segundo cartao deve ser FUNCIONARIO, mas e USUARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoEntrada = false;
+      leituraHabilitada        = false;
+
+      publicarStatusFluxo("entrada", "success", "error");
+
+      return;
+    }
+
+    if (ehUsuario && ehFuncionario) {
+      LOG_AVISO("Falha (ENTRADA): segundo UID em usuarios E funcionarios (configuracao invalida).");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoEntrada = false;
+      leituraHabilitada        = false;
+
+      publicarStatusFluxo("entrada", "success", "error");
+
+      return;
+    }
+
+    // sucesso na combinação
+    String uidFuncionario = uid;
+    String uidUsuario     = uidUsuarioEntradaPendente;
+
+    aguardandoSegundoEntrada  = false;
+    uidUsuarioEntradaPendente = "";
+
+    LOG_INFO("✅ Combinacao valida para ENTRADA (USUARIO + FUNCIONARIO).");
+    registrarMovimentacao(uidFuncionario, uidUsuario, "entrada");
+    if (toqueDetectadoUs) metricaRegistrar(MET_TOQUE_REGISTRO, micros() - toqueDetectadoUs);
+
+    publicarStatusFluxo("entrada", "success", "success");
+
+    digitalWrite(LED_GREEN, HIGH);
+    digitalWrite(LED_RED, LOW);
+    delay(2000);
+    digitalWrite(LED_GREEN, LOW);
+
+    xSemaphoreGive(semAcessoLiberado);
+    if (xSemaphoreTake(semAcessoLiberado, 0) == pdTRUE) {
+      LOG_INFO("Semaforo semAcessoLiberado sinalizado e consumido (entrada).");
+    }
+
+    // desabilita leituras até o próximo comando (ou próximo start_entrada)
+    leituraHabilitada = false;
+  }
+}
+
+
+// --------- SAÍDA ----------
+// Primeiro: FUNCIONARIO, depois: USUARIO
+void processarSaidaCartao(const String &uidLido) {
+  String uid = uidLido;
+  uid.trim();
+  uid.toLowerCase();
+
+  uint32_t t0 = micros();
+  uint8_t papeis     = papeisDoUid(uid);
+  bool ehUsuario     = papeis & PAPEL_USUARIO;
+  bool ehFuncionario = papeis & PAPEL_FUNCIONARIO;
+  metricaRegistrar(MET_CONSULTA_PAPEL, micros() - t0);
+  if (ehUsuario || ehFuncionario) marcarBoot(BOOT_PRIMEIRO_TOQUE);
+
+  // ==================== PRIMEIRO CARTÃO (FUNCIONÁRIO) ====================
+  if (!aguardandoSegundoSaida) {
+    // PRIMEIRO CARTÃO: deve ser FUNCIONARIO
+    if (!ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): primeiro cartao nao cadastrado.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("saida", "idle", "error");
+
+      return;
+    }
+
+    if (ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): primeiro cartao deve ser FUNCIONARIO, mas e USUARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("saida", "idle", "error");
+
+      return;
+    }
+
+    if (ehUsuario && ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): UID em usuarios E funcionarios (configuracao invalida).");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      leituraHabilitada = false;
+
+      publicarStatusFluxo("saida", "idle", "error");
+
+      return;
+    }
+
+    // sucesso: primeiro cartão é FUNCIONÁRIO
+    uidFuncionarioSaidaPendente = uid;
+    aguardandoSegundoSaida      = true;
+
+    LOG_INFO("SAIDA: cartao de FUNCIONARIO OK (%s). Aproxime agora o cartao do USUARIO.",
+             uidFuncionarioSaidaPendente.c_str());
+
+    digitalWrite(LED_YELLOW, HIGH);
+    delay(300);
+    digitalWrite(LED_YELLOW, LOW);
+
+    publicarStatusFluxo("saida", "waiting", "success");   // funcionário OK, aguardando o responsável
+
+    return;
+  }
+
+  // ==================== SEGUNDO CARTÃO (USUÁRIO) ====================
+  else {
+    // SEGUNDO CARTÃO: deve ser USUARIO
+    if (uid == uidFuncionarioSaidaPendente) {
+      LOG_AVISO("Falha (SAIDA): mesmo cartao nao pode ser FUNCIONARIO e USUARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoSaida = false;
+      leituraHabilitada      = false;
+
+      publicarStatusFluxo("saida", "error", "success");
+
+      return;
+    }
+
+    if (!ehUsuario && !ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): segundo cartao nao cadastrado.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoSaida = false;
+      leituraHabilitada      = false;
+
+      publicarStatusFluxo("saida", "error", "success");
+
+      return;
+    }
+
+    if (!ehUsuario && ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): segundo cartao deve ser USUARIO, mas e FUNCIONARIO.");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoSaida = false;
+      leituraHabilitada      = false;
+
+      publicarStatusFluxo("saida", "error", "success");
+
+      return;
+    }
+
+    if (ehUsuario && ehFuncionario) {
+      LOG_AVISO("Falha (SAIDA): segundo UID em usuarios E funcionarios (configuracao invalida).");
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_GREEN, LOW);
+      delay(2000);
+      digitalWrite(LED_RED, LOW);
+      aguardandoSegundoSaida = false;
+      leituraHabilitada      = false;
+
+      publicarStatusFluxo("saida", "error", "success");
+
+      return;
+    }
+
+    // sucesso: combinação FUNCIONARIO + USUARIO
+    String uidFuncionario = uidFuncionarioSaidaPendente;
+    String uidUsuario     = uid;
+
+    aguardandoSegundoSaida      = false;
+    uidFuncionarioSaidaPendente = "";
+
+    LOG_INFO("✅ Combinacao valida para SAIDA (FUNCIONARIO + USUARIO).");
+    registrarMovimentacao(uidFuncionario, uidUsuario, "saída");
+    if (toqueDetectadoUs) metricaRegistrar(MET_TOQUE_REGISTRO, micros() - toqueDetectadoUs);
+
+    publicarStatusFluxo("saida", "success", "success");
+
+    digitalWrite(LED_GREEN, HIGH);
+    digitalWrite(LED_RED, LOW);
+    delay(2000);
+    digitalWrite(LED_GREEN, LOW);
+
+    xSemaphoreGive(semAcessoLiberado);
+    if (xSemaphoreTake(semAcessoLiberado, 0) == pdTRUE) {
+      LOG_INFO("Semaforo semAcessoLiberado sinalizado e consumido (saida).");
+    }
+
+    // desabilita leituras até o próximo comando (ou start_saida)
+    leituraHabilitada = false;
+  }
+}
+
+void processarCartao(const String &uid) {
+  if (modoAtual == MODO_ENTRADA) {
+    processarEntradaCartao(uid);
+  } else {
+    processarSaidaCartao(uid);
+  }
+}
+
+bool processarProximoCartao(TickType_t espera) {
+  EventoCartao ev;
+  if (filaCartoes == NULL || xQueueReceive(filaCartoes, &ev, espera) != pdTRUE) return false;
+  metricaRegistrar(MET_ESPERA_FILA, micros() - ev.enfileiradoUs);
+  toqueDetectadoUs = ev.detectadoUs;
+  processarCartao(String(ev.uid));
+  toqueDetectadoUs = 0;
+  return true;
+}
+
+void verificarLeitorCartoes() {
+  // Leitura de cartões só acontece se habilitada pelo terminal/MQTT
+  if (!leituraHabilitada) return;
+
+  if (!mfrc522.PICC_IsNewCardPresent()) return;
+  if (!mfrc522.PICC_ReadCardSerial())   return;
+  uint32_t detectadoUs = micros();
+
+  String uidString = uidToString(mfrc522.uid);
+  LOG_INFO("Card UID: %s", uidString.c_str());
+
+  if (filaCartoes != NULL) {
+    EventoCartao ev;
+    strncpy(ev.uid, uidString.c_str(), sizeof(ev.uid) - 1);
+    ev.uid[sizeof(ev.uid) - 1] = '\0';
+    ev.detectadoUs   = detectadoUs;
+    ev.enfileiradoUs = micros();
+    if (xQueueSend(filaCartoes, &ev, pdMS_TO_TICKS(100)) != pdTRUE) {
+      filaCartoesDescartes++;
+      LOG_AVISO("Aviso: filaCartoes cheia, UID descartado.");
+    } else {
+      metricaRegistrar(MET_DETECTAR_FILA, micros() - detectadoUs);
+      uint32_t ocupada = (uint32_t)uxQueueMessagesWaiting(filaCartoes);
+      if (ocupada > filaCartoesPico) filaCartoesPico = ocupada;
+      LOG_INFO("UID enviado para fila de processamento.");
+    }
+  } else {
+    // fallback de segurança: se a fila não existir, mantém comportamento direto
+    toqueDetectadoUs = detectadoUs;
+    processarCartao(uidString);
+    toqueDetectadoUs = 0;
+  }
+
+  mfrc522.PICC_HaltA();
+  mfrc522.PCD_StopCrypto1();
+}
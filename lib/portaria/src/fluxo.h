@@ -0,0 +1,33 @@
+// Fluxos de ENTRADA (usuário -> funcionário) e SAÍDA (funcionário -> usuário).
+#pragma once
+
+#include <Arduino.h>
+
+#include "freertos/FreeRTOS.h"
+
+void processarEntradaCartao(const String &uidLido);
+void processarSaidaCartao(const String &uidLido);
+
+// Uma mensagem por transição, com as duas etapas do fluxo de uma vez, em
+// portaria/<id>/status (se conectado):
+//   {"context":"entrada|saida","boot":B,"seq":N,"parent":...,"employee":...}
+// parent/employee: idle | waiting | success | error. O painel desenha só o
+// que veio na última mensagem, sem depender da ordem de mensagens parciais.
+void publicarStatusFluxo(const char *contexto, const char *parent, const char *employee);
+
+// "seq" das mensagens de estado em portaria/<id>/status (fluxos e cadastro):
+// 16 bits, volta a 0 depois de 65535 e a cada boot. Mesmo (boot, seq) = repetida.
+uint16_t proximoSeqStatus();
+
+// "boot" das mesmas mensagens: sorteado (esp_random) a cada boot
+uint16_t idBootStatus();
+
+// Encaminha o UID para o fluxo do modo atual
+void processarCartao(const String &uid);
+
+// Tira um cartão da filaCartoes e processa. false se a fila ficou vazia até 'espera'.
+bool processarProximoCartao(TickType_t espera);
+
+// Parte do loop(): se a leitura estiver habilitada e houver cartão no leitor,
+// manda o UID para a filaCartoes.
+void verificarLeitorCartoes();
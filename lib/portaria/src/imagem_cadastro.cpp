@@ -0,0 +1,535 @@
+#include "imagem_cadastro.h"
+
+#include <esp_idf_version.h>
+#include <esp_partition.h>
+#if ESP_IDF_VERSION_MAJOR < 5
+// IDF 4.x (core Arduino 2.x): o mmap da partição devolve um handle do spi_flash
+#include <esp_spi_flash.h>
+typedef spi_flash_mmap_handle_t esp_partition_mmap_handle_t;
+#define ESP_PARTITION_MMAP_DATA  SPI_FLASH_MMAP_DATA
+#define esp_partition_munmap     spi_flash_munmap
+#endif
+
+#include "armazenamento.h"
+#include "config.h"
+#include "log_serial.h"
+
+#define IMAGEM_MAGIC    0x31444143UL   // "CAD1"
+#define IMAGEM_VERSAO   2
+#define IMAGEM_CHAVE    (1 + IMAGEM_UID_BYTES)   // tam + uid: ordem da busca
+#define IMAGEM_CURSOR   8                        // registros lidos de cada lote por vez
+#define IMAGEM_SAIDA    32                       // registros por esp_partition_write()
+#define IMAGEM_SETOR    4096                     // menor trecho que a flash apaga
+
+static const char *IMAGEM_LOTES = "/cadastro.lotes";
+
+// Registro da imagem. UID com menos de 10 bytes fica completado com zeros;
+// o tamanho vem antes para que "a1b2" e "a1b200" não se confundam.
+struct RegistroImagem {
+  uint8_t tam;
+  uint8_t uid[IMAGEM_UID_BYTES];
+  uint8_t papeis;
+};
+
+// No início da partição, gravado por último: sem ele (ou com CRC errado) a
+// imagem não vale. tamFonte/crcFonte dizem até onde cada arquivo já entrou.
+// Depois dos registros vem o filtro de Bloom (bitsFiltro bits, hashesFiltro
+// posições por UID); crcRegistros cobre os dois.
+struct CabecalhoImagem {
+  uint32_t magic;
+  uint16_t versao;
+  uint16_t tamRegistro;
+  uint32_t n;
+  uint32_t crcRegistros;
+  uint32_t tamFonte[2];   // CARDS_FILE, ADMINS_FILE
+  uint32_t crcFonte[2];
+  uint32_t bitsFiltro;    // 0 = sem filtro
+  uint8_t  hashesFiltro;
+  uint8_t  reservado[3];
+};
+
+static const esp_partition_t     *particao  = NULL;
+static esp_partition_mmap_handle_t handleMapa;
+static bool                        mapeada   = false;
+
+// registros == NULL: sem imagem ativa. Trocados só com mtxImagem.
+static const RegistroImagem *registros    = NULL;
+static size_t                numRegistros = 0;
+static const uint8_t        *filtro       = NULL;   // também na flash mapeada
+static uint32_t              bitsFiltro   = 0;
+static uint8_t               hashesFiltro = 0;
+static uint32_t              consultasFiltro = 0, recusadosFiltro = 0, falsosFiltro = 0;
+static RegistroImagem        delta[IMAGEM_DELTA_MAX];
+static size_t                numDelta     = 0;
+static SemaphoreHandle_t     mtxImagem    = NULL;
+
+static const char *arquivoFonte(uint8_t i) { return i == 0 ? CARDS_FILE : ADMINS_FILE; }
+static uint8_t     papelFonte(uint8_t i)   { return i == 0 ? PAPEL_USUARIO : PAPEL_FUNCIONARIO; }
+
+static int8_t valorHex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool chaveDeUid(const char *s, size_t len, RegistroImagem &r) {
+  if (len < 2 || len > 2 * IMAGEM_UID_BYTES || (len & 1)) return false;
+  memset(&r, 0, sizeof(r));
+  r.tam = (uint8_t)(len / 2);
+  for (size_t i = 0; i < r.tam; i++) {
+    int8_t hi = valorHex(s[2 * i]), lo = valorHex(s[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    r.uid[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+static int compararChave(const void *a, const void *b) {
+  return memcmp(a, b, IMAGEM_CHAVE);
+}
+
+// ---------------- Filtro de Bloom ----------------
+// Duas funções de hash (FNV-1a e uma mistura dele) geram as k posições por
+// h1 + i*h2. Com b bits por UID e k = 0,69*b a taxa de falsos positivos fica
+// perto de 0,62^b: 10 bits -> ~1%.
+
+static void hashesChave(const RegistroImagem &chave, uint32_t &h1, uint32_t &h2) {
+  const uint8_t *p = (const uint8_t *)&chave;
+  h1 = 2166136261UL;
+  for (size_t i = 0; i < IMAGEM_CHAVE; i++) {
+    h1 ^= p[i];
+    h1 *= 16777619UL;
+  }
+  h2 = h1 ^ 0x9E3779B9UL;   // finalizador do murmur3
+  h2 ^= h2 >> 16;
+  h2 *= 0x85EBCA6BUL;
+  h2 ^= h2 >> 13;
+  h2 *= 0xC2B2AE35UL;
+  h2 ^= h2 >> 16;
+  h2 |= 1;
+}
+
+static void marcarFiltro(uint8_t *bits, uint32_t m, uint8_t k, const RegistroImagem &chave) {
+  uint32_t h1, h2;
+  hashesChave(chave, h1, h2);
+  for (uint8_t i = 0; i < k; i++) {
+    uint32_t b = (h1 + i * h2) % m;
+    bits[b >> 3] |= (uint8_t)(1 << (b & 7));
+  }
+}
+
+static bool talvezNoFiltro(const RegistroImagem &chave) {
+  if (!filtro) return true;
+  uint32_t h1, h2;
+  hashesChave(chave, h1, h2);
+  for (uint8_t i = 0; i < hashesFiltro; i++) {
+    uint32_t b = (h1 + i * h2) % bitsFiltro;
+    if (!(filtro[b >> 3] & (1 << (b & 7)))) return false;
+  }
+  return true;
+}
+
+// ---------------- Consulta (com mtxImagem) ----------------
+
+static uint8_t papeisNaImagem(const RegistroImagem &chave) {
+  size_t ini = 0, fim = numRegistros;
+  while (ini < fim) {
+    size_t meio = ini + (fim - ini) / 2;
+    int c = memcmp(&registros[meio], &chave, IMAGEM_CHAVE);
+    if (c == 0) return registros[meio].papeis;
+    if (c < 0) ini = meio + 1;
+    else       fim = meio;
+  }
+  return 0;
+}
+
+static int indiceDelta(const RegistroImagem &chave) {
+  for (size_t i = 0; i < numDelta; i++) {
+    if (memcmp(&delta[i], &chave, IMAGEM_CHAVE) == 0) return (int)i;
+  }
+  return -1;
+}
+
+// Delta primeiro (o filtro só cobre a imagem); cartão desconhecido costuma
+// parar no filtro, sem a busca binária.
+static uint8_t papeisAtuais(const RegistroImagem &chave) {
+  int i = indiceDelta(chave);
+  if (i >= 0) return delta[i].papeis;
+  consultasFiltro++;
+  if (!talvezNoFiltro(chave)) {
+    recusadosFiltro++;
+    return 0;
+  }
+  uint8_t papeis = papeisNaImagem(chave);
+  if (!papeis && filtro) falsosFiltro++;
+  return papeis;
+}
+
+bool consultarImagemCadastro(const String &uid, uint8_t &papeis) {
+  RegistroImagem chave;
+  if (!mtxImagem || !chaveDeUid(uid.c_str(), uid.length(), chave)) return false;
+  xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  bool ativa = registros != NULL;
+  if (ativa) papeis = papeisAtuais(chave);
+  xSemaphoreGive(mtxImagem);
+  return ativa;
+}
+
+// false se o delta está cheio
+static bool anotarDelta(RegistroImagem chave, uint8_t papel, bool cadastrado) {
+  xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  int i = indiceDelta(chave);
+  uint8_t atual = i >= 0 ? delta[i].papeis : papeisNaImagem(chave);
+  chave.papeis = cadastrado ? (atual | papel) : (atual & ~papel);
+  bool ok = true;
+  if (i >= 0)                           delta[i].papeis   = chave.papeis;
+  else if (numDelta < IMAGEM_DELTA_MAX) delta[numDelta++] = chave;
+  else                                  ok = false;
+  xSemaphoreGive(mtxImagem);
+  return ok;
+}
+
+void anotarCadastro(const String &uid, uint8_t papel, bool cadastrado) {
+  RegistroImagem chave;
+  if (!mtxImagem || !registros || !chaveDeUid(uid.c_str(), uid.length(), chave)) return;
+  if (anotarDelta(chave, papel, cadastrado)) return;
+  LOG_INFO("Cadastro: delta cheio (%u UIDs), montando a imagem de novo.", (unsigned)IMAGEM_DELTA_MAX);
+  reconstruirImagemCadastro();   // os arquivos já têm a mudança
+}
+
+size_t uidsImagemCadastro() { return registros ? numRegistros : 0; }
+size_t uidsDeltaCadastro()  { return numDelta; }
+
+void estatisticasFiltroCadastro(EstatisticasFiltro &e) {
+  if (mtxImagem) xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  e.consultas       = consultasFiltro;
+  e.recusados       = recusadosFiltro;
+  e.falsosPositivos = falsosFiltro;
+  e.bits            = filtro ? bitsFiltro : 0;
+  e.hashes          = filtro ? hashesFiltro : 0;
+  e.uids            = registros ? numRegistros : 0;
+  if (mtxImagem) xSemaphoreGive(mtxImagem);
+}
+
+void zerarEstatisticasFiltro() {
+  if (mtxImagem) xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  consultasFiltro = recusadosFiltro = falsosFiltro = 0;
+  if (mtxImagem) xSemaphoreGive(mtxImagem);
+}
+
+// ---------------- Mapeamento ----------------
+
+static void desmapear() {
+  if (mtxImagem) xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  registros    = NULL;
+  numRegistros = 0;
+  filtro       = NULL;
+  numDelta     = 0;
+  if (mtxImagem) xSemaphoreGive(mtxImagem);
+  if (mapeada) esp_partition_munmap(handleMapa);
+  mapeada = false;
+}
+
+static size_t bytesFiltro(uint32_t bits) { return (bits + 7) / 8; }
+
+// UIDs que cabem na partição junto com o filtro
+static size_t capacidadeImagem() {
+  return (particao->size - sizeof(CabecalhoImagem)) * 8 / (sizeof(RegistroImagem) * 8 + IMAGEM_FILTRO_BITS_UID);
+}
+
+// Mapeia a partição inteira e ativa a imagem se o cabeçalho e o CRC conferem
+static bool mapear(CabecalhoImagem &cab) {
+  const void *p = NULL;
+  if (esp_partition_mmap(particao, 0, particao->size, ESP_PARTITION_MMAP_DATA, &p, &handleMapa) != ESP_OK) {
+    LOG_ERRO("Cadastro: esp_partition_mmap falhou.");
+    return false;
+  }
+  mapeada = true;
+
+  const uint8_t *base = (const uint8_t *)p;
+  memcpy(&cab, base, sizeof(cab));
+  size_t bytesRegistros = (size_t)cab.n * sizeof(RegistroImagem);
+  if (cab.magic != IMAGEM_MAGIC || cab.versao != IMAGEM_VERSAO ||
+      cab.tamRegistro != sizeof(RegistroImagem) || cab.n > particao->size / sizeof(RegistroImagem) ||
+      (cab.bitsFiltro && !cab.hashesFiltro) ||
+      sizeof(cab) + bytesRegistros + bytesFiltro(cab.bitsFiltro) > particao->size) {
+    return false;
+  }
+  const RegistroImagem *r = (const RegistroImagem *)(base + sizeof(cab));
+  if (crc32Atualizar(0, r, bytesRegistros + bytesFiltro(cab.bitsFiltro)) != cab.crcRegistros) {
+    LOG_AVISO("Cadastro: imagem com CRC errado.");
+    return false;
+  }
+
+  xSemaphoreTake(mtxImagem, portMAX_DELAY);
+  registros    = r;
+  numRegistros = cab.n;
+  filtro       = cab.bitsFiltro ? base + sizeof(cab) + bytesRegistros : NULL;
+  bitsFiltro   = cab.bitsFiltro;
+  hashesFiltro = cab.hashesFiltro;
+  xSemaphoreGive(mtxImagem);
+  return true;
+}
+
+// ---------------- Arquivos de origem ----------------
+
+static size_t tamanhoArquivo(const char *path) {
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return 0;
+  size_t t = f.size();
+  f.close();
+  return t;
+}
+
+// CRC dos primeiros 'n' bytes; false se o arquivo tem menos que isso
+static bool crcPrefixo(const char *path, size_t n, uint32_t &crc) {
+  crc = 0;
+  if (n == 0) return true;
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return false;
+  uint8_t buf[256];
+  bool ok = f.size() >= n;
+  while (ok && n) {
+    size_t k = n < sizeof(buf) ? n : sizeof(buf);
+    ok = f.read(buf, k) == k;
+    crc = crc32Atualizar(crc, buf, k);
+    n -= k;
+  }
+  f.close();
+  return ok;
+}
+
+// Os arquivos só cresceram desde a imagem? (o que ela cobre não mudou)
+static bool fontesConferem(const CabecalhoImagem &cab) {
+  for (uint8_t i = 0; i < 2; i++) {
+    uint32_t crc;
+    if (!crcPrefixo(arquivoFonte(i), cab.tamFonte[i], crc) || crc != cab.crcFonte[i]) return false;
+  }
+  return true;
+}
+
+// UIDs acrescentados aos arquivos depois da imagem vão para o delta
+static bool lerAcrescimos(const CabecalhoImagem &cab) {
+  char buf[256];
+  for (uint8_t i = 0; i < 2; i++) {
+    if (tamanhoArquivo(arquivoFonte(i)) <= cab.tamFonte[i]) continue;
+    File f = abrirArquivo(arquivoFonte(i), FILE_READ);
+    if (!f || !f.seek(cab.tamFonte[i])) return false;
+    LeitorLinhas leitor(f, buf, sizeof(buf));
+    Trecho linha;
+    bool ok = true;
+    while (ok && leitor.proxima(linha)) {
+      Trecho t = trechoAparado(linha.p, linha.len);
+      RegistroImagem chave;
+      if (chaveDeUid(t.p, t.len, chave)) ok = anotarDelta(chave, papelFonte(i), true);
+    }
+    f.close();
+    if (!ok) return false;
+  }
+  return true;
+}
+
+// ---------------- Montagem ----------------
+
+// Ordena um lote na RAM e o acrescenta ao arquivo de lotes
+static bool gravarLote(File &lotes, RegistroImagem *lote, size_t n) {
+  qsort(lote, n, sizeof(RegistroImagem), compararChave);
+  return lotes.write((const uint8_t *)lote, n * sizeof(RegistroImagem)) == n * sizeof(RegistroImagem);
+}
+
+struct CursorLote {
+  size_t         pos, fim;   // em registros, dentro do arquivo de lotes
+  uint8_t        i, n;
+  RegistroImagem buf[IMAGEM_CURSOR];
+};
+
+static bool cursorAtual(CursorLote &c, File &lotes) {
+  if (c.i < c.n) return true;
+  if (c.pos >= c.fim) return false;
+  size_t n = c.fim - c.pos < IMAGEM_CURSOR ? c.fim - c.pos : IMAGEM_CURSOR;
+  if (!lotes.seek(c.pos * sizeof(RegistroImagem)) ||
+      lotes.read((uint8_t *)c.buf, n * sizeof(RegistroImagem)) != n * sizeof(RegistroImagem)) {
+    c.pos = c.fim;
+    return false;
+  }
+  c.pos += n;
+  c.i    = 0;
+  c.n    = (uint8_t)n;
+  return true;
+}
+
+struct SaidaImagem {
+  size_t         n;       // registros já gravados na partição
+  uint32_t       crc;
+  uint8_t        pendentes;
+  RegistroImagem buf[IMAGEM_SAIDA];
+  bool           ok;
+  uint8_t       *filtro;  // montado na RAM e gravado depois dos registros
+  uint32_t       bitsFiltro;
+  uint8_t        hashesFiltro;
+};
+
+static void descarregarSaida(SaidaImagem &s) {
+  if (!s.pendentes || !s.ok) return;
+  size_t bytes = s.pendentes * sizeof(RegistroImagem);
+  s.ok  = esp_partition_write(particao, sizeof(CabecalhoImagem) + s.n * sizeof(RegistroImagem), s.buf, bytes) == ESP_OK;
+  s.crc = crc32Atualizar(s.crc, s.buf, bytes);
+  s.n  += s.pendentes;
+  s.pendentes = 0;
+}
+
+static void emitir(SaidaImagem &s, const RegistroImagem &r) {
+  if (s.filtro) marcarFiltro(s.filtro, s.bitsFiltro, s.hashesFiltro, r);
+  s.buf[s.pendentes++] = r;
+  if (s.pendentes == IMAGEM_SAIDA) descarregarSaida(s);
+}
+
+// Os dois arquivos viram lotes ordenados de IMAGEM_LOTE UIDs em IMAGEM_LOTES;
+// depois os lotes são intercalados direto na partição (UID repetido = papéis
+// somados). Pico de RAM: um lote (6 KB) ou o filtro (IMAGEM_FILTRO_BITS_UID
+// bits por UID, ~1,2 KB para 1000 UIDs), não o cadastro inteiro.
+bool reconstruirImagemCadastro() {
+  if (!particao) return false;
+  unsigned long t0 = millis();
+  desmapear();
+
+  CabecalhoImagem cab;
+  memset(&cab, 0, sizeof(cab));
+  cab.magic       = IMAGEM_MAGIC;
+  cab.versao      = IMAGEM_VERSAO;
+  cab.tamRegistro = sizeof(RegistroImagem);
+
+  RegistroImagem *lote = (RegistroImagem *)malloc(IMAGEM_LOTE * sizeof(RegistroImagem));
+  File lotes = abrirArquivo(IMAGEM_LOTES, FILE_WRITE);
+  bool ok = lote && lotes;
+  size_t total = 0, noLote = 0, ignorados = 0;
+  char buf[256];
+
+  for (uint8_t i = 0; ok && i < 2; i++) {
+    cab.tamFonte[i] = tamanhoArquivo(arquivoFonte(i));
+    ok = crcPrefixo(arquivoFonte(i), cab.tamFonte[i], cab.crcFonte[i]);
+    File f = abrirArquivo(arquivoFonte(i), FILE_READ);
+    if (!ok || !f) continue;
+    LeitorLinhas leitor(f, buf, sizeof(buf));
+    Trecho linha;
+    while (ok && leitor.proxima(linha) && leitor.offsetLinha() < cab.tamFonte[i]) {
+      Trecho t = trechoAparado(linha.p, linha.len);
+      if (!t.len) continue;
+      if (!chaveDeUid(t.p, t.len, lote[noLote])) {
+        ignorados++;
+        continue;
+      }
+      lote[noLote++].papeis = papelFonte(i);
+      total++;
+      if (noLote == IMAGEM_LOTE) {
+        ok = gravarLote(lotes, lote, noLote);
+        noLote = 0;
+      }
+    }
+    f.close();
+  }
+  if (ok && noLote) ok = gravarLote(lotes, lote, noLote);
+  if (lotes) lotes.close();
+  free(lote);
+
+  if (ok && total > capacidadeImagem()) {
+    LOG_ERRO("Cadastro: %u UIDs nao cabem na particao (max %u).", (unsigned)total, (unsigned)capacidadeImagem());
+    ok = false;
+  }
+
+  uint32_t bits = IMAGEM_FILTRO_BITS_UID ? (uint32_t)(total < 8 ? 8 : total) * IMAGEM_FILTRO_BITS_UID : 0;
+
+  // Apaga só os setores que a imagem vai ocupar
+  size_t bytes = sizeof(CabecalhoImagem) + total * sizeof(RegistroImagem) + bytesFiltro(bits);
+  if (ok) ok = esp_partition_erase_range(particao, 0, (bytes + IMAGEM_SETOR - 1) / IMAGEM_SETOR * IMAGEM_SETOR) == ESP_OK;
+
+  size_t numLotes = (total + IMAGEM_LOTE - 1) / IMAGEM_LOTE;
+  CursorLote  *cursores = ok && numLotes ? (CursorLote *)calloc(numLotes, sizeof(CursorLote)) : NULL;
+  SaidaImagem *saida    = ok ? (SaidaImagem *)calloc(1, sizeof(SaidaImagem)) : NULL;
+  File leitura = ok ? abrirArquivo(IMAGEM_LOTES, FILE_READ) : File();
+  ok = ok && saida && (numLotes == 0 || (cursores && leitura));
+
+  if (ok) {
+    saida->ok = true;
+    saida->filtro = bits ? (uint8_t *)calloc(1, bytesFiltro(bits)) : NULL;
+    if (saida->filtro) {
+      saida->bitsFiltro   = bits;
+      saida->hashesFiltro = (uint8_t)((IMAGEM_FILTRO_BITS_UID * 69 + 50) / 100);
+      if (saida->hashesFiltro == 0) saida->hashesFiltro = 1;
+    } else if (bits) {
+      LOG_AVISO("Cadastro: sem memoria para o filtro; imagem sem ele.");
+    }
+    for (size_t k = 0; k < numLotes; k++) {
+      cursores[k].pos = k * IMAGEM_LOTE;
+      cursores[k].fim = (k + 1) * IMAGEM_LOTE < total ? (k + 1) * IMAGEM_LOTE : total;
+    }
+    RegistroImagem atual;
+    bool temAtual = false;
+    for (;;) {
+      CursorLote *menor = NULL;
+      for (size_t k = 0; k < numLotes; k++) {
+        if (!cursorAtual(cursores[k], leitura)) continue;
+        if (!menor || compararChave(&cursores[k].buf[cursores[k].i], &menor->buf[menor->i]) < 0) {
+          menor = &cursores[k];
+        }
+      }
+      if (!menor) break;
+      const RegistroImagem &r = menor->buf[menor->i++];
+      if (temAtual && compararChave(&atual, &r) == 0) {
+        atual.papeis |= r.papeis;
+        continue;
+      }
+      if (temAtual) emitir(*saida, atual);
+      atual    = r;
+      temAtual = true;
+    }
+    if (temAtual) emitir(*saida, atual);
+    descarregarSaida(*saida);
+
+    if (saida->ok && saida->filtro) {
+      size_t off = sizeof(CabecalhoImagem) + saida->n * sizeof(RegistroImagem);
+      saida->ok  = esp_partition_write(particao, off, saida->filtro, bytesFiltro(saida->bitsFiltro)) == ESP_OK;
+      saida->crc = crc32Atualizar(saida->crc, saida->filtro, bytesFiltro(saida->bitsFiltro));
+      cab.bitsFiltro   = saida->bitsFiltro;
+      cab.hashesFiltro = saida->hashesFiltro;
+    }
+    cab.n            = saida->n;
+    cab.crcRegistros = saida->crc;
+    ok = saida->ok && esp_partition_write(particao, 0, &cab, sizeof(cab)) == ESP_OK;
+    free(saida->filtro);
+  }
+  if (leitura) leitura.close();
+  free(cursores);
+  free(saida);
+  removerArquivo(IMAGEM_LOTES);
+
+  CabecalhoImagem conferido;
+  if (!ok || !mapear(conferido)) {
+    LOG_ERRO("Cadastro: nao foi possivel montar a imagem; consultas varrem os arquivos.");
+    desmapear();
+    return false;
+  }
+  LOG_INFO("Cadastro: imagem montada com %u UID(s) em %lu ms%s.", (unsigned)cab.n,
+           (unsigned long)(millis() - t0), ignorados ? " (linhas invalidas ignoradas)" : "");
+  return true;
+}
+
+bool inicializarImagemCadastro() {
+  if (!mtxImagem) mtxImagem = xSemaphoreCreateMutex();
+  if (!mtxImagem) return false;
+  desmapear();
+  particao = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)IMAGEM_SUBTIPO,
+                                      IMAGEM_PARTICAO);
+  if (!particao) {
+    LOG_AVISO("Cadastro: sem a particao \"%s\"; consultas varrem os arquivos.", IMAGEM_PARTICAO);
+    return false;
+  }
+
+  CabecalhoImagem cab;
+  if (!mapear(cab) || !fontesConferem(cab) || !lerAcrescimos(cab)) {
+    return reconstruirImagemCadastro();
+  }
+  LOG_INFO("Cadastro: imagem com %u UID(s) + %u no delta.", (unsigned)numRegistros, (unsigned)numDelta);
+  return true;
+}
@@ -0,0 +1,68 @@
+// Imagem do cadastro numa partição própria da flash ("cadastro"), lida via
+// esp_partition_mmap().
+//
+// CARDS_FILE e ADMINS_FILE continuam sendo a fonte (listar, contar, apagar).
+// A consulta de cada toque, porém, não varre mais os arquivos: a imagem é um
+// vetor ordenado de UIDs binários de largura fixa com os papéis, e a busca
+// binária lê direto da flash mapeada no cache, sem copiar nada para o heap
+// (que fica para os buffers do WiFi/TLS). 10k UIDs = 120 KB de flash e 0 de RAM.
+//
+// O que mudou nos arquivos desde a última montagem da imagem fica num delta
+// pequeno em RAM (IMAGEM_DELTA_MAX UIDs) que vale por cima da imagem. Com o
+// delta cheio, ou no boot se um arquivo mudou por outro caminho que não um
+// append (UID apagado, arquivo trocado), a imagem é montada de novo.
+//
+// Na frente da busca há um filtro de Bloom gravado junto com a imagem: um
+// cartão de fora (pulseira de outra escola, bilhete de transporte) é recusado
+// depois de k bits lidos, sem a busca binária. IMAGEM_FILTRO_BITS_UID regula
+// a taxa de falsos positivos (~0,62^bits); os que passam vão para a busca.
+//
+// Sem a partição (tabela antiga) ou com a imagem inválida, papeisDoUid() cai
+// na varredura dos arquivos, como antes.
+#pragma once
+
+#include <Arduino.h>
+
+#define PAPEL_USUARIO      0x01   // em CARDS_FILE
+#define PAPEL_FUNCIONARIO  0x02   // em ADMINS_FILE
+
+#define IMAGEM_PARTICAO        "cadastro"
+#define IMAGEM_SUBTIPO         0x40    // data, subtipo livre para a aplicação
+#define IMAGEM_DELTA_MAX       64
+#define IMAGEM_LOTE            512     // UIDs ordenados na RAM por vez ao montar
+#define IMAGEM_UID_BYTES       10
+#define IMAGEM_FILTRO_BITS_UID 10     // ~1% de falsos positivos; 0 = sem filtro
+
+// Boot, depois de montarArmazenamento(): mapeia a imagem, confere o CRC e se
+// ela ainda corresponde aos arquivos; lê para o delta o que foi acrescentado
+// depois dela. Monta de novo se preciso. false = sem imagem (usa os arquivos).
+bool inicializarImagemCadastro();
+
+// Monta a imagem a partir de CARDS_FILE e ADMINS_FILE e zera o delta. Apaga e
+// regrava a partição (segundos no ESP32); enquanto isso as consultas usam os
+// arquivos.
+bool reconstruirImagemCadastro();
+
+// Papéis do UID (PAPEL_*) pela imagem + delta. false se não há imagem ativa
+// ou o UID não é hex: aí quem chama consulta os arquivos.
+bool consultarImagemCadastro(const String &uid, uint8_t &papeis);
+
+// Depois de gravar/remover o UID no arquivo do 'papel': atualiza o delta
+// (ou remonta a imagem, se ele encheu).
+void anotarCadastro(const String &uid, uint8_t papel, bool cadastrado);
+
+size_t uidsImagemCadastro();   // UIDs na imagem (0 = sem imagem)
+size_t uidsDeltaCadastro();
+
+// Consultas que chegaram ao filtro, recusadas por ele e falsos positivos
+// (passaram e a busca não achou). Zeradas com as métricas.
+struct EstatisticasFiltro {
+  uint32_t consultas;
+  uint32_t recusados;
+  uint32_t falsosPositivos;
+  uint32_t bits;      // tamanho do filtro atual (0 = sem filtro)
+  uint8_t  hashes;
+  size_t   uids;
+};
+void estatisticasFiltroCadastro(EstatisticasFiltro &e);
+void zerarEstatisticasFiltro();
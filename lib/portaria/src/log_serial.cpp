@@ -0,0 +1,121 @@
+#include "log_serial.h"
+
+#include <atomic>
+#include <stdarg.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Fila circular limitada com número de sequência por slot (MPMC sem trava):
+// o produtor reserva a posição com CAS em 'posEscrita', escreve o texto e só
+// então publica o slot gravando seq = pos + 1. A TaskLog lê na ordem.
+struct SlotLog {
+  std::atomic<uint32_t> seq;
+  uint16_t              len;
+  char                  texto[LOG_SLOT_TAM];
+};
+
+static SlotLog               slots[LOG_SLOTS];
+static std::atomic<uint32_t> posEscrita(0);
+static std::atomic<uint32_t> posLeitura(0);
+static std::atomic<uint32_t> descartes(0);
+static bool                  assincrono = false;
+
+static void iniciarSlots() {
+  for (uint32_t i = 0; i < LOG_SLOTS; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+// Formata com '\n' no fim; se não couber, termina em "...\n"
+static uint16_t formatar(char *dst, const char *fmt, va_list ap) {
+  int n = vsnprintf(dst, LOG_SLOT_TAM - 1, fmt, ap);
+  if (n < 0) n = 0;
+  if (n > LOG_SLOT_TAM - 2) {
+    memcpy(dst + LOG_SLOT_TAM - 5, "...", 3);
+    n = LOG_SLOT_TAM - 2;
+  }
+  dst[n++] = '\n';
+  return (uint16_t)n;
+}
+
+void logEscrever(uint8_t nivel, const char *fmt, ...) {
+  (void)nivel;
+  va_list ap;
+  va_start(ap, fmt);
+
+  if (!assincrono) {
+    char buf[LOG_SLOT_TAM];
+    uint16_t n = formatar(buf, fmt, ap);
+    va_end(ap);
+    Serial.write((const uint8_t *)buf, n);
+    return;
+  }
+
+  uint32_t pos = posEscrita.load(std::memory_order_relaxed);
+  SlotLog *slot;
+  for (;;) {
+    slot = &slots[pos & (LOG_SLOTS - 1)];
+    int32_t dif = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+    if (dif == 0) {
+      if (posEscrita.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (dif < 0) {
+      // slot ainda não foi lido: buffer cheio
+      va_end(ap);
+      descartes.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = posEscrita.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->len = formatar(slot->texto, fmt, ap);
+  va_end(ap);
+  slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+size_t logDrenar(size_t max) {
+  size_t escritas = 0;
+  while (escritas < max) {
+    uint32_t pos  = posLeitura.load(std::memory_order_relaxed);
+    SlotLog *slot = &slots[pos & (LOG_SLOTS - 1)];
+    if (slot->seq.load(std::memory_order_acquire) != pos + 1) break;   // vazio ou ainda sendo escrito
+
+    Serial.write((const uint8_t *)slot->texto, slot->len);
+    posLeitura.store(pos + 1, std::memory_order_relaxed);
+    slot->seq.store(pos + LOG_SLOTS, std::memory_order_release);
+    escritas++;
+  }
+  return escritas;
+}
+
+uint32_t logDescartes() {
+  return descartes.load(std::memory_order_relaxed);
+}
+
+static void taskLog(void *pvParameters) {
+  (void) pvParameters;
+
+  uint32_t descartesAvisados = 0;
+  for (;;) {
+    if (logDrenar() == 0) {
+      uint32_t d = logDescartes();
+      if (d != descartesAvisados) {
+        Serial.printf("[log] %lu mensagem(ns) descartada(s): buffer cheio.\n",
+                      (unsigned long)(d - descartesAvisados));
+        descartesAvisados = d;
+      }
+      vTaskDelay(pdMS_TO_TICKS(20));
+    }
+  }
+}
+
+bool logIniciarTarefa() {
+  if (assincrono) return true;
+  iniciarSlots();
+  // prioridade 0: só escreve quando loop() e TaskProcessaCartoes estão parados
+  if (xTaskCreate(taskLog, "TaskLog", 2048, NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
+    Serial.println("ERRO: nao foi possivel criar TaskLog, log segue sincrono.");
+    return false;
+  }
+  assincrono = true;
+  return true;
+}
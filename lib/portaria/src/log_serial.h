@@ -0,0 +1,62 @@
+// Log em níveis sem bloquear quem loga.
+//
+// A 9600 baud cada caractere leva ~1 ms: um println de 100 caracteres num
+// evento de cartão segurava a task até a UART esvaziar. Aqui quem loga só
+// formata a mensagem num slot de um buffer circular (sem trava, seguro entre
+// tasks) e a TaskLog, de prioridade baixa, escreve na Serial.
+//
+// O nível é decidido na compilação: acima de LOG_NIVEL a chamada fica dentro
+// de um if (0) e o compilador descarta a string e a formatação (os argumentos
+// continuam checados). -DLOG_NIVEL=4 liga os LOG_DEBUG.
+// Respostas pedidas pelo operador na Serial (listagens, ajuda) continuam
+// usando Serial direto; o log é para eventos e diagnóstico.
+#pragma once
+
+#include <Arduino.h>
+
+#define LOG_NIVEL_ERRO   1
+#define LOG_NIVEL_AVISO  2
+#define LOG_NIVEL_INFO   3
+#define LOG_NIVEL_DEBUG  4
+
+#ifndef LOG_NIVEL
+#define LOG_NIVEL LOG_NIVEL_INFO
+#endif
+
+#define LOG_SLOTS     32    // potência de 2
+#define LOG_SLOT_TAM  128   // mensagem maior é truncada com "..."
+
+void logEscrever(uint8_t nivel, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#if LOG_NIVEL >= LOG_NIVEL_ERRO
+#define LOG_ERRO(...)  logEscrever(LOG_NIVEL_ERRO, __VA_ARGS__)
+#else
+#define LOG_ERRO(...)  do { if (0) logEscrever(LOG_NIVEL_ERRO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_NIVEL >= LOG_NIVEL_AVISO
+#define LOG_AVISO(...) logEscrever(LOG_NIVEL_AVISO, __VA_ARGS__)
+#else
+#define LOG_AVISO(...) do { if (0) logEscrever(LOG_NIVEL_AVISO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_NIVEL >= LOG_NIVEL_INFO
+#define LOG_INFO(...)  logEscrever(LOG_NIVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)  do { if (0) logEscrever(LOG_NIVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_NIVEL >= LOG_NIVEL_DEBUG
+#define LOG_DEBUG(...) logEscrever(LOG_NIVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) logEscrever(LOG_NIVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+// Cria a TaskLog. Antes disso (boot) e no PC, logEscrever() escreve direto na Serial.
+bool logIniciarTarefa();
+
+// Escreve na Serial até 'max' mensagens prontas; devolve quantas escreveu
+size_t logDrenar(size_t max = LOG_SLOTS);
+
+// Mensagens perdidas porque o buffer estava cheio
+uint32_t logDescartes();
@@ -0,0 +1,186 @@
+#include "metricas.h"
+
+#include "armazenamento.h"
+#include "estado.h"
+#include "imagem_cadastro.h"
+#include "log_serial.h"
+#include "serializador.h"
+
+static HistogramaLatencia histogramas[MET_TOTAL];
+static portMUX_TYPE       muxMetricas = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *NOMES_METRICAS[MET_TOTAL] = {
+  "detectar_fila",
+  "espera_fila",
+  "consulta_papel",
+  "append_log",
+  "publicar_mov",
+  "toque_registro",
+};
+
+static uint8_t baldeDe(uint32_t us) {
+  if (us < 32) return 0;
+  uint8_t b = (uint8_t)(31 - __builtin_clz(us) - 4);   // us em [2^(b+4), 2^(b+5))
+  return b < METRICA_BALDES ? b : METRICA_BALDES - 1;
+}
+
+void metricaRegistrar(MetricaLatencia m, uint32_t us) {
+  if (m >= MET_TOTAL) return;
+  HistogramaLatencia &h = histogramas[m];
+  portENTER_CRITICAL(&muxMetricas);
+  h.baldes[baldeDe(us)]++;
+  h.n++;
+  h.somaUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+  portEXIT_CRITICAL(&muxMetricas);
+}
+
+const char *metricaNome(MetricaLatencia m) {
+  return m < MET_TOTAL ? NOMES_METRICAS[m] : "?";
+}
+
+bool metricaCopiar(MetricaLatencia m, HistogramaLatencia &dst) {
+  if (m >= MET_TOTAL) return false;
+  portENTER_CRITICAL(&muxMetricas);
+  dst = histogramas[m];
+  portEXIT_CRITICAL(&muxMetricas);
+  return dst.n > 0;
+}
+
+uint32_t metricaPercentilUs(const HistogramaLatencia &h, uint8_t pct) {
+  if (h.n == 0) return 0;
+  uint32_t alvo = (uint32_t)(((uint64_t)h.n * pct + 99) / 100);
+  if (alvo == 0) alvo = 1;
+  uint32_t acumulado = 0;
+  for (uint8_t b = 0; b < METRICA_BALDES; b++) {
+    acumulado += h.baldes[b];
+    if (acumulado >= alvo) {
+      if (b == METRICA_BALDES - 1) return h.maxUs;
+      uint32_t limite = 1UL << (b + 5);
+      return limite < h.maxUs ? limite : h.maxUs;
+    }
+  }
+  return h.maxUs;
+}
+
+void zerarMetricas() {
+  portENTER_CRITICAL(&muxMetricas);
+  memset(histogramas, 0, sizeof(histogramas));
+  portEXIT_CRITICAL(&muxMetricas);
+  zerarEstatisticasFiltro();
+}
+
+void listarMetricasSerial() {
+  Serial.println("===== LATENCIAS (us) =====");
+  Serial.println("metrica           n      p50      p99      max    media");
+  HistogramaLatencia h;
+  char linha[96];
+  for (int m = 0; m < MET_TOTAL; m++) {
+    if (!metricaCopiar((MetricaLatencia)m, h)) {
+      snprintf(linha, sizeof(linha), "%-15s %3u", metricaNome((MetricaLatencia)m), 0u);
+    } else {
+      snprintf(linha, sizeof(linha), "%-15s %3lu %8lu %8lu %8lu %8lu",
+               metricaNome((MetricaLatencia)m), (unsigned long)h.n,
+               (unsigned long)metricaPercentilUs(h, 50), (unsigned long)metricaPercentilUs(h, 99),
+               (unsigned long)h.maxUs, (unsigned long)(h.somaUs / h.n));
+    }
+    Serial.println(linha);
+  }
+  EstatisticasFiltro f;
+  estatisticasFiltroCadastro(f);
+  snprintf(linha, sizeof(linha), "filtro cadastro: %lu consultas, %lu recusadas, %lu falsos positivos",
+           (unsigned long)f.consultas, (unsigned long)f.recusados, (unsigned long)f.falsosPositivos);
+  Serial.println(linha);
+  if (f.bits) {
+    snprintf(linha, sizeof(linha), "  (%lu bits, k=%u, %lu UIDs)",
+             (unsigned long)f.bits, (unsigned)f.hashes, (unsigned long)f.uids);
+    Serial.println(linha);
+  }
+  Serial.println("==========================");
+}
+
+void medirAppendSerial(uint8_t pctOcupacao, uint16_t n) {
+  static const char *ENCHIMENTO = "/enchimento.bin";
+  static const char *ALVO       = "/append_teste.txt";
+  static const char  LINHA[]    = "-11223344- recebeu -a1b2c3d4- \xC3\xA0s -07:55:01- do dia -13/10/2025-";
+
+  size_t total = backendArquivos.bytesTotais();
+  size_t alvo  = total / 100 * pctOcupacao;
+  uint8_t bloco[256];
+  memset(bloco, 0xA5, sizeof(bloco));
+
+  File f = abrirArquivo(ENCHIMENTO, FILE_APPEND);
+  while (f && backendArquivos.bytesUsados() < alvo) {
+    size_t escritos = 0;
+    for (int i = 0; i < 16; i++) escritos += f.write(bloco, sizeof(bloco));   // 4 KB por conferida
+    f.flush();
+    if (escritos < 16 * sizeof(bloco)) break;   // cheio antes do alvo
+  }
+  if (f) f.close();
+  size_t usados = backendArquivos.bytesUsados();   // a ocupação medida, antes dos appends
+
+  HistogramaLatencia h;
+  memset(&h, 0, sizeof(h));
+  String linha = LINHA;
+  for (uint16_t i = 0; i < n; i++) {
+    uint32_t t0 = micros();
+    bool ok = appendRegistro(ALVO, linha);
+    uint32_t us = micros() - t0;
+    if (!ok) break;
+    h.baldes[baldeDe(us)]++;
+    h.n++;
+    h.somaUs += us;
+    if (us > h.maxUs) h.maxUs = us;
+  }
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "Append (%s, %lu%% de %lu KB ocupados): n=%lu p50=%lu p99=%lu max=%lu us",
+           backendArquivos.nome, (unsigned long)(total ? usados * 100 / total : 0),
+           (unsigned long)(total / 1024), (unsigned long)h.n,
+           (unsigned long)metricaPercentilUs(h, 50), (unsigned long)metricaPercentilUs(h, 99),
+           (unsigned long)h.maxUs);
+  Serial.println(msg);
+  if (h.n < n) Serial.println("Aviso: o append falhou antes do fim (particao cheia?).");
+
+  removerArquivo(ALVO);
+  removerArquivo(ENCHIMENTO);
+}
+
+// Uma mensagem por métrica: com os 20 baldes cabe no buffer padrão do PubSubClient
+void publishMetricasToMQTT() {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao envia metricas.");
+    return;
+  }
+
+  HistogramaLatencia h;
+  for (int m = 0; m < MET_TOTAL; m++) {
+    metricaCopiar((MetricaLatencia)m, h);
+
+    char buf[320];
+    Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+    s.objeto().texto("context", "metrics").texto("nome", metricaNome((MetricaLatencia)m));
+    s.natural("n", h.n);
+    s.natural("p50_us", metricaPercentilUs(h, 50));
+    s.natural("p99_us", metricaPercentilUs(h, 99));
+    s.natural("max_us", h.maxUs);
+    s.lista("baldes");
+    for (uint8_t b = 0; b < METRICA_BALDES; b++) s.natural(NULL, h.baldes[b]);
+    s.fechar().fechar();
+    s.publicar(MQTT_TOPIC_STATUS);
+  }
+
+  EstatisticasFiltro f;
+  estatisticasFiltroCadastro(f);
+  char buf[192];
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+  s.objeto().texto("context", "metrics").texto("nome", "filtro_cadastro");
+  s.natural("consultas", f.consultas);
+  s.natural("recusados", f.recusados);
+  s.natural("falsos_positivos", f.falsosPositivos);
+  s.natural("bits", f.bits);
+  s.natural("hashes", f.hashes);
+  s.natural("uids", f.uids);
+  s.fechar();
+  s.publicar(MQTT_TOPIC_STATUS);
+}
@@ -0,0 +1,42 @@
+// Histogramas de latência do caminho do cartão (leitor -> fila -> task -> log -> MQTT).
+#pragma once
+
+#include <Arduino.h>
+
+// Baldes em escala log2 de microssegundos: o balde 0 conta < 32 us, o balde b
+// conta [2^(b+4), 2^(b+5)) e o último junta tudo a partir de ~8,4 s.
+#define METRICA_BALDES 20
+
+enum MetricaLatencia {
+  MET_DETECTAR_FILA,     // cartão lido no loop() -> xQueueSend concluído
+  MET_ESPERA_FILA,       // tempo parado na filaCartoes até a task pegar
+  MET_CONSULTA_PAPEL,    // papeisDoUid(): imagem do cadastro (ou os dois arquivos)
+  MET_APPEND_LOG,        // appendLine() em MOVIMENTACOES_FILE
+  MET_PUBLICAR_MOV,      // publish em MQTT_TOPIC_MOV
+  MET_TOQUE_REGISTRO,    // cartão lido -> movimentação gravada (logo antes do LED verde)
+  MET_TOTAL
+};
+
+struct HistogramaLatencia {
+  uint32_t baldes[METRICA_BALDES];
+  uint32_t n;
+  uint32_t maxUs;
+  uint64_t somaUs;
+};
+
+// Cada métrica tem um só escritor (loop() ou TaskProcessaCartoes); o custo é
+// um incremento dentro de uma seção crítica curta.
+void        metricaRegistrar(MetricaLatencia m, uint32_t us);
+const char *metricaNome(MetricaLatencia m);
+bool        metricaCopiar(MetricaLatencia m, HistogramaLatencia &dst);   // false se vazia
+uint32_t    metricaPercentilUs(const HistogramaLatencia &h, uint8_t pct); // limite superior do balde
+void        zerarMetricas();
+
+void listarMetricasSerial();
+
+// Enche a partição até 'pctOcupacao' % com um arquivo de lixo, mede 'n'
+// appendRegistro() de uma linha típica do log e mostra p50/p99/max na Serial.
+// Apaga os dois arquivos no fim. Para comparar LittleFS e SPIFFS, rodar nos
+// dois builds (o SPIFFS com -DPORTARIA_FS_SPIFFS).
+void medirAppendSerial(uint8_t pctOcupacao, uint16_t n);
+void publishMetricasToMQTT();   // uma mensagem por métrica em MQTT_TOPIC_STATUS
@@ -0,0 +1,729 @@
+#include "movimentacoes.h"
+
+#include "comandos.h"
+#include "config.h"
+#include "datas.h"
+#include "estado.h"
+#include "estado_retido.h"
+#include "log_serial.h"
+#include "metricas.h"
+#include "relatorios.h"
+
+// Posição de 'pad' em s[de..len), ou -1
+static long buscarEm(const char *s, size_t len, size_t de, const char *pad, size_t padLen) {
+  if (padLen > len) return -1;
+  for (size_t i = de; i + padLen <= len; i++) {
+    if (s[i] == pad[0] && memcmp(s + i, pad, padLen) == 0) return (long)i;
+  }
+  return -1;
+}
+
+static long buscarHifen(const char *s, size_t len, size_t de) {
+  const char *h = (de < len) ? (const char*)memchr(s + de, '-', len - de) : NULL;
+  return h ? (long)(h - s) : -1;
+}
+
+// Lê linha "-FUNC- recebeu/liberou -USER- às -HH:MM:SS- do dia -DD/MM/AAAA-"
+// Os campos de 'mov' apontam para dentro de 's'.
+bool parseMovLine(const char *linha, size_t lenLinha, MovLinha &mov) {
+  static const char PAD_RECEBEU[] = " recebeu -";
+  static const char PAD_LIBEROU[] = " liberou -";
+  static const char PAD_HORA[]    = " às -";
+  static const char PAD_DATA[]    = " do dia -";
+
+  Trecho t = trechoAparado(linha, corpoRegistro(linha, lenLinha));
+  const char *s = t.p;
+  size_t len    = t.len;
+  if (!len || s[0] != '-') return false;
+
+  long secondDash = buscarHifen(s, len, 1);
+  if (secondDash < 0) return false;
+  mov.func = trechoAparado(s + 1, secondDash - 1);
+
+  long idxTok = buscarEm(s, len, secondDash, PAD_RECEBEU, sizeof(PAD_RECEBEU) - 1);
+  size_t lenTok = sizeof(PAD_RECEBEU) - 1;
+  mov.recebeu = (idxTok >= 0);
+  if (!mov.recebeu) {
+    idxTok = buscarEm(s, len, secondDash, PAD_LIBEROU, sizeof(PAD_LIBEROU) - 1);
+    lenTok = sizeof(PAD_LIBEROU) - 1;
+    if (idxTok < 0) return false;
+  }
+
+  size_t uidUserStart = idxTok + lenTok;
+  long uidUserEnd = buscarHifen(s, len, uidUserStart);
+  if (uidUserEnd < 0) return false;
+  mov.user = trechoAparado(s + uidUserStart, uidUserEnd - uidUserStart);
+
+  long idxHora = buscarEm(s, len, uidUserEnd, PAD_HORA, sizeof(PAD_HORA) - 1);
+  if (idxHora < 0) return false;
+  size_t horaStart = idxHora + sizeof(PAD_HORA) - 1;
+  long horaEnd = buscarHifen(s, len, horaStart);
+  if (horaEnd < 0) return false;
+  mov.hora = trechoAparado(s + horaStart, horaEnd - horaStart);
+
+  long idxData = buscarEm(s, len, horaEnd, PAD_DATA, sizeof(PAD_DATA) - 1);
+  if (idxData < 0) return false;
+  size_t dataStart = idxData + sizeof(PAD_DATA) - 1;
+  long dataEnd = buscarHifen(s, len, dataStart);
+  if (dataEnd < 0) return false;
+  mov.data = trechoAparado(s + dataStart, dataEnd - dataStart);
+
+  return true;
+}
+
+// =========== Índice de datas do arquivo de movimentações ===========
+// MOVIMENTACOES_IDX guarda, para cada dia, o offset (em bytes) da primeira
+// linha daquele dia em MOVIMENTACOES_FILE. Cada entrada tem 8 bytes e elas
+// ficam em ordem crescente de data, então dá pra fazer busca binária com seek().
+struct EntradaIndiceData {
+  int32_t  chave;    // dias desde 01/01/1970
+  uint32_t offset;   // byte da primeira linha do dia
+};
+
+int32_t ultimaChaveIndexada = -1;
+
+bool lerEntradaIndice(File &idx, size_t pos, EntradaIndiceData &e) {
+  if (!idx.seek(pos * sizeof(EntradaIndiceData))) return false;
+  return idx.read((uint8_t*)&e, sizeof(e)) == sizeof(e);
+}
+
+// Lê o log a partir de 'desde' e acrescenta no índice os dias ainda não indexados
+size_t indexarTrechoMovimentacoes(File &log, File &idx, size_t desde) {
+  size_t novas = 0;
+  log.seek(desde);
+
+  TravaLeituraLog trava;
+  LeitorLinhas leitor(log, bufLeituraLog, sizeof(bufLeituraLog));
+  Trecho linha;
+  MovLinha mov;
+
+  while (leitor.proxima(linha)) {
+    if (!parseMovLine(linha.p, linha.len, mov)) continue;
+
+    int32_t chave = diaNumFromStr(mov.data.p, mov.data.len);
+    if (chave <= ultimaChaveIndexada) continue;   // mantém o índice ordenado
+
+    EntradaIndiceData e = { chave, (uint32_t)leitor.offsetLinha() };
+    idx.write((const uint8_t*)&e, sizeof(e));
+    ultimaChaveIndexada = chave;
+    novas++;
+  }
+
+  return novas;
+}
+
+// Refaz o índice inteiro a partir do log (arquivo sumiu ou ficou inconsistente)
+bool reconstruirIndiceMovimentacoes() {
+  File idx = abrirArquivo(MOVIMENTACOES_IDX, FILE_WRITE);
+  if (!idx) {
+    LOG_ERRO("ERRO: nao foi possivel criar indice de movimentacoes.");
+    return false;
+  }
+
+  ultimaChaveIndexada = -1;
+  size_t dias = 0;
+
+  File log = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (log) {
+    dias = indexarTrechoMovimentacoes(log, idx, 0);
+    log.close();
+  }
+  idx.close();
+
+  LOG_INFO("Indice de movimentacoes reconstruido (%u dias).", (unsigned)dias);
+  return true;
+}
+
+// Chamado no boot: confere a última entrada do índice contra o log e indexa
+// só o que foi gravado depois dela (ex.: queda de energia entre gravar a
+// linha e gravar a entrada do índice). Se não bater, reconstrói do zero.
+void sincronizarIndiceMovimentacoes() {
+  File idx = abrirArquivo(MOVIMENTACOES_IDX, FILE_READ);
+  if (!idx) {
+    LOG_INFO("Indice de movimentacoes ausente, reconstruindo...");
+    reconstruirIndiceMovimentacoes();
+    return;
+  }
+
+  size_t numEntradas = idx.size() / sizeof(EntradaIndiceData);
+  EntradaIndiceData ultima = { -1, 0 };
+  bool okIdx = (idx.size() % sizeof(EntradaIndiceData) == 0);
+  if (okIdx && numEntradas > 0) {
+    okIdx = lerEntradaIndice(idx, numEntradas - 1, ultima);
+  }
+  idx.close();
+
+  File log = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (!log) {
+    // sem log: índice só é válido se estiver vazio
+    if (!okIdx || numEntradas > 0) reconstruirIndiceMovimentacoes();
+    else ultimaChaveIndexada = -1;
+    return;
+  }
+
+  if (okIdx && numEntradas > 0) {
+    // a linha apontada pela última entrada tem que existir e ser daquele dia
+    okIdx = false;
+    if (ultima.offset < log.size() && log.seek(ultima.offset)) {
+      TravaLeituraLog trava;
+      LeitorLinhas leitor(log, bufLeituraLog, sizeof(bufLeituraLog));
+      Trecho linha;
+      MovLinha mov;
+      okIdx = leitor.proxima(linha) &&
+              parseMovLine(linha.p, linha.len, mov) &&
+              diaNumFromStr(mov.data.p, mov.data.len) == ultima.chave;
+    }
+  }
+
+  if (!okIdx) {
+    log.close();
+    LOG_INFO("Indice de movimentacoes inconsistente, reconstruindo...");
+    reconstruirIndiceMovimentacoes();
+    return;
+  }
+
+  ultimaChaveIndexada = ultima.chave;
+
+  File idxAppend = abrirArquivo(MOVIMENTACOES_IDX, FILE_APPEND);
+  if (idxAppend) {
+    size_t novas = indexarTrechoMovimentacoes(log, idxAppend, numEntradas > 0 ? ultima.offset : 0);
+    idxAppend.close();
+    if (novas) {
+      LOG_INFO("Indice de movimentacoes: %u dia(s) recuperado(s).", (unsigned)novas);
+    }
+  }
+  log.close();
+}
+
+// Acrescenta a entrada do dia no índice se essa for a primeira linha do dia
+void indexarMovimentacao(const String &dataStr, size_t offsetLinha) {
+  int32_t chave = diaNumFromStr(dataStr);
+  if (chave <= ultimaChaveIndexada) return;
+
+  File idx = abrirArquivo(MOVIMENTACOES_IDX, FILE_APPEND);
+  if (!idx) {
+    LOG_ERRO("ERRO ao atualizar indice de movimentacoes.");
+    return;
+  }
+  EntradaIndiceData e = { chave, (uint32_t)offsetLinha };
+  idx.write((const uint8_t*)&e, sizeof(e));
+  idx.close();
+  ultimaChaveIndexada = chave;
+}
+
+// Offset da primeira linha com data >= chave (busca binária no índice).
+// Sem índice, devolve 0 e a consulta cai no scan completo.
+size_t offsetMovimentacoesDesde(int32_t chave) {
+  File idx = abrirArquivo(MOVIMENTACOES_IDX, FILE_READ);
+  if (!idx) return 0;
+
+  size_t lo = 0;
+  size_t hi = idx.size() / sizeof(EntradaIndiceData);
+  size_t total = hi;
+  EntradaIndiceData e;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (!lerEntradaIndice(idx, mid, e)) {
+      idx.close();
+      return 0;
+    }
+    if (e.chave < chave) lo = mid + 1;
+    else                 hi = mid;
+  }
+
+  size_t offset = SIZE_MAX;   // nenhum dia >= chave: nada a ler
+  if (lo < total && lerEntradaIndice(idx, lo, e)) {
+    offset = e.offset;
+  }
+  idx.close();
+  return offset;
+}
+
+// Abre MOVIMENTACOES_FILE já posicionado na primeira linha com data >= chave
+File abrirMovimentacoesDesde(int32_t chave) {
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (!f || chave < 0) return f;
+
+  size_t offset = offsetMovimentacoesDesde(chave);
+  if (offset == SIZE_MAX) {
+    f.seek(0, SeekEnd);
+  } else if (offset < f.size()) {
+    f.seek(offset);
+  }
+  return f;
+}
+
+// =========== Recuperação do fim do log no boot ===========
+static uint32_t recuperados = 0;
+static uint32_t descartados = 0;
+
+uint32_t registrosRecuperados() { return recuperados; }
+uint32_t registrosDescartados() { return descartados; }
+
+void recuperarCaudaMovimentacoes(size_t desde) {
+  recuperados = 0;
+  descartados = 0;
+
+  File f = abrirArquivo(MOVIMENTACOES_FILE, "r+");
+  if (!f) return;
+  size_t tamanho = f.size();
+
+  uint8_t c = '\n';
+  if (desde == SIZE_MAX || desde > tamanho ||
+      (desde > 0 && (!f.seek(desde - 1) || f.read(&c, 1) != 1 || c != '\n'))) {
+    desde = tamanho > RECUPERACAO_JANELA ? tamanho - RECUPERACAO_JANELA : 0;
+    c = '\n';
+    if (desde > 0 && (!f.seek(desde - 1) || f.read(&c, 1) != 1)) c = 0;
+  }
+  if (desde >= tamanho || !f.seek(desde)) {
+    f.close();
+    return;
+  }
+
+  uint32_t t0 = millis();
+  size_t marcar[RECUPERACAO_MAX_MARCAR];
+  uint8_t numMarcar = 0;
+  bool selarFim = false;     // o último registro não tem '\n'
+  {
+    TravaLeituraLog trava;
+    LeitorLinhas leitor(f, bufLeituraLog, sizeof(bufLeituraLog));
+    Trecho linha;
+    MovLinha mov;
+    bool primeira = true;
+
+    while (leitor.proxima(linha)) {
+      bool partida = primeira && c != '\n';   // janela começou no meio de uma linha
+      primeira = false;
+      if (partida || !trechoAparado(linha.p, linha.len).len || linha.p[0] == '#') continue;
+
+      bool cortado = (leitor.offsetLinha() + linha.len == tamanho);
+      SituacaoRegistro sit = verificarRegistro(linha.p, linha.len);
+      // sem moldura só vale linha inteira de versão antiga
+      bool ok = (sit == REGISTRO_OK) ||
+                (sit == REGISTRO_SEM_MOLDURA && parseMovLine(linha.p, linha.len, mov));
+      if (cortado) selarFim = true;
+      if (ok) {
+        recuperados++;
+        continue;
+      }
+      descartados++;
+      LOG_AVISO("Registro %s descartado no byte %lu: %.*s", cortado ? "cortado" : "corrompido",
+                (unsigned long)leitor.offsetLinha(), (int)linha.len, linha.p);
+      if (numMarcar < RECUPERACAO_MAX_MARCAR) marcar[numMarcar++] = leitor.offsetLinha();
+    }
+  }
+
+  bool ok = true;
+  for (uint8_t i = 0; i < numMarcar; i++) {
+    ok = ok && f.seek(marcar[i]) && f.write((const uint8_t*)"#", 1) == 1;
+  }
+  if (selarFim) {
+    ok = ok && f.seek(tamanho) && f.write((const uint8_t*)"\n", 1) == 1;
+  }
+  f.close();
+
+  if (!ok) LOG_ERRO("ERRO ao marcar registros descartados do log.");
+  if (descartados || selarFim) {
+    LOG_AVISO("Log: %lu registro(s) conferido(s), %lu descartado(s) a partir do byte %lu, %lu ms",
+              (unsigned long)recuperados, (unsigned long)descartados, (unsigned long)desde,
+              (unsigned long)(millis() - t0));
+  } else {
+    LOG_INFO("Log: %lu registro(s) conferido(s) a partir do byte %lu, %lu ms",
+             (unsigned long)recuperados, (unsigned long)desde, (unsigned long)(millis() - t0));
+  }
+}
+
+// ======================= Histórico em fatias =======================
+// Um get_history percorre o log inteiro: cada volta do loop() manda no máximo
+// HISTORICO_FATIA_LINHAS linhas ou HISTORICO_FATIA_MS, com a trava do log só
+// durante a fatia, e o resto volta para a filaComandos (continuarNoLoop). O
+// leitor de cartões e a TaskProcessaCartoes seguem atendidos entre as fatias.
+
+static void continuarHistorico(const ArgsComando &);
+
+// Fora da tabela de comandos: só entra na fila pelo próprio histórico
+static const Comando CONTINUAR_HISTORICO = { "get_history", 0, {}, COMANDO_LONGO, continuarHistorico, NULL };
+
+static File         historico;
+static size_t       historicoPos, historicoFim;   // trecho do log ainda por enviar
+static bool         historicoPularPrimeira;       // o registro em 'apos' quem pediu já tem
+static FormatoCarga historicoFormato;
+static uint32_t     historicoLinhas, historicoInicioMs;
+
+static void encerrarHistorico() {
+  if (historico) historico.close();
+  historico = File();
+}
+
+// Manda a próxima fatia; false quando acabou (ou o MQTT caiu)
+static bool publicarFatiaHistorico() {
+  if (!mqttClient.connected()) {
+    LOG_AVISO("Historico interrompido: MQTT desconectado apos %lu linha(s).", (unsigned long)historicoLinhas);
+    encerrarHistorico();
+    return false;
+  }
+
+  uint32_t t0 = millis();
+  uint16_t linhas = 0;
+  bool fimDoLog = true;
+  char buf[192];
+  {
+    TravaLeituraLog trava;   // completarMovimentacoesSemHora() reescreve linhas no lugar
+    historico.seek(historicoPos);
+    LeitorLinhas leitor(historico, bufLeituraLog, sizeof(bufLeituraLog));
+    Trecho linha;
+    MovLinha mov;
+    for (;;) {
+      if (linhas >= HISTORICO_FATIA_LINHAS || (linhas > 0 && millis() - t0 >= HISTORICO_FATIA_MS)) {
+        fimDoLog = false;
+        break;
+      }
+      if (!leitor.proxima(linha) || leitor.offsetLinha() >= historicoFim) break;
+      historicoPos = leitor.offsetLinha() + linha.len + 1;
+
+      if (historicoPularPrimeira) {
+        historicoPularPrimeira = false;
+        continue;
+      }
+      if (!trechoAparado(linha.p, linha.len).len || linha.p[0] == '#') continue;   // vazia ou descartada
+
+      if (!parseMovLine(linha.p, linha.len, mov)) {
+        LOG_AVISO("Linha de movimentacao em formato inesperado, ignorando: %.*s",
+                  (int)linha.len, linha.p);
+        continue;
+      }
+
+      Serializador s(buf, sizeof(buf), historicoFormato);
+      serializarMovimentacao(s, leitor.offsetLinha(), mov.func, mov.user, mov.recebeu ? "recebeu" : "liberou",
+                             mov.data, mov.hora);
+      if (!s.publicar(MQTT_TOPIC_MOV)) {
+        LOG_AVISO("MQTT: falha ao publicar linha de historico.");
+      }
+      linhas++;
+    }
+  }
+  historicoLinhas += linhas;
+
+  if (!fimDoLog && historicoPos < historicoFim) return true;
+  LOG_INFO("Historico enviado: %lu linha(s) em %lu ms.", (unsigned long)historicoLinhas,
+           (unsigned long)(millis() - historicoInicioMs));
+  encerrarHistorico();
+  return false;
+}
+
+static void agendarFatiaHistorico() {
+  if (!publicarFatiaHistorico()) return;
+  if (!continuarNoLoop(CONTINUAR_HISTORICO)) {
+    LOG_ERRO("Historico interrompido: filaComandos cheia.");
+    encerrarHistorico();
+  }
+}
+
+static void continuarHistorico(const ArgsComando &) {
+  if (historico) agendarFatiaHistorico();
+}
+
+// Começa o envio (todo, ou depois de 'apos') e manda a primeira fatia
+void publishMovHistoryToMQTT(long apos) {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao envia historico.");
+    return;
+  }
+  if (historico) {
+    LOG_AVISO("Historico: ja ha um envio em andamento; pedido recusado.");
+    recusarComandoAtual("busy");
+    return;
+  }
+
+  historico = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (!historico) {
+    LOG_INFO("Nenhum arquivo de movimentacoes para enviar.");
+    return;
+  }
+
+  historicoFim = historico.size();   // o que for gravado depois fica para o próximo pedido
+  if (apos >= (long)historicoFim) {
+    LOG_INFO("Historico: nada depois do offset %ld.", apos);
+    encerrarHistorico();
+    return;
+  }
+  LOG_INFO("Enviando historico de movimentacoes via MQTT...");
+
+  historicoPos           = apos >= 0 ? (size_t)apos : 0;
+  historicoPularPrimeira = apos >= 0;
+  historicoFormato       = formatoResposta(CANAL_MOV);
+  historicoLinhas        = 0;
+  historicoInicioMs      = millis();
+  agendarFatiaHistorico();
+}
+
+// Lista movimentações na Serial
+// ======================= Listagem na Serial em fatias =======================
+// A 9600 baud uma linha leva ~70 ms para sair: cada volta do loop() só escreve
+// o que cabe no buffer de envio da Serial (availableForWrite), sem bloquear, e
+// no máximo LISTAGEM_FATIA_LINHAS linhas, com a trava do log só na fatia.
+
+static void continuarListagem(const ArgsComando &);
+
+static const Comando CONTINUAR_LISTAGEM = { "get_history", 0, {}, COMANDO_LONGO, continuarListagem, NULL };
+
+static File   listagem;
+static size_t listagemPos, listagemFim;
+
+static void encerrarListagem() {
+  if (listagem) listagem.close();
+  listagem = File();
+  Serial.println("== fim das movimentacoes ==");
+}
+
+// true se ainda falta listar
+static bool listarFatia() {
+  uint16_t linhas = 0;
+  bool fimDoLog = true;
+  {
+    TravaLeituraLog trava;   // completarMovimentacoesSemHora() reescreve linhas no lugar
+    listagem.seek(listagemPos);
+    LeitorLinhas leitor(listagem, bufLeituraLog, sizeof(bufLeituraLog));
+    Trecho linha;
+    for (;;) {
+      if (!leitor.proxima(linha) || leitor.offsetLinha() >= listagemFim) break;
+      Trecho t = trechoAparado(linha.p, corpoRegistro(linha.p, linha.len));
+      bool mostrar = t.len && t.p[0] != '#';
+      if (t.len > LISTAGEM_LINHA_MAX) t.len = LISTAGEM_LINHA_MAX;   // linha estragada: cabe no FIFO
+      if (mostrar && (linhas >= LISTAGEM_FATIA_LINHAS || (size_t)Serial.availableForWrite() < t.len + 2)) {
+        fimDoLog = false;   // esta linha fica para a próxima volta
+        break;
+      }
+      listagemPos = leitor.offsetLinha() + linha.len + 1;
+      if (!mostrar) continue;
+      Serial.write((const uint8_t*)t.p, t.len);
+      Serial.println();
+      linhas++;
+    }
+  }
+  return !fimDoLog && listagemPos < listagemFim;
+}
+
+static void agendarFatiaListagem() {
+  if (!listarFatia()) {
+    encerrarListagem();
+    return;
+  }
+  if (!continuarNoLoop(CONTINUAR_LISTAGEM)) {
+    Serial.println("Listagem interrompida: filaComandos cheia.");
+    encerrarListagem();
+  }
+}
+
+static void continuarListagem(const ArgsComando &) {
+  if (listagem) agendarFatiaListagem();
+}
+
+void listMovimentacoes() {
+  if (listagem) {
+    Serial.println("Listagem de movimentacoes ja em andamento.");
+    return;
+  }
+  listagem = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  if (!listagem) {
+    Serial.print("Nenhum arquivo de movimentacoes ainda (");
+    Serial.print(MOVIMENTACOES_FILE);
+    Serial.println(" nao existe).");
+    return;
+  }
+
+  Serial.println("== Movimentacoes registradas ==");
+  listagemPos = 0;
+  listagemFim = listagem.size();   // o que for gravado depois não entra
+  agendarFatiaListagem();
+}
+
+
+// =========== Movimentações antes do NTP ===========
+// Sem hora de parede a linha é gravada com "+sssssss" (segundos desde o boot)
+// no lugar da hora e DATA_SEM_HORA no lugar da data, com a mesma largura de
+// "HH:MM:SS" e "DD/MM/AAAA". Quando o NTP chega, completarMovimentacoesSemHora()
+// reescreve esses 29 bytes e a moldura (CRC novo) no próprio arquivo e só então indexa, marca
+// presença/atrasos e publica. Linhas sem hora de um boot anterior ficam como estão.
+#define DATA_SEM_HORA   "00/00/0000"   // dia 0: as consultas por data ignoram
+#define SUFIXO_HORA_TAM 29   // "HH:MM:SS- do dia -DD/MM/AAAA-"
+#define MOV_LINHA_MAX   96
+
+struct MovSemHora {
+  uint32_t offsetLinha;
+  uint16_t tam;         // do corpo, sem a moldura
+  uint32_t ms;          // millis() do registro
+};
+
+static MovSemHora movSemHora[MOV_SEM_HORA_MAX];
+static uint8_t    numMovSemHora = 0;
+
+// Índice, estado derivado (presença, atrasos, dentro) e estado retido de uma linha já com data/hora de parede
+static void aplicarMovimentacao(const String &uidFuncionario, const String &uidUsuario, bool entrada,
+                                const String &dataStr, const String &horaStr,
+                                size_t offsetLinha, size_t tamRegistro) {
+  indexarMovimentacao(dataStr, offsetLinha);
+  aplicarMovimentacaoEstado(uidFuncionario.c_str(), uidUsuario.c_str(), entrada,
+                            diaNumFromStr(dataStr), segundosFromHoraStr(horaStr),
+                            offsetLinha + tamRegistro + 1);
+  anotarMovimentacaoRetida(uidFuncionario.c_str(), uidUsuario.c_str(), entrada, dataStr, horaStr, offsetLinha);
+}
+
+void serializarMovimentacao(Serializador &s, size_t offsetLinha, Trecho func, Trecho user,
+                            const char *acao, Trecho data, Trecho hora) {
+  s.objeto().texto("portaria", PORTARIA_ID).natural("offset", offsetLinha);
+  s.texto("funcionario", func.p, func.len).texto("usuario", user.p, user.len).texto("acao", acao);
+  s.texto("data", data.p, data.len).texto("hora", hora.p, hora.len);
+  s.fechar();
+}
+
+static Trecho trechoDe(const String &t) {
+  Trecho r = { t.c_str(), t.length() };
+  return r;
+}
+
+// Ao vivo, no formato do canal: quem junta as portarias descarta o que
+// recebeu duas vezes (ao vivo e no get_history) por "portaria" + "offset"
+static void publicarMovimentacao(const String &uidFuncionario, const String &uidUsuario, const String &tipo,
+                                 const String &dataStr, const String &horaStr, size_t offsetLinha) {
+  if (mqttClient.connected()) {
+    char buf[192];
+    Serializador s(buf, sizeof(buf), formatoCanal(CANAL_MOV));
+    serializarMovimentacao(s, offsetLinha, trechoDe(uidFuncionario), trechoDe(uidUsuario), tipo.c_str(),
+                           trechoDe(dataStr), trechoDe(horaStr));
+
+    uint32_t t0 = micros();
+    bool ok = s.publicar(MQTT_TOPIC_MOV);
+    metricaRegistrar(MET_PUBLICAR_MOV, micros() - t0);
+    if (ok) {
+      if (s.formato() == FORMATO_JSON) LOG_DEBUG("MQTT: publicado em %s -> %s", MQTT_TOPIC_MOV, s.dados());
+    } else {
+      LOG_AVISO("MQTT: FALHA ao publicar movimentacao.");
+    }
+  } else {
+    LOG_INFO("MQTT: nao conectado, movimentacao nao enviada.");
+  }
+}
+
+size_t movimentacoesSemHora() {
+  return numMovSemHora;
+}
+
+size_t completarMovimentacoesSemHora() {
+  if (numMovSemHora == 0 || !relogioSincronizado()) return 0;
+
+  TravaLeituraLog trava;
+  File f = abrirArquivo(MOVIMENTACOES_FILE, "r+");
+  if (!f) {
+    LOG_ERRO("ERRO ao abrir MOVIMENTACOES_FILE para completar data/hora.");
+    return 0;
+  }
+
+  size_t corrigidas = 0;
+  char linha[MOV_LINHA_MAX + 1];
+  for (uint8_t i = 0; i < numMovSemHora; i++) {
+    const MovSemHora &m = movSemHora[i];
+    String dataStr, horaStr;
+    if (!dataHoraDeMillis(m.ms, dataStr, horaStr)) {
+      f.close();
+      return corrigidas;   // as já corrigidas são puladas na próxima (não terminam mais em DATA_SEM_HORA)
+    }
+
+    if (!f.seek(m.offsetLinha) || f.read((uint8_t*)linha, m.tam) != m.tam) continue;
+    linha[m.tam] = '\0';
+    static const char FIM_SEM_HORA[] = "-" DATA_SEM_HORA "-";
+    if (strcmp(linha + m.tam - (sizeof(FIM_SEM_HORA) - 1), FIM_SEM_HORA) != 0) continue;
+
+    // sufixo novo + moldura com o CRC do corpo novo, numa escrita só
+    char sufixo[SUFIXO_HORA_TAM + REGISTRO_MOLDURA_TAM + 1];
+    snprintf(sufixo, SUFIXO_HORA_TAM + 1, "%s- do dia -%s-", horaStr.c_str(), dataStr.c_str());
+    memcpy(linha + m.tam - SUFIXO_HORA_TAM, sufixo, SUFIXO_HORA_TAM);
+    montarMolduraRegistro(linha, m.tam, sufixo + SUFIXO_HORA_TAM);
+    const size_t tamEscrita = SUFIXO_HORA_TAM + REGISTRO_MOLDURA_TAM;
+    if (!f.seek(m.offsetLinha + m.tam - SUFIXO_HORA_TAM) ||
+        f.write((const uint8_t*)sufixo, tamEscrita) != tamEscrita) {
+      LOG_ERRO("ERRO ao completar data/hora de movimentacao.");
+      continue;
+    }
+
+    MovLinha mov;
+    if (!parseMovLine(linha, m.tam, mov)) continue;
+    String func = String(mov.func.p).substring(0, mov.func.len);
+    String user = String(mov.user.p).substring(0, mov.user.len);
+    LOG_INFO("Movimentacao antes do NTP completada: %s", linha);
+    aplicarMovimentacao(func, user, mov.recebeu, dataStr, horaStr, m.offsetLinha,
+                        m.tam + REGISTRO_MOLDURA_TAM);
+    publicarMovimentacao(func, user, mov.recebeu ? "entrada" : "saída", dataStr, horaStr, m.offsetLinha);
+    corrigidas++;
+  }
+  f.close();
+  numMovSemHora = 0;
+  return corrigidas;
+}
+
+// Registrar movimentação
+void registrarMovimentacao(const String &uidFuncionario,
+                           const String &uidUsuario,
+                           const String &tipoMov) {
+  String dataStr, horaStr;
+  uint32_t agoraMs = millis();
+  bool semHora = !obterDataHoraAtual(dataStr, horaStr);
+  if (semHora) {
+    char buf[12];
+    snprintf(buf, sizeof(buf), "+%07lu", (unsigned long)((agoraMs / 1000) % 10000000UL));
+    horaStr = buf;
+    dataStr = DATA_SEM_HORA;
+  } else {
+    completarMovimentacoesSemHora();   // as anteriores entram no índice antes desta
+  }
+
+  String linha;
+  String tipo = tipoMov;
+  tipo.toLowerCase();
+
+  if (tipo == "entrada") {
+    linha = "-" + uidFuncionario + "- recebeu -" + uidUsuario +
+            "- às -" + horaStr + "- do dia -" + dataStr + "-";
+  } else if (tipo == "saída" || tipo == "saida") {
+    linha = "-" + uidFuncionario + "- liberou -" + uidUsuario +
+            "- às -" + horaStr + "- do dia -" + dataStr + "-";
+  } else {
+    linha = "-" + uidFuncionario + "- liberou -" + uidUsuario +
+            "- às -" + horaStr + "- do dia -" + dataStr + "-";
+  }
+
+  size_t offsetLinha = 0;
+  uint32_t t0 = micros();
+  bool gravou;
+  if (semHora) {
+    // a trava também protege movSemHora contra completarMovimentacoesSemHora() no loop()
+    TravaLeituraLog trava;
+    gravou = appendRegistro(MOVIMENTACOES_FILE, linha, &offsetLinha);
+    if (gravou && numMovSemHora < MOV_SEM_HORA_MAX && linha.length() <= MOV_LINHA_MAX) {
+      movSemHora[numMovSemHora].offsetLinha = (uint32_t)offsetLinha;
+      movSemHora[numMovSemHora].tam         = (uint16_t)linha.length();
+      movSemHora[numMovSemHora].ms          = agoraMs;
+      numMovSemHora++;
+    } else if (gravou) {
+      LOG_AVISO("Aviso: movimentacao sem hora nao sera completada (lista cheia).");
+    }
+  } else {
+    gravou = appendRegistro(MOVIMENTACOES_FILE, linha, &offsetLinha);
+  }
+  metricaRegistrar(MET_APPEND_LOG, micros() - t0);
+  if (gravou) {
+    LOG_INFO("Movimentacao registrado: %s", linha.c_str());
+    if (!semHora) {
+      aplicarMovimentacao(uidFuncionario, uidUsuario, tipo == "entrada", dataStr, horaStr,
+                          offsetLinha, linha.length() + REGISTRO_MOLDURA_TAM);
+    }
+  } else {
+    LOG_ERRO("ERRO ao registrar movimentacao em MOVIMENTACOES_FILE.");
+  }
+
+  // sem hora ainda: publica quando completarMovimentacoesSemHora() tiver a data
+  if (!semHora) {
+    publicarMovimentacao(uidFuncionario, uidUsuario, tipo, dataStr, horaStr, offsetLinha);
+  }
+}
@@ -0,0 +1,73 @@
+// Log de movimentações: formato da linha, índice por data e registro.
+#pragma once
+
+#include "armazenamento.h"
+#include "serializador.h"
+
+struct MovLinha {
+  Trecho func;
+  Trecho user;
+  Trecho hora;
+  Trecho data;
+  bool   recebeu;    // true = entrada ("recebeu"), false = saída ("liberou")
+};
+
+// Lê linha "-FUNC- recebeu/liberou -USER- às -HH:MM:SS- do dia -DD/MM/AAAA-",
+// com ou sem a moldura " #LL:CCCCCCCC" no fim (ver appendRegistro())
+bool parseMovLine(const char *linha, size_t lenLinha, MovLinha &mov);
+
+// =========== Índice de datas do arquivo de movimentações ===========
+extern int32_t ultimaChaveIndexada;
+
+bool   reconstruirIndiceMovimentacoes();
+void   sincronizarIndiceMovimentacoes();
+void   indexarMovimentacao(const String &dataStr, size_t offsetLinha);
+size_t offsetMovimentacoesDesde(int32_t chave);   // SIZE_MAX = nada a ler
+File   abrirMovimentacoesDesde(int32_t chave);
+
+// =========== Recuperação do fim do log no boot ===========
+// Confere tamanho e CRC só dos registros a partir de 'desde' (o offset do
+// checkpoint; SIZE_MAX = sem checkpoint, confere os últimos
+// RECUPERACAO_JANELA bytes). Um registro cortado no fim ganha o '\n' que
+// faltou; um corrompido tem o primeiro byte trocado por '#' e deixa de ser
+// lido. Chamada antes de qualquer outra leitura do log.
+#define RECUPERACAO_JANELA        4096
+#define RECUPERACAO_MAX_MARCAR    16     // corrompidos no meio do trecho marcados por boot
+
+void     recuperarCaudaMovimentacoes(size_t desde);
+uint32_t registrosRecuperados();   // conferidos e mantidos no último boot
+uint32_t registrosDescartados();   // cortados/corrompidos no último boot
+
+// {"portaria","offset","funcionario","usuario","acao","data","hora"}: o objeto
+// de portaria/<id>/movimentacoes (também nas retidas de estado_retido.h).
+// "portaria" + "offset" (byte da linha no log) identificam o registro.
+void serializarMovimentacao(Serializador &s, size_t offsetLinha, Trecho func, Trecho user,
+                            const char *acao, Trecho data, Trecho hora);
+
+// Todo o histórico ou, com apos >= 0, só os registros depois do que começa em
+// 'apos' (o offset do último que quem pediu já tem). Sai em fatias de até
+// HISTORICO_FATIA_LINHAS linhas / HISTORICO_FATIA_MS por volta do loop(),
+// pela filaComandos; o pedido responde "queued" e a última fatia, "done".
+// Um envio por vez: outro pedido no meio responde "busy".
+#define HISTORICO_FATIA_LINHAS  16
+#define HISTORICO_FATIA_MS      20UL
+
+void publishMovHistoryToMQTT(long apos = -1);
+
+// Log inteiro na Serial, sem bloquear o loop(): cada volta escreve só o que
+// cabe no buffer de envio (no máximo LISTAGEM_FATIA_LINHAS linhas) e o resto
+// segue pela filaComandos. Linhas maiores que LISTAGEM_LINHA_MAX saem cortadas.
+#define LISTAGEM_FATIA_LINHAS  8
+#define LISTAGEM_LINHA_MAX     100   // + "\r\n" cabe no FIFO de 128 bytes da UART
+void listMovimentacoes();
+
+// tipoMov: "entrada" ou "saída". Sem NTP a linha é gravada com o tempo desde
+// o boot e completada depois (até MOV_SEM_HORA_MAX por boot).
+void registrarMovimentacao(const String &uidFuncionario,
+                           const String &uidUsuario,
+                           const String &tipoMov);
+
+// Chamada a cada volta do loop(): quando o relógio sincroniza, troca a hora
+// provisória das movimentações deste boot pela de parede. Devolve quantas.
+size_t completarMovimentacoesSemHora();
+size_t movimentacoesSemHora();   // ainda esperando o NTP
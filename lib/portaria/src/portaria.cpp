@@ -0,0 +1,99 @@
+#include "portaria.h"
+
+const char* CARDS_FILE         = "/usuarios.txt";
+const char* ADMINS_FILE        = "/funcionarios.txt";
+const char* MOVIMENTACOES_FILE = "/movimentacoes.txt";
+const char* MOVIMENTACOES_IDX  = "/movimentacoes.idx";   // indice data -> offset
+const char* CHECKPOINT_FILE    = "/estado.ckp";          // estado derivado do log + offset
+
+const char*    MQTT_BROKER        = "172.20.10.2";   // IP do PC com o broker
+const uint16_t MQTT_PORT          = 1883;
+// Identifica a portaria nos tópicos e em cada movimentação publicada. Vazio:
+// os 3 últimos bytes do MAC em hex (diferente em cada placa).
+const char*    PORTARIA_ID        = "";
+
+// Montados por montarTopicosMqtt() com o id: portaria/<id>/...
+const char*    MQTT_CLIENT_ID     = NULL;   // esp32-portaria-<id>
+const char*    MQTT_TOPIC_MOV     = NULL;   // eventos de entrada/saida
+const char*    MQTT_TOPIC_CMD     = NULL;   // comandos vindos do React só para esta portaria
+const char*    MQTT_TOPIC_STATUS  = NULL;   // msgs de status/resposta
+const char*    MQTT_TOPIC_INSIDE  = NULL;
+const char*    MQTT_TOPIC_METRICS = NULL;   // telemetria periodica (heap, pilhas, fila)
+const char*    MQTT_TOPIC_ESTADO  = NULL;   // base das mensagens retidas (estado_retido.h)
+const char*    MQTT_TOPIC_CMD_TODAS = "portaria/comandos";   // comandos para todas as portarias
+
+QueueHandle_t     filaCartoes       = NULL;
+SemaphoreHandle_t semAcessoLiberado = NULL;
+SemaphoreHandle_t mtxEstado         = NULL;
+
+TipoOperacao modoAtual = MODO_ENTRADA;
+
+bool   aguardandoSegundoEntrada   = false;
+String uidUsuarioEntradaPendente;
+
+bool   aguardandoSegundoSaida     = false;
+String uidFuncionarioSaidaPendente;
+
+bool leituraHabilitada = false;
+
+static void montarTopicosMqtt() {
+  static char id[24];
+  static char clientId[40];
+  static char topicos[6][64];
+  static const char *sufixos[6] = { "movimentacoes", "comandos", "status", "dentro", "metrics", "estado" };
+
+  if (!PORTARIA_ID || !PORTARIA_ID[0]) {
+    uint64_t mac = ESP.getEfuseMac();   // byte 0 = primeiro byte do MAC
+    snprintf(id, sizeof(id), "%02x%02x%02x", (unsigned)((mac >> 24) & 0xFF),
+             (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+    PORTARIA_ID = id;
+  }
+  snprintf(clientId, sizeof(clientId), "esp32-portaria-%s", PORTARIA_ID);
+  for (int i = 0; i < 6; i++) {
+    snprintf(topicos[i], sizeof(topicos[i]), "portaria/%s/%s", PORTARIA_ID, sufixos[i]);
+  }
+  MQTT_CLIENT_ID     = clientId;
+  MQTT_TOPIC_MOV     = topicos[0];
+  MQTT_TOPIC_CMD     = topicos[1];
+  MQTT_TOPIC_STATUS  = topicos[2];
+  MQTT_TOPIC_INSIDE  = topicos[3];
+  MQTT_TOPIC_METRICS = topicos[4];
+  MQTT_TOPIC_ESTADO  = topicos[5];
+}
+
+bool inicializarPortaria() {
+  montarTopicosMqtt();
+  LOG_INFO("Portaria %s: topicos em portaria/%s/", PORTARIA_ID, PORTARIA_ID);
+
+  bool okFs = montarArmazenamento();
+  if (!okFs) {
+    LOG_ERRO("ERRO: sistema de arquivos (%s) nao inicializado.", backendArquivos.nome);
+  } else {
+    LOG_INFO("%s OK. Arquivo de cadastros: /usuarios.txt", backendArquivos.nome);
+    mtxEstado     = xSemaphoreCreateMutex();
+    mtxLeituraLog = xSemaphoreCreateMutex();
+    recuperarCaudaMovimentacoes(offsetCheckpoint());   // antes de qualquer leitura do log
+    sincronizarIndiceMovimentacoes();
+    inicializarImagemCadastro();
+    carregarVersaoCadastro();    // termina uma troca do cadastro interrompida
+    carregarHorariosLimite();
+    reservarEstadoDerivado(uidsImagemCadastro());   // tabelas do tamanho do cadastro
+    restaurarEstadoDerivado();   // usa os limites ao montar os atrasos
+  }
+
+  mqttClient.setBufferSize(MQTT_BUFFER_TAM);
+
+  filaCartoes = xQueueCreate(FILA_CARTOES_TAM, sizeof(EventoCartao));
+  if (filaCartoes == NULL) {
+    LOG_ERRO("ERRO: nao foi possivel criar filaCartoes!");
+  }
+
+  semAcessoLiberado = xSemaphoreCreateBinary();
+  if (semAcessoLiberado == NULL) {
+    LOG_ERRO("ERRO: nao foi possivel criar semAcessoLiberado!");
+  }
+
+  inicializarComandos();
+
+  return okFs;
+}
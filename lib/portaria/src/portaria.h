@@ -0,0 +1,25 @@
+// Núcleo da portaria, sem WiFi/NTP nem setup()/loop(): compila no ESP32
+// (env:esp32dev) e no PC (env:native, com lib/fakes_nativo).
+#pragma once
+
+#include "config.h"
+#include "log_serial.h"
+#include "estado.h"
+#include "armazenamento.h"
+#include "datas.h"
+#include "movimentacoes.h"
+#include "cadastro.h"
+#include "imagem_cadastro.h"
+#include "sinc_cadastro.h"
+#include "relatorios.h"
+#include "checkpoint.h"
+#include "fluxo.h"
+#include "comandos.h"
+#include "metricas.h"
+#include "telemetria.h"
+#include "estado_retido.h"
+#include "exportacao_http.h"
+
+// Monta o sistema de arquivos, cria filas/semáforos e carrega o estado derivado
+// do log (índice, presença, horários limite). false se o FS não montou.
+bool inicializarPortaria();
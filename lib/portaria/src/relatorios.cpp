@@ -0,0 +1,793 @@
+#include "relatorios.h"
+
+#include "armazenamento.h"
+#include "cadastro.h"
+#include "comandos.h"
+#include "datas.h"
+#include "estado.h"
+#include "log_serial.h"
+#include "movimentacoes.h"
+#include "serializador.h"
+
+// =========== Usuários que entraram e não saíram hoje (recebeu/liberou) ===========
+// Contagem por UID do dia 'diaDentro', mantida a cada movimentação: +1 no
+// "recebeu", -1 no "liberou". A consulta só copia a tabela.
+static ContagemDentro *dentroHoje = NULL;   // ehUsuario só é preenchido na consulta
+static size_t          capDentro  = 0;
+static int             numDentro  = 0;
+static int32_t         diaDentro  = -1;
+
+static uint32_t uidsFora = 0;   // UIDs que não couberam (sem memória para crescer)
+
+static void semMemoriaTabela(const char *tabela, const char *uid) {
+  uidsFora++;
+  LOG_ERRO("ERRO: sem memoria para crescer a tabela de %s; UID %s fora (%lu no total).", tabela, uid,
+           (unsigned long)uidsFora);
+}
+
+static void contarDentro(const char *uidUser, bool entrada, int32_t diaNum) {
+  if (!uidUser[0] || diaNum < 0) return;
+  if (diaNum != diaDentro) {
+    if (diaNum < diaDentro) return;
+    numDentro = 0;
+    diaDentro = diaNum;
+  }
+
+  int idx = -1;
+  for (int i = 0; i < numDentro; i++) {
+    if (strcmp(dentroHoje[i].uid, uidUser) == 0) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx == -1) {
+    if (!garantirCapacidade(dentroHoje, capDentro, (size_t)numDentro + 1)) {
+      semMemoriaTabela("dentro", uidUser);
+      return;
+    }
+    ContagemDentro &novo = dentroHoje[numDentro];
+    strncpy(novo.uid, uidUser, UID_MAX_LEN);
+    novo.uid[UID_MAX_LEN] = '\0';
+    novo.count     = 0;
+    novo.ehUsuario = false;
+    idx = numDentro++;
+  }
+
+  if (entrada) {
+    dentroHoje[idx].count++;
+  } else if (dentroHoje[idx].count > 0) {
+    dentroHoje[idx].count--;
+  }
+}
+
+int contagemDentro(const char *uid, int32_t diaNum) {
+  int count = 0;
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  if (diaNum == diaDentro) {
+    for (int i = 0; i < numDentro; i++) {
+      if (strcmp(dentroHoje[i].uid, uid) == 0) {
+        count = dentroHoje[i].count;
+        break;
+      }
+    }
+  }
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+  return count;
+}
+
+// Retorna false se não há data/hora; senão preenche 'itens' (só quem está
+// dentro) e devolve o total em aberto.
+bool coletarUsuariosDentroHoje(ContagemDentro *&itens, int &numItens, size_t &totalPendencias) {
+  itens           = NULL;
+  numItens        = 0;
+  totalPendencias = 0;
+
+  String dataHoje, horaAgora;
+  if (!obterDataHoraAtual(dataHoje, horaAgora)) {
+    return false;
+  }
+  int32_t hoje = diaNumFromStr(dataHoje);
+
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  if (diaDentro == hoje && numDentro > 0) {
+    itens = (ContagemDentro *)malloc(numDentro * sizeof(ContagemDentro));
+    if (!itens) LOG_ERRO("ERRO: sem memoria para a lista de dentro (%d UID(s)).", numDentro);
+    for (int i = 0; itens && i < numDentro; i++) {
+      if (dentroHoje[i].count > 0) itens[numItens++] = dentroHoje[i];
+    }
+  }
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+
+  // consultado em CARDS_FILE uma vez por UID, fora da trava
+  for (int i = 0; i < numItens; i++) {
+    itens[i].ehUsuario = isRegistered(CARDS_FILE, String(itens[i].uid));
+    if (itens[i].ehUsuario) totalPendencias += itens[i].count;
+  }
+  return true;
+}
+
+size_t listarUsuariosDentroHoje() {
+  ContagemDentro *itens;
+  int numItens;
+  size_t totalPendencias;
+
+  coletarUsuariosDentroHoje(itens, numItens, totalPendencias);
+
+  Serial.println(totalPendencias);
+  for (int i = 0; i < numItens; i++) {
+    if (!itens[i].ehUsuario) continue;
+    for (int k = 0; k < itens[i].count; k++) {
+      Serial.println(itens[i].uid);
+    }
+  }
+  free(itens);
+  return totalPendencias;
+}
+
+void publishUsuariosDentroHojeToMQTT() {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao envia lista de dentro.");
+    return;
+  }
+
+  ContagemDentro *itens;
+  int numItens;
+  size_t totalPendencias;
+
+  if (!coletarUsuariosDentroHoje(itens, numItens, totalPendencias)) {
+    LOG_INFO("MQTT: sem data/hora, envia lista vazia.");
+  }
+
+  static char buf[MQTT_BUFFER_TAM];   // só o loop() publica isto
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_DENTRO));
+  s.objeto().texto("context", "inside").natural("total", totalPendencias);
+  s.lista("itens");
+  for (int i = 0; i < numItens; i++) {
+    if (!itens[i].ehUsuario || itens[i].count <= 0) continue;
+    s.objeto().texto("uid", itens[i].uid).inteiro("count", itens[i].count).fechar();
+  }
+  s.fechar().idRequisicao().fechar();
+  free(itens);
+
+  if (s.formato() == FORMATO_JSON) LOG_DEBUG("MQTT inside -> %s", s.dados());
+  s.publicar(MQTT_TOPIC_INSIDE);
+}
+
+// =========== Presença semanal por UID (bitmap mantido a cada registro) ===========
+// Para cada UID guarda um byte por semana: bit w = dia da semana w (0=Dom..6=Sab).
+// semanas[0] é a semana que começa em presenca.segundaAtual, semanas[1] a anterior etc.
+// A tabela é um hash com endereçamento aberto em RAM, com capacidade em
+// potência de 2 e no máximo 3/4 ocupada (dobra antes disso); vai para o
+// disco no checkpoint do estado derivado (checkpoint.cpp).
+
+#define PRESENCA_CAP_INICIAL 64     // potência de 2
+#define MASCARA_SEG_SEX      0x3E
+
+struct PresencaUid {
+  char    uid[UID_MAX_LEN + 1];          // "" = slot livre
+  uint8_t semanas[PRESENCA_SEMANAS];
+};
+
+int32_t      presencaSegundaAtual = -1;    // dia (desde epoch) da segunda-feira da semanas[0]
+PresencaUid *presencaSlots = NULL;
+size_t       presencaCap   = 0;            // 0 ou potência de 2
+size_t       presencaUsados = 0;
+
+int32_t segundaDoDia(int32_t diaNum) {
+  return diaNum - (diaSemanaFromDiaNum(diaNum) + 6) % 7;
+}
+
+static uint32_t hashUid(const char *uid) {
+  uint32_t h = 2166136261UL;               // FNV-1a
+  while (*uid) {
+    h ^= (uint8_t)*uid++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+// Índice do slot do UID numa tabela de 'cap' slots; se não existir e
+// 'criar', ocupa um slot livre. -1 se não achou/cheia.
+static int slotPresencaEm(PresencaUid *slots, size_t cap, const char *uid, bool criar) {
+  if (!cap) return -1;
+  uint32_t i = hashUid(uid) & (cap - 1);
+  for (size_t n = 0; n < cap; n++, i = (i + 1) & (cap - 1)) {
+    PresencaUid &s = slots[i];
+    if (s.uid[0] == '\0') {
+      if (!criar) return -1;
+      strncpy(s.uid, uid, UID_MAX_LEN);
+      s.uid[UID_MAX_LEN] = '\0';
+      memset(s.semanas, 0, sizeof(s.semanas));
+      return (int)i;
+    }
+    if (strncmp(s.uid, uid, UID_MAX_LEN) == 0) return (int)i;
+  }
+  return -1;
+}
+
+// Troca a tabela por uma de 'novaCap' slots (potência de 2), reinserindo os
+// UIDs; com desloc > 0 as semanas andam e quem ficou sem presença sai.
+// false sem memória (a tabela fica como estava).
+static bool remontarPresenca(size_t novaCap, int32_t desloc) {
+  PresencaUid *novos = (PresencaUid *)calloc(novaCap, sizeof(PresencaUid));
+  if (!novos) return false;
+  size_t usados = 0;
+  for (size_t i = 0; i < presencaCap; i++) {
+    const PresencaUid &antigo = presencaSlots[i];
+    if (antigo.uid[0] == '\0') continue;
+
+    uint8_t semanas[PRESENCA_SEMANAS] = { 0 };
+    bool algum = false;
+    for (int w = 0; w + desloc < PRESENCA_SEMANAS; w++) {
+      semanas[w + desloc] = antigo.semanas[w];
+      algum |= (semanas[w + desloc] != 0);
+    }
+    if (!algum) continue;
+
+    int idx = slotPresencaEm(novos, novaCap, antigo.uid, true);
+    memcpy(novos[idx].semanas, semanas, sizeof(semanas));
+    usados++;
+  }
+  free(presencaSlots);
+  presencaSlots  = novos;
+  presencaCap    = novaCap;
+  presencaUsados = usados;
+  return true;
+}
+
+static int slotPresenca(const char *uid, bool criar) {
+  int idx = slotPresencaEm(presencaSlots, presencaCap, uid, false);
+  if (idx >= 0 || !criar) return idx;
+  if ((presencaUsados + 1) * 4 > presencaCap * 3 &&
+      !remontarPresenca(presencaCap ? presencaCap * 2 : PRESENCA_CAP_INICIAL, 0)) {
+    if (presencaUsados >= presencaCap) return -1;   // sem memória e sem slot livre
+  }
+  idx = slotPresencaEm(presencaSlots, presencaCap, uid, true);
+  if (idx >= 0) presencaUsados++;
+  return idx;
+}
+
+// Avança a tabela para a semana de 'novaSegunda': desloca as semanas e
+// reinsere só os UIDs que ainda têm alguma presença na janela.
+static void rolarSemanasPresenca(int32_t novaSegunda) {
+  int32_t desloc = (presencaSegundaAtual < 0) ? PRESENCA_SEMANAS
+                                                  : (novaSegunda - presencaSegundaAtual) / 7;
+  presencaSegundaAtual = novaSegunda;
+  if (desloc <= 0 || !presencaCap) return;
+  if (remontarPresenca(presencaCap, desloc)) return;
+
+  // sem memória para a cópia: desloca no lugar; quem zerou fica ocupando o slot
+  LOG_AVISO("Aviso: sem memoria para remontar a tabela de presenca; semanas deslocadas no lugar.");
+  for (size_t i = 0; i < presencaCap; i++) {
+    PresencaUid &p = presencaSlots[i];
+    if (p.uid[0] == '\0') continue;
+    for (int w = PRESENCA_SEMANAS - 1; w >= 0; w--) p.semanas[w] = w >= desloc ? p.semanas[w - desloc] : 0;
+  }
+}
+
+static void marcarPresenca(const char *uid, int32_t diaNum) {
+  if (!uid[0] || diaNum < 0) return;
+
+  int32_t segunda = segundaDoDia(diaNum);
+  if (segunda > presencaSegundaAtual) {
+    rolarSemanasPresenca(segunda);
+  }
+
+  int32_t semana = (presencaSegundaAtual - segunda) / 7;
+  if (semana >= PRESENCA_SEMANAS) return;
+
+  int idx = slotPresenca(uid, true);
+  if (idx < 0) {
+    semMemoriaTabela("presenca", uid);
+    return;
+  }
+  presencaSlots[idx].semanas[semana] |= 1 << diaSemanaFromDiaNum(diaNum);
+}
+
+// =========== Atrasos: primeira entrada do dia por criança ===========
+// A tabela é preenchida no primeiro "recebeu" de cada usuário no dia (a cada
+// movimentação, ou na reaplicação do log no boot) e zerada quando o dia muda. Consultar atrasos só lê
+// a tabela. Horários em segundos desde a meia-noite.
+//
+// HORARIOS_FILE (opcional) define os limites, uma regra por linha:
+//   padrao 08:15        -> limite para todos
+//   <uid>  08:30:00     -> limite específico de uma criança (ex.: turma da tarde)
+const char* HORARIOS_FILE = "/horarios.txt";
+
+#define LIMITES_MAX_UIDS      64
+#define LIMITE_PADRAO_SEG     (8 * 3600 + 15 * 60)   // 08:15:00
+
+struct LimiteUid {
+  char     uid[UID_MAX_LEN + 1];
+  uint32_t limite;
+};
+
+PrimeiraEntrada *primeirasEntradas    = NULL;
+size_t           capPrimeirasEntradas = 0;
+int              numPrimeirasEntradas = 0;
+int32_t          diaPrimeirasEntradas = -1;
+
+uint32_t  limitePadraoSeg = LIMITE_PADRAO_SEG;
+LimiteUid limitesUid[LIMITES_MAX_UIDS];
+int       numLimitesUid = 0;
+
+// "HH:MM" ou "HH:MM:SS" -> segundos desde a meia-noite. -1 se inválida.
+int32_t segundosFromHoraStr(const char *p, size_t len) {
+  if (len < 5 || p[2] != ':') return -1;
+  if (len >= 8 && p[5] != ':') return -1;
+
+  int d[6] = { 0 };
+  static const uint8_t pos[6] = { 0, 1, 3, 4, 6, 7 };
+  int nDig = (len >= 8) ? 6 : 4;
+  for (int i = 0; i < nDig; i++) {
+    char c = p[pos[i]];
+    if (c < '0' || c > '9') return -1;
+    d[i] = c - '0';
+  }
+
+  int h = d[0] * 10 + d[1];
+  int m = d[2] * 10 + d[3];
+  int sec = d[4] * 10 + d[5];
+  if (h > 23 || m > 59 || sec > 59) return -1;
+  return h * 3600 + m * 60 + sec;
+}
+
+int32_t segundosFromHoraStr(const String &horaStr) {
+  return segundosFromHoraStr(horaStr.c_str(), horaStr.length());
+}
+
+String horaStrFromSegundos(uint32_t seg) {
+  if (seg > 86399) seg = 86399;   // horas do dia: "HH:MM:SS" sempre cabe
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%02u:%02u:%02u",
+           (unsigned)(seg / 3600), (unsigned)((seg / 60) % 60), (unsigned)(seg % 60));
+  return String(buf);
+}
+
+uint32_t limiteParaUid(const char *uid) {
+  for (int i = 0; i < numLimitesUid; i++) {
+    if (strcmp(limitesUid[i].uid, uid) == 0) return limitesUid[i].limite;
+  }
+  return limitePadraoSeg;
+}
+
+void carregarHorariosLimite() {
+  limitePadraoSeg = LIMITE_PADRAO_SEG;
+  numLimitesUid   = 0;
+
+  File f = abrirArquivo(HORARIOS_FILE, FILE_READ);
+  if (!f) return;
+
+  while (f.available()) {
+    String line = f.readStringUntil('\n');
+    line.trim();
+    int sp = line.indexOf(' ');
+    if (!line.length() || line[0] == '#' || sp <= 0) continue;
+
+    String chave = line.substring(0, sp);
+    String hora  = line.substring(sp + 1);
+    chave.toLowerCase();
+    hora.trim();
+
+    int32_t seg = segundosFromHoraStr(hora);
+    if (seg < 0) {
+      LOG_AVISO("Aviso: horario invalido em HORARIOS_FILE: %s", line.c_str());
+      continue;
+    }
+
+    if (chave == "padrao") {
+      limitePadraoSeg = (uint32_t)seg;
+    } else if (numLimitesUid < LIMITES_MAX_UIDS && chave.length() <= UID_MAX_LEN) {
+      strcpy(limitesUid[numLimitesUid].uid, chave.c_str());
+      limitesUid[numLimitesUid].limite = (uint32_t)seg;
+      numLimitesUid++;
+    } else {
+      LOG_ERRO("ERRO: limite por UID ignorado (mais de %d ou UID invalido): %s", LIMITES_MAX_UIDS, line.c_str());
+    }
+  }
+  f.close();
+
+  LOG_INFO("Limite de atraso padrao: %s (%d excecao(oes) por UID)",
+           horaStrFromSegundos(limitePadraoSeg).c_str(), numLimitesUid);
+}
+
+// Grava um limite (uid vazio = padrão) em HORARIOS_FILE e recarrega
+bool definirHorarioLimite(const String &uidRaw, uint32_t segundos) {
+  String uid = uidRaw;
+  uid.trim();
+  uid.toLowerCase();
+  if (uid.length() > UID_MAX_LEN) return false;
+
+  String chave = uid.length() ? uid : String("padrao");
+  String novo  = "";
+  File f = abrirArquivo(HORARIOS_FILE, FILE_READ);
+  if (f) {
+    while (f.available()) {
+      String line = f.readStringUntil('\n');
+      line.trim();
+      if (!line.length()) continue;
+      String cmp = line;
+      cmp.toLowerCase();
+      if (cmp.startsWith(chave + " ")) continue;
+      novo += line + "\n";
+    }
+    f.close();
+  }
+  novo += chave + " " + horaStrFromSegundos(segundos) + "\n";
+
+  String tmp = String(HORARIOS_FILE) + ".tmp";
+  File w = abrirArquivo(tmp.c_str(), FILE_WRITE);
+  if (!w) return false;
+  bool ok = w.print(novo) == novo.length();
+  w.close();
+  if (!ok || !substituirArquivo(tmp.c_str(), HORARIOS_FILE)) {
+    removerArquivo(tmp.c_str());
+    return false;
+  }
+
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  carregarHorariosLimite();
+  for (int i = 0; i < numPrimeirasEntradas; i++) {
+    primeirasEntradas[i].limite = limiteParaUid(primeirasEntradas[i].uid);
+  }
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+  return true;
+}
+
+static void marcarPrimeiraEntrada(const char *uid, uint32_t segundos) {
+  for (int i = 0; i < numPrimeirasEntradas; i++) {
+    if (strcmp(primeirasEntradas[i].uid, uid) == 0) return;
+  }
+  if (!garantirCapacidade(primeirasEntradas, capPrimeirasEntradas, (size_t)numPrimeirasEntradas + 1)) {
+    semMemoriaTabela("atrasos", uid);
+    return;
+  }
+
+  PrimeiraEntrada &e = primeirasEntradas[numPrimeirasEntradas++];
+  strncpy(e.uid, uid, UID_MAX_LEN);
+  e.uid[UID_MAX_LEN] = '\0';
+  e.segundos = segundos;
+  e.limite   = limiteParaUid(e.uid);
+}
+
+// Garante que a tabela é a do dia 'diaNum'; se o dia virou, zera
+static void garantirDiaPrimeirasEntradas(int32_t diaNum) {
+  if (diaNum == diaPrimeirasEntradas) return;
+  numPrimeirasEntradas = 0;
+  diaPrimeirasEntradas = diaNum;
+}
+
+// Copia os atrasados de hoje (primeira entrada depois do limite) ainda
+// cadastrados. Retorna o total.
+size_t coletarAtrasosHoje(PrimeiraEntrada *&saida, String &dataHoje) {
+  saida = NULL;
+  String horaAgora;
+  if (!obterDataHoraAtual(dataHoje, horaAgora)) return 0;
+
+  size_t total = 0;
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  garantirDiaPrimeirasEntradas(diaNumFromStr(dataHoje));
+  if (numPrimeirasEntradas > 0) {
+    saida = (PrimeiraEntrada *)malloc(numPrimeirasEntradas * sizeof(PrimeiraEntrada));
+    if (!saida) LOG_ERRO("ERRO: sem memoria para a lista de atrasos (%d UID(s)).", numPrimeirasEntradas);
+  }
+  for (int i = 0; saida && i < numPrimeirasEntradas; i++) {
+    if (primeirasEntradas[i].segundos > primeirasEntradas[i].limite) {
+      saida[total++] = primeirasEntradas[i];
+    }
+  }
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+
+  // só usuários ainda cadastrados (um removido hoje some do relatório),
+  // consultado fora da trava como na lista de dentro
+  size_t cadastrados = 0;
+  for (size_t i = 0; i < total; i++) {
+    if (isRegistered(CARDS_FILE, String(saida[i].uid))) saida[cadastrados++] = saida[i];
+  }
+  return cadastrados;
+}
+
+// Atrasados hoje (primeira ENTRADA do dia depois do limite) na Serial
+size_t listarAtrasosHoje() {
+  PrimeiraEntrada *atrasados;
+  String dataHoje;
+  size_t totalAtrasados = coletarAtrasosHoje(atrasados, dataHoje);
+
+  Serial.println(totalAtrasados);
+  for (size_t i = 0; i < totalAtrasados; i++) {
+    Serial.println(atrasados[i].uid);
+  }
+  free(atrasados);
+  return totalAtrasados;
+}
+
+void publishAtrasosHojeToMQTT() {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao envia atrasos.");
+    return;
+  }
+
+  PrimeiraEntrada *atrasados;
+  String dataHoje;
+  size_t total = coletarAtrasosHoje(atrasados, dataHoje);
+
+  static char buf[MQTT_BUFFER_TAM];   // só o loop() publica isto
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+  s.objeto().texto("context", "late").texto("data", dataHoje.c_str()).natural("total", total);
+  s.lista("itens");
+  for (size_t i = 0; i < total; i++) {
+    s.objeto().texto("uid", atrasados[i].uid);
+    s.texto("hora", horaStrFromSegundos(atrasados[i].segundos).c_str());
+    s.texto("limite", horaStrFromSegundos(atrasados[i].limite).c_str());
+    s.fechar();
+  }
+  s.fechar().idRequisicao().fechar();
+  free(atrasados);
+
+  if (s.formato() == FORMATO_JSON) LOG_DEBUG("MQTT late -> %s", s.dados());
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+// =========== CORE: em quais dias (SEG–SEX) o UID apareceu na semana atual ===========
+// 'semanasAtras' = 0 para a semana atual, 1 para a anterior, ... (até PRESENCA_SEMANAS-1).
+size_t computeDiasSemanaPorUid(const String &uidRaw, bool diasSemana[7], String &uidNormalizado,
+                               int semanasAtras) {
+  uidNormalizado = uidRaw;
+  uidNormalizado.trim();
+  uidNormalizado.toLowerCase();
+
+  for (int i = 0; i < 7; i++) {
+    diasSemana[i] = false;
+  }
+
+  if (!uidNormalizado.length() || semanasAtras < 0 || semanasAtras >= PRESENCA_SEMANAS) {
+    return 0;
+  }
+
+  int32_t segunda, sexta;
+  if (!semanaAtualDiaNum(segunda, sexta)) {
+    return 0;
+  }
+
+  uint8_t mascara = 0;
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  if (segunda > presencaSegundaAtual) {
+    // virou a semana e ainda ninguém passou: desloca antes de responder
+    rolarSemanasPresenca(segunda);
+  }
+  int32_t semana = (presencaSegundaAtual - segunda) / 7 + semanasAtras;
+  int idx = slotPresenca(uidNormalizado.c_str(), false);
+  if (idx >= 0 && semana < PRESENCA_SEMANAS) {
+    mascara = presencaSlots[idx].semanas[semana] & MASCARA_SEG_SEX;
+  }
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+
+  size_t totalDias = 0;
+  for (int w = 0; w < 7; w++) {
+    if (mascara & (1 << w)) {
+      diasSemana[w] = true;
+      totalDias++;
+    }
+  }
+  return totalDias;
+}
+
+// =========== SERIAL: mostra os dias na Serial ("h <uid> [semanasAtras]") ===========
+void consultarDiasSemanaPorUidSerial(const String &uidBusca, int semanasAtras) {
+  bool diasSemana[7];
+  String uidNorm;
+  size_t totalDias = computeDiasSemanaPorUid(uidBusca, diasSemana, uidNorm, semanasAtras);
+
+  if (!uidNorm.length()) {
+    Serial.println("UID vazio. Consulta cancelada.");
+    return;
+  }
+
+  if (totalDias == 0) {
+    Serial.print("UID ");
+    Serial.print(uidNorm);
+    Serial.println(" nao possui movimentacoes registradas nesta semana (SEG–SEX).");
+    return;
+  }
+
+  static const char* nomesDias[7] = {
+    "Domingo",
+    "Segunda-feira",
+    "Terca-feira",
+    "Quarta-feira",
+    "Quinta-feira",
+    "Sexta-feira",
+    "Sabado"
+  };
+
+  Serial.print("UID ");
+  Serial.print(uidNorm);
+  Serial.println(" apareceu nesta semana (SEG–SEX) nos seguintes dias da semana:");
+
+  for (int i = 0; i < 7; i++) {
+    if (diasSemana[i]) {
+      Serial.println(nomesDias[i]);
+    }
+  }
+}
+
+// =========== MQTT: publica JSON com os dias em que o UID apareceu na semana ===========
+void publishDiasSemanaPorUidToMQTT(const String &uidRaw, int semanasAtras) {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao envia uid_week_days.");
+    return;
+  }
+
+  bool diasSemana[7];
+  String uidNorm;
+  size_t totalDias = computeDiasSemanaPorUid(uidRaw, diasSemana, uidNorm, semanasAtras);
+
+  static const char* nomesDias[7] = {
+    "Domingo",
+    "Segunda-feira",
+    "Terca-feira",
+    "Quarta-feira",
+    "Quinta-feira",
+    "Sexta-feira",
+    "Sabado"
+  };
+
+  char buf[384];
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+  s.objeto().texto("context", "uid_week_days").texto("uid", uidNorm.c_str());
+  s.inteiro("semanasAtras", semanasAtras).natural("totalDias", totalDias);
+  s.lista("dias");
+  for (int i = 0; i < 7 && totalDias > 0; i++) {
+    if (diasSemana[i]) s.texto(NULL, nomesDias[i]);
+  }
+  s.fechar().idRequisicao().fechar();
+
+  if (s.formato() == FORMATO_JSON) LOG_DEBUG("MQTT uid_week_days -> %s", s.dados());
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+
+// =========== Estado derivado do log ===========
+// Presença semanal, primeira entrada do dia e quem está dentro hoje ficam só
+// em RAM. offsetEstado é até onde o log já foi aplicado; checkpoint.cpp grava
+// tudo junto e, no boot, reaplica só o que veio depois.
+static size_t   offsetEstado    = 0;
+static uint32_t registrosEstado = 0;
+
+void aplicarMovimentacaoEstado(const char *uidFunc, const char *uidUser, bool entrada,
+                               int32_t diaNum, int32_t segundos, size_t fimLinha) {
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  if (diaNum >= 0) {
+    marcarPresenca(uidFunc, diaNum);
+    marcarPresenca(uidUser, diaNum);
+    if (entrada && segundos >= 0 && diaNum >= diaPrimeirasEntradas) {
+      garantirDiaPrimeirasEntradas(diaNum);
+      marcarPrimeiraEntrada(uidUser, (uint32_t)segundos);
+    }
+    contarDentro(uidUser, entrada, diaNum);
+  }
+  if (fimLinha > offsetEstado) offsetEstado = fimLinha;
+  registrosEstado++;
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+}
+
+void avancarOffsetEstado(size_t offset) {
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  if (offset > offsetEstado) offsetEstado = offset;
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+}
+
+size_t   offsetEstadoDerivado()    { return offsetEstado; }
+uint32_t registrosEstadoDerivado() { return registrosEstado; }
+
+void zerarEstadoDerivado() {
+  if (presencaSlots) memset(presencaSlots, 0, presencaCap * sizeof(PresencaUid));
+  presencaUsados       = 0;
+  presencaSegundaAtual = -1;
+  numPrimeirasEntradas = 0;
+  diaPrimeirasEntradas = -1;
+  numDentro            = 0;
+  diaDentro            = -1;
+  offsetEstado         = 0;
+}
+
+void reservarEstadoDerivado(size_t uids) {
+  if (!uids) return;
+  if (mtxEstado) xSemaphoreTake(mtxEstado, portMAX_DELAY);
+  size_t cap = PRESENCA_CAP_INICIAL;
+  while (cap * 3 < uids * 4) cap *= 2;   // UIDs do cadastro até 3/4 da tabela
+  bool ok = (cap <= presencaCap || remontarPresenca(cap, 0)) &&
+            garantirCapacidade(primeirasEntradas, capPrimeirasEntradas, uids);
+  if (mtxEstado) xSemaphoreGive(mtxEstado);
+  if (!ok) LOG_ERRO("ERRO: sem memoria para reservar o estado derivado de %u UID(s).", (unsigned)uids);
+}
+
+uint32_t uidsForaEstadoDerivado() { return uidsFora; }
+
+// Formato: offset, presença (só slots ocupados), primeiras entradas e
+// contagens de dentro, cada tabela com o dia de referência e o número de itens.
+// Chamado com mtxEstado na mão.
+bool gravarEstadoDerivado(File &f, uint32_t &crc) {
+  uint32_t offset = (uint32_t)offsetEstado;
+  bool ok = gravarComCrc(f, &offset, sizeof(offset), crc);
+
+  uint16_t n = 0;
+  for (size_t i = 0; i < presencaCap; i++) {
+    if (presencaSlots[i].uid[0]) n++;
+  }
+  ok = ok && gravarComCrc(f, &presencaSegundaAtual, sizeof(presencaSegundaAtual), crc) &&
+       gravarComCrc(f, &n, sizeof(n), crc);
+  for (size_t i = 0; ok && i < presencaCap; i++) {
+    if (presencaSlots[i].uid[0]) ok = gravarComCrc(f, &presencaSlots[i], sizeof(PresencaUid), crc);
+  }
+
+  n = (uint16_t)numPrimeirasEntradas;
+  ok = ok && gravarComCrc(f, &diaPrimeirasEntradas, sizeof(diaPrimeirasEntradas), crc) &&
+       gravarComCrc(f, &n, sizeof(n), crc);
+  for (int i = 0; ok && i < numPrimeirasEntradas; i++) {
+    ok = gravarComCrc(f, primeirasEntradas[i].uid, sizeof(primeirasEntradas[i].uid), crc) &&
+         gravarComCrc(f, &primeirasEntradas[i].segundos, sizeof(uint32_t), crc);
+  }
+
+  n = 0;
+  for (int i = 0; i < numDentro; i++) {
+    if (dentroHoje[i].count > 0) n++;
+  }
+  ok = ok && gravarComCrc(f, &diaDentro, sizeof(diaDentro), crc) &&
+       gravarComCrc(f, &n, sizeof(n), crc);
+  for (int i = 0; ok && i < numDentro; i++) {
+    if (dentroHoje[i].count <= 0) continue;
+    int32_t count = dentroHoje[i].count;
+    ok = gravarComCrc(f, dentroHoje[i].uid, sizeof(dentroHoje[i].uid), crc) &&
+         gravarComCrc(f, &count, sizeof(count), crc);
+  }
+  return ok;
+}
+
+// Em caso de erro o estado fica pela metade: quem chama zera e reconstrói
+bool lerEstadoDerivado(File &f, uint32_t &crc) {
+  zerarEstadoDerivado();
+
+  uint32_t offset;
+  uint16_t n;
+  if (!lerComCrc(f, &offset, sizeof(offset), crc)) return false;
+  offsetEstado = offset;
+
+  if (!lerComCrc(f, &presencaSegundaAtual, sizeof(presencaSegundaAtual), crc) ||
+      !lerComCrc(f, &n, sizeof(n), crc)) return false;
+  for (uint16_t i = 0; i < n; i++) {
+    PresencaUid p;
+    if (!lerComCrc(f, &p, sizeof(p), crc)) return false;
+    p.uid[UID_MAX_LEN] = '\0';
+    int idx = slotPresenca(p.uid, true);
+    if (idx < 0) return false;   // sem memória: quem chama reconstrói pelo log
+    memcpy(presencaSlots[idx].semanas, p.semanas, sizeof(p.semanas));
+  }
+
+  if (!lerComCrc(f, &diaPrimeirasEntradas, sizeof(diaPrimeirasEntradas), crc) ||
+      !lerComCrc(f, &n, sizeof(n), crc) ||
+      !garantirCapacidade(primeirasEntradas, capPrimeirasEntradas, n)) return false;
+  for (uint16_t i = 0; i < n; i++) {
+    PrimeiraEntrada &e = primeirasEntradas[i];
+    if (!lerComCrc(f, e.uid, sizeof(e.uid), crc) ||
+        !lerComCrc(f, &e.segundos, sizeof(e.segundos), crc)) return false;
+    e.uid[UID_MAX_LEN] = '\0';
+    e.limite = limiteParaUid(e.uid);
+    numPrimeirasEntradas++;
+  }
+
+  if (!lerComCrc(f, &diaDentro, sizeof(diaDentro), crc) ||
+      !lerComCrc(f, &n, sizeof(n), crc) ||
+      !garantirCapacidade(dentroHoje, capDentro, n)) return false;
+  for (uint16_t i = 0; i < n; i++) {
+    ContagemDentro &c = dentroHoje[i];
+    int32_t count;
+    if (!lerComCrc(f, c.uid, sizeof(c.uid), crc) ||
+        !lerComCrc(f, &count, sizeof(count), crc)) return false;
+    c.uid[UID_MAX_LEN] = '\0';
+    c.count     = count;
+    c.ehUsuario = false;
+    numDentro++;
+  }
+  return true;
+}
@@ -0,0 +1,82 @@
+// Consultas sobre o log: quem está dentro hoje, presença semanal e atrasos.
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include "config.h"
+
+// As tabelas por UID abaixo crescem dobrando conforme aparecem UIDs (o boot
+// já as reserva pelo tamanho do cadastro). Itens simples, copiados com memcpy.
+// false sem memória: a tabela fica como estava.
+template <typename T>
+bool garantirCapacidade(T *&vetor, size_t &cap, size_t n) {
+  if (n <= cap) return true;
+  size_t novo = cap ? cap : 16;
+  while (novo < n) novo *= 2;
+  T *p = (T *)realloc(vetor, novo * sizeof(T));
+  if (!p) return false;
+  vetor = p;
+  cap   = novo;
+  return true;
+}
+
+// =========== Usuários que entraram e não saíram hoje ===========
+
+struct ContagemDentro {
+  char uid[UID_MAX_LEN + 1];
+  int  count;
+  bool ehUsuario;      // consultado em CARDS_FILE na consulta, não a cada movimentação
+};
+
+// 'itens' sai alocado com malloc (NULL se ninguém está dentro): quem chama dá free()
+bool   coletarUsuariosDentroHoje(ContagemDentro *&itens, int &numItens, size_t &totalPendencias);
+int    contagemDentro(const char *uid, int32_t diaNum);   // 0 se não está na tabela desse dia
+size_t listarUsuariosDentroHoje();
+void   publishUsuariosDentroHojeToMQTT();
+
+// =========== Presença semanal por UID ===========
+#define PRESENCA_SEMANAS     4      // semana atual + 3 anteriores
+
+int32_t segundaDoDia(int32_t diaNum);
+
+// 'semanasAtras' = 0 para a semana atual, 1 para a anterior, ... (até PRESENCA_SEMANAS-1).
+size_t computeDiasSemanaPorUid(const String &uidRaw, bool diasSemana[7], String &uidNormalizado,
+                               int semanasAtras = 0);
+void   consultarDiasSemanaPorUidSerial(const String &uidRaw, int semanasAtras = 0);
+void   publishDiasSemanaPorUidToMQTT(const String &uidRaw, int semanasAtras = 0);
+
+// =========== Atrasos: primeira entrada do dia ===========
+struct PrimeiraEntrada {
+  char     uid[UID_MAX_LEN + 1];
+  uint32_t segundos;     // hora da primeira entrada
+  uint32_t limite;       // limite vigente para esse UID
+};
+
+int32_t  segundosFromHoraStr(const char *p, size_t len);   // -1 se inválida
+int32_t  segundosFromHoraStr(const String &horaStr);
+String   horaStrFromSegundos(uint32_t seg);
+uint32_t limiteParaUid(const char *uid);
+void     carregarHorariosLimite();
+bool     definirHorarioLimite(const String &uidRaw, uint32_t segundos);
+// 'saida' sai alocado com malloc (NULL se ninguém atrasou): quem chama dá free()
+size_t   coletarAtrasosHoje(PrimeiraEntrada *&saida, String &dataHoje);
+size_t   listarAtrasosHoje();
+void     publishAtrasosHojeToMQTT();
+
+// =========== Estado derivado do log (em RAM) ===========
+// Aplica uma movimentação nas três tabelas acima; 'fimLinha' é o byte do log
+// logo depois dela. diaNum < 0 (sem data) só avança o offset.
+void     aplicarMovimentacaoEstado(const char *uidFunc, const char *uidUser, bool entrada,
+                                   int32_t diaNum, int32_t segundos, size_t fimLinha);
+void     avancarOffsetEstado(size_t offset);
+size_t   offsetEstadoDerivado();      // até onde o log já está nas tabelas
+uint32_t registrosEstadoDerivado();   // movimentações aplicadas desde o boot
+void     zerarEstadoDerivado();
+// Boot: reserva as tabelas para 'uids' UIDs de uma vez (0 = deixa crescer)
+void     reservarEstadoDerivado(size_t uids);
+// UIDs que ficaram fora de alguma tabela por falta de memória (LOG_ERRO a cada um)
+uint32_t uidsForaEstadoDerivado();
+// Serialização para o checkpoint (gravar com mtxEstado na mão)
+bool     gravarEstadoDerivado(File &f, uint32_t &crc);
+bool     lerEstadoDerivado(File &f, uint32_t &crc);
@@ -0,0 +1,250 @@
+#include "serializador.h"
+
+#include "comandos.h"
+#include "config.h"
+#include "estado.h"
+#include "log_serial.h"
+
+// ======================= Formato por canal =======================
+
+static FormatoCarga formatos[NUM_CANAIS] = { FORMATO_JSON, FORMATO_JSON, FORMATO_JSON, FORMATO_JSON, FORMATO_JSON };
+static const char  *NOMES_CANAIS[NUM_CANAIS] = { "movimentacoes", "status", "dentro", "estado", "metrics" };
+
+FormatoCarga formatoCanal(CanalCarga canal) {
+  return canal < NUM_CANAIS ? formatos[canal] : FORMATO_JSON;
+}
+
+FormatoCarga formatoResposta(CanalCarga canal) {
+  FormatoCarga f;
+  return formatoRequisicaoAtual(f) ? f : formatoCanal(canal);
+}
+
+bool formatoPorNome(const char *nome, FormatoCarga &formato) {
+  if (!nome) return false;
+  if (strcmp(nome, "json") == 0)    { formato = FORMATO_JSON;    return true; }
+  if (strcmp(nome, "msgpack") == 0) { formato = FORMATO_MSGPACK; return true; }
+  return false;
+}
+
+const char *nomeFormato(FormatoCarga formato) {
+  return formato == FORMATO_MSGPACK ? "msgpack" : "json";
+}
+
+bool definirFormatoCanal(const char *nomeCanal, FormatoCarga formato) {
+  if (!nomeCanal) return false;
+  bool todos = strcmp(nomeCanal, "todos") == 0;
+  // o estado retido fica sempre em JSON: o dashboard só o lê assim e uma
+  // retida em mp/ deixaria a JSON parada no broker como se fosse atual
+  if (formato == FORMATO_MSGPACK && (todos || strcmp(nomeCanal, NOMES_CANAIS[CANAL_ESTADO]) == 0)) {
+    return false;
+  }
+  bool achou = false;
+  for (uint8_t c = 0; c < NUM_CANAIS; c++) {
+    if (todos || strcmp(nomeCanal, NOMES_CANAIS[c]) == 0) {
+      formatos[c] = formato;
+      achou = true;
+    }
+  }
+  return achou;
+}
+
+// ======================= Serializador =======================
+
+Serializador::Serializador(char *buf, size_t cap, FormatoCarga formato)
+  : buf(buf), cap(cap), len(0), fmt(formato), estourou(cap == 0), numNiveis(0) {
+  if (cap) buf[0] = '\0';
+}
+
+// Sempre sobra 1 byte para o '\0' depois do que foi escrito
+bool Serializador::escrever(const void *p, size_t n) {
+  if (estourou || len + n + 1 > cap) {
+    estourou = true;
+    return false;
+  }
+  memcpy(buf + len, p, n);
+  len += n;
+  buf[len] = '\0';
+  return true;
+}
+
+bool Serializador::inteiroBE(uint64_t v, uint8_t bytes) {
+  uint8_t b[8];
+  for (uint8_t i = 0; i < bytes; i++) b[i] = (uint8_t)(v >> (8 * (bytes - 1 - i)));
+  return escrever(b, bytes);
+}
+
+// Texto sem cabeçalho de campo: JSON com aspas e escape, MessagePack str
+void Serializador::textoCru(const char *valor, size_t n) {
+  if (fmt == FORMATO_MSGPACK) {
+    if (n < 32)         byte(0xa0 | (uint8_t)n);
+    else if (n < 256)   { byte(0xd9); inteiroBE(n, 1); }
+    else if (n < 65536) { byte(0xda); inteiroBE(n, 2); }
+    else                { byte(0xdb); inteiroBE(n, 4); }
+    escrever(valor, n);
+    return;
+  }
+
+  byte('"');
+  size_t ini = 0;   // trecho que vai sem escape
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)valor[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    escrever(valor + ini, i - ini);
+    ini = i + 1;
+    char esc[7];
+    switch (c) {
+      case '"':  escrever("\\\"", 2); break;
+      case '\\': escrever("\\\\", 2); break;
+      case '\n': escrever("\\n", 2);  break;
+      case '\r': escrever("\\r", 2);  break;
+      case '\t': escrever("\\t", 2);  break;
+      default:
+        snprintf(esc, sizeof(esc), "\\u%04x", c);
+        escrever(esc, 6);
+    }
+  }
+  escrever(valor + ini, n - ini);
+  byte('"');
+}
+
+// Vírgula (JSON) e nome do campo; conta o item no nível aberto
+void Serializador::chave(const char *nome) {
+  if (numNiveis == 0) {
+    if (len) estourou = true;   // um valor só na raiz
+    return;
+  }
+  Nivel &nv = niveis[numNiveis - 1];
+  if (fmt == FORMATO_JSON && nv.itens) byte(',');
+  nv.itens++;
+  if (nv.lista) return;
+  if (!nome) {   // campo de objeto sem nome
+    estourou = true;
+    return;
+  }
+  textoCru(nome, strlen(nome));
+  if (fmt == FORMATO_JSON) byte(':');
+}
+
+void Serializador::abrir(const char *nome, bool lista) {
+  chave(nome);
+  if (numNiveis >= SERIALIZADOR_NIVEIS) {
+    estourou = true;
+    return;
+  }
+  Nivel &nv = niveis[numNiveis++];
+  nv.inicio = (uint16_t)len;
+  nv.itens  = 0;
+  nv.lista  = lista;
+  if (fmt == FORMATO_MSGPACK) byte(lista ? 0x90 : 0x80);   // corrigido no fechar()
+  else                        byte(lista ? '[' : '{');
+}
+
+Serializador &Serializador::objeto(const char *nome) { abrir(nome, false); return *this; }
+Serializador &Serializador::lista(const char *nome)  { abrir(nome, true);  return *this; }
+
+Serializador &Serializador::fechar() {
+  if (numNiveis == 0) {
+    estourou = true;
+    return *this;
+  }
+  Nivel nv = niveis[--numNiveis];
+  if (fmt == FORMATO_JSON) {
+    byte(nv.lista ? ']' : '}');
+    return *this;
+  }
+  if (estourou) return *this;
+  if (nv.itens < 16) {
+    buf[nv.inicio] = (char)((nv.lista ? 0x90 : 0x80) | nv.itens);
+    return *this;
+  }
+  // map16/array16: o cabeçalho cresce 2 bytes
+  if (len + 2 + 1 > cap) {
+    estourou = true;
+    return *this;
+  }
+  memmove(buf + nv.inicio + 3, buf + nv.inicio + 1, len - nv.inicio - 1);
+  buf[nv.inicio]     = (char)(nv.lista ? 0xdc : 0xde);
+  buf[nv.inicio + 1] = (char)(nv.itens >> 8);
+  buf[nv.inicio + 2] = (char)(nv.itens & 0xFF);
+  len += 2;
+  buf[len] = '\0';
+  return *this;
+}
+
+Serializador &Serializador::texto(const char *nome, const char *valor) {
+  return texto(nome, valor ? valor : "", valor ? strlen(valor) : 0);
+}
+
+Serializador &Serializador::texto(const char *nome, const char *valor, size_t n) {
+  chave(nome);
+  textoCru(valor, n);
+  return *this;
+}
+
+Serializador &Serializador::natural(const char *nome, unsigned long valor) {
+  chave(nome);
+  if (fmt == FORMATO_JSON) {
+    char num[24];
+    escrever(num, snprintf(num, sizeof(num), "%lu", valor));
+  } else if (valor < 128)                 byte((uint8_t)valor);
+  else if (valor < 256)                   { byte(0xcc); inteiroBE(valor, 1); }
+  else if (valor < 65536)                 { byte(0xcd); inteiroBE(valor, 2); }
+  else if ((uint64_t)valor <= 0xFFFFFFFFULL) { byte(0xce); inteiroBE(valor, 4); }
+  else                                    { byte(0xcf); inteiroBE(valor, 8); }
+  return *this;
+}
+
+Serializador &Serializador::inteiro(const char *nome, long valor) {
+  if (valor >= 0) return natural(nome, (unsigned long)valor);
+  chave(nome);
+  if (fmt == FORMATO_JSON) {
+    char num[24];
+    escrever(num, snprintf(num, sizeof(num), "%ld", valor));
+  } else if (valor >= -32)     byte((uint8_t)(0xe0 | (valor & 0x1f)));
+  else if (valor >= -128)      { byte(0xd0); inteiroBE((uint64_t)valor, 1); }
+  else if (valor >= -32768)    { byte(0xd1); inteiroBE((uint64_t)valor, 2); }
+  else if (valor >= INT32_MIN) { byte(0xd2); inteiroBE((uint64_t)valor, 4); }
+  else                         { byte(0xd3); inteiroBE((uint64_t)valor, 8); }
+  return *this;
+}
+
+Serializador &Serializador::logico(const char *nome, bool valor) {
+  chave(nome);
+  if (fmt == FORMATO_JSON) escrever(valor ? "true" : "false", valor ? 4 : 5);
+  else                     byte(valor ? 0xc3 : 0xc2);
+  return *this;
+}
+
+Serializador &Serializador::nulo(const char *nome) {
+  chave(nome);
+  if (fmt == FORMATO_JSON) escrever("null", 4);
+  else                     byte(0xc0);
+  return *this;
+}
+
+Serializador &Serializador::idRequisicao() {
+  const char *id = idRequisicaoAtual();
+  if (id && *id) texto("id", id);
+  return *this;
+}
+
+bool Serializador::publicar(const char *topico, bool retida) const {
+  if (!ok()) {
+    LOG_AVISO("MQTT: payload para %s nao coube em %u bytes, nao enviado.", topico, (unsigned)cap);
+    return false;
+  }
+  if (fmt != FORMATO_MSGPACK) {
+    return mqttClient.publish(topico, (const uint8_t *)buf, (unsigned int)len, retida);
+  }
+  // portaria/<id>/<resto> -> portaria/<id>/mp/<resto>: quem assina os tópicos
+  // JSON nunca recebe binário, e o tópico diz o formato
+  char topicoMp[96];
+  const char *barra = strchr(topico, '/');
+  barra = barra ? strchr(barra + 1, '/') : NULL;
+  if (barra) {
+    snprintf(topicoMp, sizeof(topicoMp), "%.*s/mp%s", (int)(barra - topico), topico, barra);
+  } else {
+    snprintf(topicoMp, sizeof(topicoMp), "%s/mp", topico);
+  }
+  return mqttClient.publish(topicoMp, (const uint8_t *)buf, (unsigned int)len, retida);
+}
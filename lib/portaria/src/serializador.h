@@ -0,0 +1,104 @@
+// Payloads MQTT montados direto num buffer do chamador, em JSON ou MessagePack.
+//
+// Nada é alocado (o buffer costuma ser um char[] na pilha), textos saem com
+// escape no JSON e o mesmo código de montagem serve aos dois formatos:
+//
+//   char buf[160];
+//   Serializador s(buf, sizeof(buf), formatoCanal(CANAL_STATUS));
+//   s.objeto().texto("context", "entrada").texto("status", "success").fechar();
+//   s.publicar(MQTT_TOPIC_STATUS);
+//
+// No MessagePack o número de campos de um objeto/lista só é escrito no
+// fechar(): fixmap/fixarray (1 byte) até 15, map16/array16 acima.
+//
+// O formato é escolhido por canal (tópico) com set_format e, para as respostas
+// de um comando, pelo campo "format" do próprio comando:
+//   {"cmd":"set_format","topico":"movimentacoes","format":"msgpack"}
+//   {"cmd":"get_history","format":"msgpack","id":"h1"}
+// Canais: movimentacoes, status, dentro, metrics. O padrão é json e a escolha
+// fica só em RAM: um boot volta tudo para json. estado (retido) e "todos" não
+// aceitam msgpack: o dashboard, as telas e o agregador só leem JSON.
+//
+// MessagePack nunca sai no tópico JSON: publicar() troca portaria/<id>/<resto>
+// por portaria/<id>/mp/<resto>. Um canal em msgpack deixa de aparecer no
+// tópico JSON (quem só lê JSON para de receber, mas não recebe lixo).
+#pragma once
+
+#include <Arduino.h>
+
+#define SERIALIZADOR_NIVEIS  4   // objetos/listas abertos ao mesmo tempo
+
+enum FormatoCarga : uint8_t {
+  FORMATO_JSON,
+  FORMATO_MSGPACK
+};
+
+enum CanalCarga : uint8_t {
+  CANAL_MOV,       // portaria/<id>/movimentacoes
+  CANAL_STATUS,    // portaria/<id>/status
+  CANAL_DENTRO,    // portaria/<id>/dentro
+  CANAL_ESTADO,    // portaria/<id>/estado/...
+  CANAL_METRICS,   // portaria/<id>/metrics
+  NUM_CANAIS
+};
+
+FormatoCarga formatoCanal(CanalCarga canal);
+// Resposta a um comando: o "format" do pedido, se veio, senão o do canal
+FormatoCarga formatoResposta(CanalCarga canal);
+
+// "json" | "msgpack"
+bool        formatoPorNome(const char *nome, FormatoCarga &formato);
+const char *nomeFormato(FormatoCarga formato);
+// nomeCanal: um dos canais acima ou "todos". false se o nome não existir ou
+// se for msgpack para estado/todos.
+bool        definirFormatoCanal(const char *nomeCanal, FormatoCarga formato);
+
+class Serializador {
+ public:
+  Serializador(char *buf, size_t cap, FormatoCarga formato);
+
+  // Sem chave: na raiz ou como item de lista. Com chave: campo do objeto aberto.
+  Serializador &objeto(const char *chave = NULL);
+  Serializador &lista(const char *chave = NULL);
+  Serializador &fechar();
+
+  Serializador &texto(const char *chave, const char *valor);
+  Serializador &texto(const char *chave, const char *valor, size_t len);
+  Serializador &inteiro(const char *chave, long valor);
+  Serializador &natural(const char *chave, unsigned long valor);
+  Serializador &logico(const char *chave, bool valor);
+  Serializador &nulo(const char *chave);
+  // "id" do comando em execução, se houver (comandos.h)
+  Serializador &idRequisicao();
+
+  // Coube no buffer e tudo que foi aberto foi fechado
+  bool          ok() const { return !estourou && numNiveis == 0 && len > 0; }
+  const char   *dados() const { return buf; }   // no JSON, terminado em '\0'
+  size_t        tamanho() const { return len; }
+  FormatoCarga  formato() const { return fmt; }
+
+  // false se não coube ou o publish falhou
+  bool publicar(const char *topico, bool retida = false) const;
+
+ private:
+  struct Nivel {
+    uint16_t inicio;   // MessagePack: byte do cabeçalho reservado
+    uint16_t itens;
+    bool     lista;
+  };
+
+  char        *buf;
+  size_t       cap;
+  size_t       len;
+  FormatoCarga fmt;
+  bool         estourou;
+  Nivel        niveis[SERIALIZADOR_NIVEIS];
+  uint8_t      numNiveis;
+
+  bool escrever(const void *p, size_t n);
+  bool byte(uint8_t b) { return escrever(&b, 1); }
+  bool inteiroBE(uint64_t v, uint8_t bytes);
+  void chave(const char *nome);
+  void abrir(const char *nome, bool lista);
+  void textoCru(const char *valor, size_t n);
+};
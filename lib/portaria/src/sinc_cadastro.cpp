@@ -0,0 +1,563 @@
+#include "sinc_cadastro.h"
+
+#include <limits.h>
+
+#include "armazenamento.h"
+#include "comandos.h"
+#include "config.h"
+#include "estado.h"
+#include "imagem_cadastro.h"
+#include "log_serial.h"
+#include "serializador.h"
+
+static const char *VERSAO_FILE = "/cadastro.ver";
+#define VERSAO_MAGIC  0x31524556UL   // "VER1"
+
+struct ArquivoVersao {
+  uint32_t magic;
+  uint32_t versao;
+};
+
+static uint32_t versaoAtual = 0;
+
+// Importação em andamento (partesImport = 0: nenhuma)
+static int      partesImport = 0;
+static int      proximaParte = 0;
+static uint32_t uidsImport   = 0;
+
+// Arquivos novos são montados ao lado dos atuais ("<arquivo><sufixo>") e
+// trocados juntos no loop(), depois que o callback MQTT retorna
+static const char *SUFIXO_IMPORT = ".imp";
+static const char *SUFIXO_DIFF   = ".dif";
+static const char *trocaAgendada = NULL;   // sufixo esperando o loop() (NULL: nenhuma)
+
+struct ItemCadastro {
+  char    uid[UID_MAX_LEN + 1];
+  uint8_t len;
+  uint8_t papeis;
+  uint8_t vistos;    // diff: arquivos em que o UID já estava
+  bool    remover;
+};
+
+static const char *arquivoDoPapel(uint8_t i) { return i == 0 ? CARDS_FILE : ADMINS_FILE; }
+static uint8_t     bitDoPapel(uint8_t i)     { return i == 0 ? PAPEL_USUARIO : PAPEL_FUNCIONARIO; }
+static String      arquivoPreparado(uint8_t i, const char *sufixo) { return String(arquivoDoPapel(i)) + sufixo; }
+static String      arquivoImport(uint8_t i)  { return arquivoPreparado(i, SUFIXO_IMPORT); }
+// Marca de troca em andamento: a versão que o cadastro terá quando terminar
+static String      marcaTroca(const char *sufixo) { return String(VERSAO_FILE) + sufixo; }
+
+// ======================= Versão =======================
+
+static bool lerVersao(const char *path, uint32_t &versao) {
+  File f = abrirArquivo(path, FILE_READ);
+  if (!f) return false;
+  ArquivoVersao v;
+  uint32_t crc = 0, crcGravado;
+  bool ok = lerComCrc(f, &v, sizeof(v), crc) &&
+            f.read((uint8_t*)&crcGravado, sizeof(crcGravado)) == sizeof(crcGravado) &&
+            crcGravado == crc && v.magic == VERSAO_MAGIC;
+  f.close();
+  if (ok) versao = v.versao;
+  return ok;
+}
+
+static bool gravarVersao(const char *path, uint32_t versao) {
+  String tmp = String(path) + ".tmp";
+  File f = abrirArquivo(tmp.c_str(), FILE_WRITE);
+  ArquivoVersao v = { VERSAO_MAGIC, versao };
+  uint32_t crc = 0;
+  bool ok = f && gravarComCrc(f, &v, sizeof(v), crc) &&
+            f.write((const uint8_t*)&crc, sizeof(crc)) == sizeof(crc);
+  if (f) f.close();
+  return ok && substituirArquivo(tmp.c_str(), path);
+}
+
+// ======================= Troca dos dois arquivos =======================
+
+// Os arquivos preparados com 'sufixo' tomam o lugar dos atuais como um par.
+// A marca (com a versão 'alvo') é gravada antes da primeira troca e só sai
+// depois da versão: se faltar energia no meio, o boot termina as trocas que
+// faltaram (concluirTrocaPendente). Se uma troca falhar aqui, a marca fica,
+// a versão não anda e a imagem segue com o cadastro antigo inteiro.
+static bool trocarArquivos(const char *sufixo, uint32_t alvo, bool marcar) {
+  String marca = marcaTroca(sufixo);
+  if (marcar && !gravarVersao(marca.c_str(), alvo)) {
+    LOG_ERRO("Cadastro: nao foi possivel gravar %s; nada foi trocado.", marca.c_str());
+    return false;
+  }
+  bool ok = true;
+  for (uint8_t i = 0; i < 2; i++) {
+    String prep = arquivoPreparado(i, sufixo);
+    if (arquivoExiste(prep.c_str())) ok = substituirArquivo(prep.c_str(), arquivoDoPapel(i)) && ok;
+  }
+  if (!ok) {
+    LOG_ERRO("Cadastro: troca %s incompleta; termina no proximo pedido ou boot.", sufixo);
+    return false;
+  }
+  reconstruirImagemCadastro();
+  if (!gravarVersao(VERSAO_FILE, alvo)) {
+    LOG_ERRO("Cadastro: nao foi possivel gravar a versao %lu.", (unsigned long)alvo);
+    return false;
+  }
+  versaoAtual = alvo;
+  removerArquivo(marca.c_str());
+  return true;
+}
+
+// Troca marcada e não terminada (boot no meio ou erro de escrita): termina.
+// Sem marca, arquivos preparados que sobraram são de uma troca que não
+// começou e vão embora. false se ainda não deu.
+static bool concluirTrocaPendente(const char *sufixo) {
+  uint32_t alvo;
+  if (!lerVersao(marcaTroca(sufixo).c_str(), alvo)) {
+    if (sufixo != SUFIXO_IMPORT || partesImport == 0) {
+      for (uint8_t i = 0; i < 2; i++) removerArquivo(arquivoPreparado(i, sufixo).c_str());
+    }
+    return true;
+  }
+  LOG_AVISO("Cadastro: terminando a troca %s interrompida (versao %lu).", sufixo, (unsigned long)alvo);
+  return trocarArquivos(sufixo, alvo, false);
+}
+
+static bool concluirTrocasPendentes() {
+  bool ok = concluirTrocaPendente(SUFIXO_IMPORT);
+  return concluirTrocaPendente(SUFIXO_DIFF) && ok;
+}
+
+void carregarVersaoCadastro() {
+  String tmp = String(VERSAO_FILE) + ".tmp";
+  if (!lerVersao(VERSAO_FILE, versaoAtual) && !lerVersao(tmp.c_str(), versaoAtual)) versaoAtual = 0;
+  concluirTrocasPendentes();
+  LOG_INFO("Cadastro: versao %lu.", (unsigned long)versaoAtual);
+}
+
+uint32_t versaoCadastro() {
+  return versaoAtual;
+}
+
+uint32_t avancarVersaoCadastro() {
+  versaoAtual++;
+  if (!gravarVersao(VERSAO_FILE, versaoAtual)) {
+    LOG_ERRO("Cadastro: nao foi possivel gravar a versao %lu.", (unsigned long)versaoAtual);
+  }
+  return versaoAtual;
+}
+
+// ======================= Listas "uid:papeis,..." =======================
+
+static size_t contarItens(const char *s) {
+  if (!s || !*s) return 0;
+  size_t n = 1;
+  for (const char *p = s; *p; p++) n += (*p == ',');
+  return n;
+}
+
+// Próximo item de 'p' (que avança). false no fim da lista; 'valido' = false
+// se o item não é um UID hex (tamanho par, até UID_MAX_LEN) com papéis u/f.
+static bool proximoItem(const char *&p, uint8_t papeisPadrao, ItemCadastro &it, bool &valido) {
+  while (*p == ',' || isspace((unsigned char)*p)) p++;
+  if (!*p) return false;
+  const char *ini = p;
+  while (*p && *p != ',') p++;
+  Trecho t = trechoAparado(ini, p - ini);
+
+  const char *dois = (const char*)memchr(t.p, ':', t.len);
+  size_t lenUid = dois ? (size_t)(dois - t.p) : t.len;
+  memset(&it, 0, sizeof(it));
+  valido = lenUid >= 2 && lenUid <= UID_MAX_LEN && (lenUid % 2) == 0;
+  for (size_t i = 0; valido && i < lenUid; i++) {
+    valido = isxdigit((unsigned char)t.p[i]);
+    it.uid[i] = (char)tolower((unsigned char)t.p[i]);
+  }
+  it.len = (uint8_t)lenUid;
+
+  if (!dois) {
+    it.papeis = papeisPadrao;
+  } else {
+    for (const char *c = dois + 1; c < t.p + t.len; c++) {
+      if (*c == 'u' || *c == 'U')      it.papeis |= PAPEL_USUARIO;
+      else if (*c == 'f' || *c == 'F') it.papeis |= PAPEL_FUNCIONARIO;
+      else                             valido = false;
+    }
+    if (!it.papeis) valido = false;
+  }
+  return true;
+}
+
+// Preenche 'itens' (capacidade 'max') a partir de 'lista'; -1 se algum item é inválido
+static int lerItens(const char *lista, uint8_t papeisPadrao, bool remover, ItemCadastro *itens, size_t max) {
+  if (!lista) return 0;
+  const char *p = lista;
+  ItemCadastro it;
+  bool valido;
+  size_t n = 0;
+  while (proximoItem(p, papeisPadrao, it, valido)) {
+    if (!valido || n >= max) return -1;
+    it.remover = remover;
+    itens[n++] = it;
+  }
+  return (int)n;
+}
+
+// ======================= Respostas =======================
+
+#define AUSENTE  LONG_MIN
+
+// Campos de uma resposta, na ordem em que saem (AUSENTE / NULL = não sai)
+struct CamposRoster {
+  long        parte       = AUSENTE;
+  long        partes      = AUSENTE;
+  long        esperada    = AUSENTE;
+  long        desde       = AUSENTE;
+  long        uids        = AUSENTE;   // quantos (import)
+  long        adicionados = AUSENTE;
+  long        removidos   = AUSENTE;
+  const char *lote        = NULL;      // "uids" em texto (export)
+  const char *crc         = NULL;
+};
+
+// {"context":"roster","event":...,"status":...[,"reason":...],<campos>,"versao":N}
+static void publicarRoster(const char *evento, const char *status, const char *motivo,
+                           const CamposRoster &c = CamposRoster()) {
+  if (!mqttClient.connected()) return;
+  static char buf[MQTT_BUFFER_TAM];   // só o loop()/callback MQTT responde aqui
+  Serializador s(buf, sizeof(buf), formatoResposta(CANAL_STATUS));
+  s.objeto().texto("context", "roster").texto("event", evento).texto("status", status);
+  if (motivo)                   s.texto("reason", motivo);
+  if (c.parte != AUSENTE)       s.inteiro("parte", c.parte);
+  if (c.partes != AUSENTE)      s.inteiro("partes", c.partes);
+  if (c.esperada != AUSENTE)    s.inteiro("esperada", c.esperada);
+  if (c.desde != AUSENTE)       s.inteiro("desde", c.desde);
+  if (c.uids != AUSENTE)        s.inteiro("uids", c.uids);
+  if (c.lote)                   s.texto("uids", c.lote);
+  if (c.crc)                    s.texto("crc", c.crc);
+  if (c.adicionados != AUSENTE) s.inteiro("adicionados", c.adicionados);
+  if (c.removidos != AUSENTE)   s.inteiro("removidos", c.removidos);
+  s.natural("versao", versaoAtual).idRequisicao().fechar();
+  s.publicar(MQTT_TOPIC_STATUS);
+}
+
+void publicarVersaoCadastro() {
+  Serial.print("Versao do cadastro: ");
+  Serial.println((unsigned long)versaoAtual);
+  publicarRoster("version", "ok", NULL);
+}
+
+// ======================= Troca agendada =======================
+
+static void concluirTrocaAgendada(const ArgsComando &);
+
+// Fora da tabela de comandos: só entram na fila por agendarTroca()
+static const Comando CONCLUIR_IMPORT = { "roster_import", 0, {}, COMANDO_LONGO, concluirTrocaAgendada, NULL };
+static const Comando CONCLUIR_DIFF   = { "roster_diff",   0, {}, COMANDO_LONGO, concluirTrocaAgendada, NULL };
+
+static CamposRoster camposTroca;   // resposta de quando a troca terminar
+
+// Callback: os arquivos já estão preparados, a troca fica para o loop().
+// false (nada agendado) com a filaComandos cheia.
+static bool agendarTroca(const char *sufixo, const CamposRoster &info) {
+  if (!continuarNoLoop(sufixo == SUFIXO_IMPORT ? CONCLUIR_IMPORT : CONCLUIR_DIFF)) return false;
+  trocaAgendada = sufixo;
+  camposTroca   = info;
+  return true;
+}
+
+// loop(): troca os dois arquivos, monta a imagem uma vez e só então avança a versão
+static void concluirTrocaAgendada(const ArgsComando &) {
+  const char *sufixo = trocaAgendada;
+  if (!sufixo) return;
+  bool import = sufixo == SUFIXO_IMPORT;
+  bool ok = trocarArquivos(sufixo, versaoAtual + 1, true);
+  trocaAgendada = NULL;
+  if (!ok && !arquivoExiste(marcaTroca(sufixo).c_str())) {   // nem marcou: nada foi trocado
+    for (uint8_t i = 0; i < 2; i++) removerArquivo(arquivoPreparado(i, sufixo).c_str());
+  }
+
+  if (ok && import) {
+    LOG_INFO("roster_import: %ld UID(s) importado(s), versao %lu.", camposTroca.uids, (unsigned long)versaoAtual);
+  } else if (ok) {
+    LOG_INFO("roster_diff: +%ld -%ld, versao %lu.", camposTroca.adicionados, camposTroca.removidos,
+             (unsigned long)versaoAtual);
+  }
+  publicarRoster(import ? "import" : "diff", ok ? (import ? "done" : "ok") : "error",
+                 ok ? NULL : "fs_write_failed", camposTroca);
+}
+
+// ======================= Importação =======================
+
+static void cancelarImportacao() {
+  partesImport = 0;
+  proximaParte = 0;
+  uidsImport   = 0;
+  for (uint8_t i = 0; i < 2; i++) removerArquivo(arquivoImport(i).c_str());
+}
+
+void importarParteCadastro(int parte, int partes, const char *uids, const char *crcHex) {
+  if (!uids) uids = "";
+  CamposRoster info;
+  info.parte  = parte;
+  info.partes = partes;
+  if (partes < 1 || partes > SINC_PARTES_MAX || parte < 0 || parte >= partes) {
+    publicarRoster("import", "error", "bad_args", info);
+    return;
+  }
+  if (trocaAgendada) {
+    publicarRoster("import", "error", "busy", info);
+    return;
+  }
+
+  char *fimCrc;
+  unsigned long crcEsperado = strtoul(crcHex, &fimCrc, 16);
+  if (fimCrc == crcHex || *fimCrc || crcEsperado != crc32Atualizar(0, uids, strlen(uids))) {
+    LOG_AVISO("roster_import: parte %d com CRC errado.", parte);
+    publicarRoster("import", "error", "bad_crc", info);
+    return;
+  }
+  if (parte != 0 && (partesImport == 0 || partes != partesImport || parte != proximaParte)) {
+    LOG_AVISO("roster_import: parte %d fora de ordem (esperada %d).", parte, proximaParte);
+    info.esperada = proximaParte;
+    publicarRoster("import", "error", "out_of_order", info);
+    return;
+  }
+
+  // confere tudo antes de gravar: parte com UID inválido não entra pela metade
+  const char *p = uids;
+  ItemCadastro it;
+  bool valido;
+  while (proximoItem(p, PAPEL_USUARIO, it, valido)) {
+    if (!valido) {
+      publicarRoster("import", "error", "bad_uid", info);
+      return;
+    }
+  }
+
+  if (parte == 0) {
+    if (!concluirTrocasPendentes()) {
+      publicarRoster("import", "error", "fs_write_failed", info);
+      return;
+    }
+    cancelarImportacao();
+    partesImport = partes;
+    for (uint8_t i = 0; i < 2; i++) {
+      File f = abrirArquivo(arquivoImport(i).c_str(), FILE_WRITE);   // existe mesmo sem UIDs
+      if (f) f.close();
+    }
+  }
+
+  File arq[2] = { abrirArquivo(arquivoImport(0).c_str(), FILE_APPEND),
+                  abrirArquivo(arquivoImport(1).c_str(), FILE_APPEND) };
+  bool ok = arq[0] && arq[1];
+  p = uids;
+  while (ok && proximoItem(p, PAPEL_USUARIO, it, valido)) {
+    it.uid[it.len++] = '\n';
+    for (uint8_t i = 0; ok && i < 2; i++) {
+      if (it.papeis & bitDoPapel(i)) ok = arq[i].write((const uint8_t*)it.uid, it.len) == it.len;
+    }
+    uidsImport++;
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    if (arq[i]) arq[i].close();
+  }
+  if (!ok) {
+    LOG_ERRO("roster_import: erro ao gravar a parte %d; importacao cancelada.", parte);
+    cancelarImportacao();
+    publicarRoster("import", "error", "fs_write_failed", info);
+    return;
+  }
+
+  proximaParte++;
+  if (proximaParte < partesImport) {
+    info.uids = uidsImport;
+    publicarRoster("import", "ok", NULL, info);
+    return;
+  }
+
+  // última parte: a troca e a imagem saem do callback
+  info.uids    = uidsImport;
+  partesImport = 0;
+  if (!agendarTroca(SUFIXO_IMPORT, info)) {
+    LOG_AVISO("roster_import: filaComandos cheia; importacao cancelada.");
+    cancelarImportacao();
+    publicarRoster("import", "error", "busy", info);
+    return;
+  }
+  publicarRoster("import", "queued", NULL, info);
+}
+
+// ======================= Diff =======================
+
+static int buscarItem(const ItemCadastro *itens, size_t n, const Trecho &t, bool remover, uint8_t papel) {
+  for (size_t k = 0; k < n; k++) {
+    if (itens[k].remover == remover && (itens[k].papeis & papel) && trechoIgual(t, itens[k].uid, itens[k].len)) {
+      return (int)k;
+    }
+  }
+  return -1;
+}
+
+// Prepara ao lado ("<arquivo>.dif") o arquivo do papel 'i' sem os removidos
+// e com os acrescentados que ainda não estavam nele. Se nada mudar, não fica
+// arquivo preparado.
+static bool aplicarDiffArquivo(uint8_t i, ItemCadastro *itens, size_t n, uint32_t &adicionados, uint32_t &removidos) {
+  const char *path = arquivoDoPapel(i);
+  uint8_t papel    = bitDoPapel(i);
+  String tmp       = arquivoPreparado(i, SUFIXO_DIFF);
+  File w = abrirArquivo(tmp.c_str(), FILE_WRITE);
+  if (!w) return false;
+
+  bool ok = true;
+  uint32_t antesAdd = adicionados, antesRem = removidos;
+  File f = abrirArquivo(path, FILE_READ);
+  if (f) {
+    char buf[128];
+    LeitorLinhas leitor(f, buf, sizeof(buf));
+    Trecho linha;
+    while (ok && leitor.proxima(linha)) {
+      Trecho t = trechoAparado(linha.p, linha.len);
+      if (!t.len) continue;
+      if (buscarItem(itens, n, t, true, papel) >= 0) {
+        removidos++;
+        continue;
+      }
+      int k = buscarItem(itens, n, t, false, papel);
+      if (k >= 0) itens[k].vistos |= papel;
+      ok = w.write((const uint8_t*)t.p, t.len) == t.len && w.write((const uint8_t*)"\n", 1) == 1;
+    }
+    f.close();
+  }
+  for (size_t k = 0; ok && k < n; k++) {
+    if (itens[k].remover || !(itens[k].papeis & papel) || (itens[k].vistos & papel)) continue;
+    itens[k].vistos |= papel;   // UID repetido na lista entra uma vez
+    ok = w.write((const uint8_t*)itens[k].uid, itens[k].len) == itens[k].len &&
+         w.write((const uint8_t*)"\n", 1) == 1;
+    adicionados++;
+  }
+  w.close();
+
+  if (!ok || (adicionados == antesAdd && removidos == antesRem)) {   // erro, ou nada mudou neste arquivo
+    removerArquivo(tmp.c_str());
+  }
+  return ok;
+}
+
+void aplicarDiffCadastro(int desde, const char *add, const char *del) {
+  CamposRoster info;
+  info.desde = desde;
+  if (trocaAgendada) {
+    publicarRoster("diff", "error", "busy", info);
+    return;
+  }
+  if (!concluirTrocasPendentes()) {
+    publicarRoster("diff", "error", "fs_write_failed", info);
+    return;
+  }
+  if (desde < 0 || (uint32_t)desde != versaoAtual) {
+    LOG_AVISO("roster_diff: desde a versao %d, mas o cadastro esta na %lu.", desde, (unsigned long)versaoAtual);
+    publicarRoster("diff", "error", "version_mismatch", info);
+    return;
+  }
+
+  size_t max = contarItens(add) + contarItens(del);
+  ItemCadastro *itens = max ? (ItemCadastro*)malloc(max * sizeof(ItemCadastro)) : NULL;
+  if (max && !itens) {
+    publicarRoster("diff", "error", "no_memory", info);
+    return;
+  }
+  int nAdd = lerItens(add, PAPEL_USUARIO, false, itens, max);
+  int nDel = nAdd < 0 ? -1 : lerItens(del, PAPEL_USUARIO | PAPEL_FUNCIONARIO, true, itens + nAdd, max - nAdd);
+  if (nAdd < 0 || nDel < 0) {
+    free(itens);
+    publicarRoster("diff", "error", "bad_uid", info);
+    return;
+  }
+
+  uint32_t adicionados = 0, removidos = 0;
+  bool ok = true;
+  for (uint8_t i = 0; ok && i < 2; i++) {
+    ok = aplicarDiffArquivo(i, itens, (size_t)(nAdd + nDel), adicionados, removidos);
+  }
+  free(itens);
+  info.adicionados = adicionados;
+  info.removidos   = removidos;
+
+  if (!ok) {   // nada foi trocado: o cadastro e a versão ficam como estavam
+    for (uint8_t i = 0; i < 2; i++) removerArquivo(arquivoPreparado(i, SUFIXO_DIFF).c_str());
+    LOG_ERRO("roster_diff: erro ao preparar os arquivos; nada mudou.");
+    publicarRoster("diff", "error", "fs_write_failed", info);
+    return;
+  }
+  if (!adicionados && !removidos) {
+    LOG_INFO("roster_diff: nada a mudar, versao %lu.", (unsigned long)versaoAtual);
+    publicarRoster("diff", "ok", NULL, info);
+    return;
+  }
+  // os dois arquivos, a imagem (uma vez para o diff inteiro) e a versão saem do callback
+  if (!agendarTroca(SUFIXO_DIFF, info)) {
+    for (uint8_t i = 0; i < 2; i++) removerArquivo(arquivoPreparado(i, SUFIXO_DIFF).c_str());
+    LOG_AVISO("roster_diff: filaComandos cheia; nada mudou.");
+    publicarRoster("diff", "error", "busy", info);
+    return;
+  }
+  publicarRoster("diff", "queued", NULL, info);
+}
+
+// ======================= Exportação =======================
+
+static void publicarParteExportada(int parte, int partes, const String &lote) {
+  char crc[9];
+  snprintf(crc, sizeof(crc), "%08lx", (unsigned long)crc32Atualizar(0, lote.c_str(), lote.length()));
+  CamposRoster info;
+  info.parte  = parte;
+  info.partes = partes;
+  info.lote   = lote.c_str();
+  info.crc    = crc;
+  publicarRoster("export", "ok", NULL, info);
+}
+
+// Passa pelos dois arquivos em partes de até SINC_LOTE_BYTES; com partes > 0
+// publica cada uma. Devolve quantas partes deu.
+static int percorrerExportacao(int partes) {
+  String lote;
+  int parte = 0;
+  char buf[128];
+  for (uint8_t i = 0; i < 2; i++) {
+    File f = abrirArquivo(arquivoDoPapel(i), FILE_READ);
+    if (!f) continue;
+    LeitorLinhas leitor(f, buf, sizeof(buf));
+    Trecho linha;
+    while (leitor.proxima(linha)) {
+      char texto[sizeof(buf)];
+      trechoCopiar(linha, texto, sizeof(texto));
+      const char *p = texto;
+      ItemCadastro it;
+      bool valido;
+      if (!proximoItem(p, bitDoPapel(i), it, valido) || !valido || it.papeis != bitDoPapel(i)) continue;
+
+      size_t tam = it.len + 2;   // "uid:u"
+      if (lote.length() && lote.length() + 1 + tam > SINC_LOTE_BYTES) {
+        if (partes) publicarParteExportada(parte, partes, lote);
+        parte++;
+        lote = "";
+      }
+      if (lote.length()) lote += ",";
+      lote += it.uid;
+      lote += (i == 0) ? ":u" : ":f";
+    }
+    f.close();
+  }
+  if (lote.length() || parte == 0) {
+    if (partes) publicarParteExportada(parte, partes, lote);
+    parte++;
+  }
+  return parte;
+}
+
+void exportarCadastroToMQTT() {
+  if (!mqttClient.connected()) {
+    LOG_INFO("MQTT: nao conectado, nao exporta o cadastro.");
+    return;
+  }
+  int partes = percorrerExportacao(0);
+  percorrerExportacao(partes);
+  LOG_INFO("roster_export: %d parte(s), versao %lu.", partes, (unsigned long)versaoAtual);
+}
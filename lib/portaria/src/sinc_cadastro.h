@@ -0,0 +1,44 @@
+// Carga e sincronização do cadastro pelo MQTT, sem um toque de cartão por UID.
+//
+// O cadastro tem uma versão que só cresce: cada mudança (cadastro ou remoção
+// na portaria, importação, diff) soma 1 e fica gravada em flash. Um cliente
+// que conhece a versão N manda só o que mudou desde N; se a portaria já está
+// em outra versão, o diff é recusado com a versão atual e o cliente refaz a
+// conta (ou exporta/importa tudo).
+//
+// Listas de UIDs vão num texto "uid:papeis,uid:papeis,..." (o parser de
+// comandos não aceita listas JSON). papeis = 'u' (usuário), 'f' (funcionário)
+// ou "uf"; sem ":papeis" vale 'u' para acrescentar e "uf" para remover.
+//
+//   {"cmd":"roster_import","parte":0,"partes":3,"uids":"a1b2c3d4:u,...","crc":"1c291ca3"}
+//     Troca o cadastro inteiro. "crc" é o CRC-32 (zlib) do texto de "uids"
+//     daquela parte; as partes chegam em ordem, a 0 recomeça.
+//   {"cmd":"roster_diff","desde":12,"add":"...","del":"..."}
+//     Acrescenta/remove de uma vez (uma regravação por arquivo, uma imagem).
+//
+// Nos dois, o callback MQTT só monta os arquivos novos ao lado dos atuais e
+// responde "queued"; a troca do par, a imagem e a versão rodam no loop()
+// (filaComandos), com "done"/"ok" no fim. Enquanto isso, outro import/diff
+// recebe "busy". Uma marca gravada antes da primeira troca faz o boot
+// terminar um par trocado pela metade; a versão só anda com tudo gravado.
+//   {"cmd":"roster_export"}     o cadastro em partes no mesmo formato do import
+//   {"cmd":"roster_version"}    só a versão
+//
+// Respostas em portaria/status: {"context":"roster","event":...,"status":...,"versao":...}.
+#pragma once
+
+#include <Arduino.h>
+
+#define SINC_LOTE_BYTES  768   // texto de "uids" por parte exportada (cabe em MQTT_BUFFER_TAM)
+#define SINC_PARTES_MAX  1000
+
+// Boot: lê a versão gravada (0 se não houver)
+void     carregarVersaoCadastro();
+uint32_t versaoCadastro();
+// Cadastro mudou: versão + 1, gravada antes de devolver
+uint32_t avancarVersaoCadastro();
+
+void importarParteCadastro(int parte, int partes, const char *uids, const char *crcHex);
+void aplicarDiffCadastro(int desde, const char *add, const char *del);
+void exportarCadastroToMQTT();
+void publicarVersaoCadastro();
@@ -0,0 +1,156 @@
+#include "telemetria.h"
+
+#include "freertos/queue.h"
+
+#include "armazenamento.h"
+#include "estado.h"
+#include "log_serial.h"
+#include "movimentacoes.h"
+#include "relatorios.h"
+#include "serializador.h"
+
+volatile uint32_t filaCartoesDescartes = 0;
+volatile uint32_t filaCartoesPico      = 0;
+volatile uint32_t mqttReconexoes       = 0;
+
+struct TarefaMonitorada {
+  const char  *nome;
+  TaskHandle_t tarefa;
+};
+
+static TarefaMonitorada tarefas[TELEMETRIA_MAX_TAREFAS];
+static uint8_t          numTarefas = 0;
+
+static unsigned long ultimoEnvioMs = 0;
+static bool          jaEnviou      = false;
+
+static uint32_t marcosBoot[BOOT_MARCOS] = {
+  MARCO_PENDENTE, MARCO_PENDENTE, MARCO_PENDENTE, MARCO_PENDENTE, MARCO_PENDENTE
+};
+static bool marcosBootEnviados = false;
+
+// uptime_s e os contadores crescem com o tempo: a carga usa o que sobra do
+// buffer do PubSubClient (MQTT_BUFFER_TAM) depois do cabeçalho (até 5 bytes),
+// do tamanho do tópico (2) e do tópico, já com o "/mp" do msgpack
+static char bufTelemetria[MQTT_BUFFER_TAM];   // só o loop() usa isto
+
+static size_t cargaMaxTelemetria() {
+  size_t ocupado = 5 + 2 + strlen(MQTT_TOPIC_METRICS) + 3;
+  return ocupado < sizeof(bufTelemetria) ? sizeof(bufTelemetria) - ocupado : 0;
+}
+
+static const char *NOMES_MARCOS[BOOT_MARCOS] = {
+  "pronto_ms",
+  "wifi_ms",
+  "ntp_ms",
+  "mqtt_ms",
+  "primeiro_toque_ms",
+};
+
+void marcarBoot(MarcoBoot m) {
+  if (m >= BOOT_MARCOS || marcosBoot[m] != MARCO_PENDENTE) return;
+  marcosBoot[m] = millis();
+  if (m == BOOT_PRIMEIRO_TOQUE) {
+    LOG_INFO("Boot ate o primeiro toque aceito: %lu ms", (unsigned long)marcosBoot[m]);
+  }
+}
+
+uint32_t marcoBootMs(MarcoBoot m) {
+  return m < BOOT_MARCOS ? marcosBoot[m] : MARCO_PENDENTE;
+}
+
+void telemetriaRegistrarTarefa(const char *nome, TaskHandle_t tarefa) {
+  if (!tarefa || numTarefas >= TELEMETRIA_MAX_TAREFAS) return;
+  tarefas[numTarefas].nome   = nome;
+  tarefas[numTarefas].tarefa = tarefa;
+  numTarefas++;
+}
+
+// Tudo aqui é leitura de contadores já mantidos pelo IDF/FS: não varre heap nem arquivos
+static void escreverTelemetria(Serializador &s) {
+  unsigned filaOcupada = filaCartoes ? (unsigned)uxQueueMessagesWaiting(filaCartoes) : 0;
+
+  s.objeto();
+  s.natural("uptime_s", millis() / 1000);
+  s.natural("heap", ESP.getFreeHeap());
+  s.natural("heap_bloco", ESP.getMaxAllocHeap());
+  s.natural("heap_min", ESP.getMinFreeHeap());
+  s.objeto("pilha");
+  for (uint8_t i = 0; i < numTarefas; i++) {
+    s.natural(tarefas[i].nome, uxTaskGetStackHighWaterMark(tarefas[i].tarefa));
+  }
+  s.fechar();
+  s.natural("fila", filaOcupada);
+  s.natural("fila_pico", filaCartoesPico);
+  s.natural("fila_desc", filaCartoesDescartes);
+  s.natural("fs_usado", backendArquivos.bytesUsados());
+  s.natural("fs_total", backendArquivos.bytesTotais());
+  s.natural("mqtt_recon", mqttReconexoes);
+  s.natural("log_desc", logDescartes());
+  s.natural("estado_fora", uidsForaEstadoDerivado());
+  s.fechar();
+}
+
+static void escreverMarcosBoot(Serializador &s) {
+  s.objeto().texto("context", "boot");
+  for (uint8_t m = 0; m < BOOT_MARCOS; m++) {
+    if (marcosBoot[m] == MARCO_PENDENTE) s.nulo(NOMES_MARCOS[m]);
+    else                                 s.natural(NOMES_MARCOS[m], marcosBoot[m]);
+  }
+  s.natural("log_recuperados", registrosRecuperados());
+  s.natural("log_descartados", registrosDescartados());
+  s.fechar();
+}
+
+size_t montarTelemetria(char *buf, size_t cap, FormatoCarga formato) {
+  Serializador s(buf, cap, formato);
+  escreverTelemetria(s);
+  return s.ok() ? s.tamanho() : 0;
+}
+
+size_t montarMarcosBoot(char *buf, size_t cap, FormatoCarga formato) {
+  Serializador s(buf, cap, formato);
+  escreverMarcosBoot(s);
+  return s.ok() ? s.tamanho() : 0;
+}
+
+void listarTelemetriaSerial() {
+  char *buf = bufTelemetria;
+  if (montarTelemetria(buf, sizeof(bufTelemetria)) == 0) {
+    Serial.println("Telemetria nao coube no buffer.");
+    return;
+  }
+  Serial.print("Telemetria: ");
+  Serial.println(buf);
+  if (montarMarcosBoot(buf, sizeof(bufTelemetria))) {
+    Serial.print("Boot: ");
+    Serial.println(buf);
+  }
+}
+
+void publicarTelemetria() {
+  if (!mqttClient.connected()) return;
+
+  size_t cap = cargaMaxTelemetria();
+  FormatoCarga formato = formatoResposta(CANAL_METRICS);
+  Serializador s(bufTelemetria, cap, formato);
+  escreverTelemetria(s);
+  if (!s.ok()) {
+    LOG_AVISO("Telemetria nao coube no buffer, nao enviada.");
+    return;
+  }
+  s.publicar(MQTT_TOPIC_METRICS);   // msgpack vai para .../mp/metrics
+  ultimoEnvioMs = millis();
+  jaEnviou      = true;
+
+  if (!marcosBootEnviados && marcosBoot[BOOT_PRIMEIRO_TOQUE] != MARCO_PENDENTE) {
+    Serializador marcos(bufTelemetria, cap, formato);
+    escreverMarcosBoot(marcos);
+    marcosBootEnviados = marcos.publicar(MQTT_TOPIC_METRICS);
+  }
+}
+
+void publicarTelemetriaPeriodica() {
+  if (jaEnviou && millis() - ultimoEnvioMs < TELEMETRIA_INTERVALO_MS) return;
+  publicarTelemetria();
+}
@@ -0,0 +1,48 @@
+// Saúde do firmware em produção: heap, pilhas das tasks, filaCartoes, sistema de arquivos e MQTT.
+#pragma once
+
+#include <Arduino.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "serializador.h"
+
+#define TELEMETRIA_MAX_TAREFAS 4
+
+// Contadores alimentados pelo loop()/conectarMQTT()
+extern volatile uint32_t filaCartoesDescartes;   // UIDs perdidos com a fila cheia
+extern volatile uint32_t filaCartoesPico;        // maior ocupação vista ao enfileirar
+extern volatile uint32_t mqttReconexoes;         // conexões com o broker depois da primeira
+
+// Tasks cuja pilha livre mínima entra na telemetria (até TELEMETRIA_MAX_TAREFAS)
+void telemetriaRegistrarTarefa(const char *nome, TaskHandle_t tarefa);
+
+// Marcos do boot em ms desde o reset. O leitor e as tasks sobem primeiro;
+// WiFi, NTP e MQTT chegam depois, cada um no seu tempo.
+enum MarcoBoot {
+  BOOT_PRONTO,            // leitor RC522 e TaskProcessaCartoes de pé
+  BOOT_WIFI,
+  BOOT_NTP,
+  BOOT_MQTT,
+  BOOT_PRIMEIRO_TOQUE,    // primeiro cartão cadastrado reconhecido
+  BOOT_MARCOS
+};
+
+#define MARCO_PENDENTE 0xFFFFFFFFUL
+
+void     marcarBoot(MarcoBoot m);     // só a primeira vez conta
+uint32_t marcoBootMs(MarcoBoot m);    // MARCO_PENDENTE se ainda não aconteceu
+
+// JSON compacto (ou MessagePack) em 'buf' sem alocar; devolve o tamanho escrito (0 se não coube)
+size_t montarTelemetria(char *buf, size_t cap, FormatoCarga formato = FORMATO_JSON);
+
+// {"context":"boot","pronto_ms":...,"primeiro_toque_ms":...,"log_recuperados":...,
+//  "log_descartados":...} (null = marco pendente; log_* = recuperação do fim do log)
+size_t montarMarcosBoot(char *buf, size_t cap, FormatoCarga formato = FORMATO_JSON);
+
+void listarTelemetriaSerial();
+// Publica a telemetria e, uma vez por boot depois do primeiro toque, os marcos
+void publicarTelemetria();
+// Chamada a cada volta do loop(): só publica se TELEMETRIA_INTERVALO_MS já passou
+void publicarTelemetriaPeriodica();
@@ -0,0 +1,382 @@
+// Agregador de várias portarias (env:agregador). Roda no PC/servidor ao lado
+// do broker, não no ESP32.
+//
+//   pio run -e agregador && .pio/build/agregador/program [--broker 127.0.0.1] [--porta 1883] [--dias 35]
+//   .pio/build/agregador/program --replay capturas.txt
+//
+// Assina portaria/+/movimentacoes e junta os eventos de todas as portarias numa
+// linha do tempo só, em ordem de data/hora (empate: portaria, depois o offset
+// do registro no log dela). "portaria" + "offset" identificam o registro: o que
+// chega de novo (ao vivo e depois num get_history) entra uma vez. Da linha do
+// tempo sai a visão "dentro" do dia mais recente, com as portas somadas
+// (entrada por uma, saída por outra).
+//
+// Publica:
+//   agregador/movimentacoes  cada evento novo, já com "portaria"
+//   agregador/dentro         {"context":"inside","data":...,"total":N,
+//                             "itens":[{"uid":...,"count":N,"portaria":...}]}, retida
+// Recebe em agregador/comandos:
+//   {"cmd":"get_history"}       a linha do tempo inteira, em ordem, em agregador/movimentacoes
+//   {"cmd":"get_inside_today"}  agregador/dentro de novo
+//
+// Histórico: para cada portaria guarda o maior offset já recebido (a marca
+// d'água) e pede só o que veio depois, em portaria/<id>/comandos:
+//   {"cmd":"get_history","format":"json","apos":<offset>}   ("apos" omitido na primeira vez)
+// O pedido sai uma vez por conexão com o broker, para as portarias já
+// conhecidas e para cada uma que aparece em portaria/+/estado/hoje (retida,
+// então todas as ativas aparecem logo depois de assinar). Uma queda do broker
+// custa às portarias só as movimentações que o agregador perdeu.
+//
+// A linha do tempo guarda só os últimos --dias dias (padrão 35) antes do mais
+// recente; eventos mais antigos que isso são descartados na chegada. As
+// marcas d'água ficam mesmo depois da poda.
+// Só lê JSON: portaria/<id>/movimentacoes não pode estar em msgpack (set_format).
+//
+// --replay lê mensagens de um arquivo em vez do broker, uma por linha, como
+// "topico payload" ou ">> [topico] payload" (a saída do env native), e
+// imprime o que publicaria. Dá para testar juntando as saídas de dois
+// native com --id diferentes, sem broker.
+//
+// Precisa da libmosquitto (Debian/Ubuntu: apt install libmosquitto-dev).
+#include <mosquitto.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+
+static const char *TOPICO_MOV_PORTARIAS = "portaria/+/movimentacoes";
+static const char *TOPICO_HOJE_PORTARIAS = "portaria/+/estado/hoje";
+static const char *TOPICO_MOV           = "agregador/movimentacoes";
+static const char *TOPICO_DENTRO        = "agregador/dentro";
+static const char *TOPICO_CMD           = "agregador/comandos";
+
+struct Evento {
+  int32_t     dia;        // aaaammdd; 0 = sem data
+  std::string hora;       // "HH:MM:SS"
+  std::string portaria;
+  uint32_t    offset;
+  std::string data;       // "DD/MM/AAAA", como veio
+  std::string funcionario;
+  std::string usuario;
+  bool        entrada;
+
+  bool operator<(const Evento &o) const {
+    return std::tie(dia, hora, portaria, offset) < std::tie(o.dia, o.hora, o.portaria, o.offset);
+  }
+};
+
+using ChaveEvento = std::pair<std::string, uint32_t>;   // portaria, offset
+
+// Marca d'água do histórico de uma portaria
+struct Portaria {
+  bool     temOffset = false;
+  uint32_t maiorOffset = 0;
+  bool     pedido = false;     // get_history já enviado nesta conexão
+};
+
+static std::set<Evento>                linhaDoTempo;
+static std::map<ChaveEvento, Evento>   porChave;
+static std::map<std::string, Portaria> portarias;
+static std::string                     ultimoDentro;
+static int                             janelaDias = 35;
+
+// publicar(topico, payload, retida): mosquitto ou stdout (--replay)
+static std::function<void(const char *, const std::string &, bool)> publicar;
+
+// ======================= JSON plano =======================
+
+// Valor de "nome" num objeto plano: texto entre aspas ou número. false se não houver.
+static bool campoJson(const std::string &json, const char *nome, std::string &valor) {
+  std::string chave = std::string("\"") + nome + "\"";
+  size_t p = json.find(chave);
+  if (p == std::string::npos) return false;
+  p = json.find_first_not_of(" \t", p + chave.size());
+  if (p == std::string::npos || json[p] != ':') return false;
+  p = json.find_first_not_of(" \t", p + 1);
+  if (p == std::string::npos) return false;
+
+  if (json[p] == '"') {
+    size_t fim = json.find('"', p + 1);
+    if (fim == std::string::npos) return false;
+    valor = json.substr(p + 1, fim - p - 1);
+  } else {
+    size_t fim = json.find_first_of(",} \t", p);
+    valor = json.substr(p, fim == std::string::npos ? std::string::npos : fim - p);
+  }
+  return true;
+}
+
+static int32_t diaDeData(const std::string &data) {
+  int d, m, a;
+  if (sscanf(data.c_str(), "%d/%d/%d", &d, &m, &a) != 3) return 0;
+  return a * 10000 + m * 100 + d;
+}
+
+// aaaammdd -> dias desde 1970-01-01 (calendário gregoriano)
+static int32_t diaCivil(int32_t aaaammdd) {
+  int a = aaaammdd / 10000, m = (aaaammdd / 100) % 100, d = aaaammdd % 100;
+  a -= m <= 2;
+  int era = (a >= 0 ? a : a - 399) / 400;
+  int aoe = a - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = aoe * 365 + aoe / 4 - aoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static std::string jsonEvento(const Evento &e) {
+  std::string s = "{";
+  s += "\"portaria\":\""    + e.portaria + "\",";
+  s += "\"offset\":"        + std::to_string(e.offset) + ",";
+  s += "\"funcionario\":\"" + e.funcionario + "\",";
+  s += "\"usuario\":\""     + e.usuario + "\",";
+  s += std::string("\"acao\":\"") + (e.entrada ? "entrada" : "saida") + "\",";
+  s += "\"data\":\""        + e.data + "\",";
+  s += "\"hora\":\""        + e.hora + "\"";
+  s += "}";
+  return s;
+}
+
+// ======================= Linha do tempo =======================
+
+// Quem está dentro no dia mais recente da linha do tempo. As portas contam
+// juntas e na ordem da linha do tempo, com a regra da portaria: entrada soma,
+// saída desconta se houver o que descontar.
+static void publicarDentro(bool mesmoIgual) {
+  int32_t dia = 0;
+  std::string data;
+  if (!linhaDoTempo.empty()) {
+    dia  = linhaDoTempo.rbegin()->dia;
+    data = linhaDoTempo.rbegin()->data;
+  }
+
+  struct Dentro { int count; std::string portaria; };
+  std::map<std::string, Dentro> dentro;
+  if (dia > 0) {
+    Evento inicio{ dia, "", "", 0, "", "", "", false };
+    for (auto it = linhaDoTempo.lower_bound(inicio); it != linhaDoTempo.end(); ++it) {
+      Dentro &d = dentro[it->usuario];
+      if (it->entrada)      d.count++;
+      else if (d.count > 0) d.count--;
+      d.portaria = it->portaria;
+    }
+  }
+
+  int total = 0;
+  std::string itens;
+  for (const auto &kv : dentro) {
+    if (kv.second.count <= 0) continue;
+    if (!itens.empty()) itens += ",";
+    itens += "{\"uid\":\"" + kv.first + "\",\"count\":" + std::to_string(kv.second.count) +
+             ",\"portaria\":\"" + kv.second.portaria + "\"}";
+    total += kv.second.count;
+  }
+  std::string payload = "{\"context\":\"inside\",\"data\":\"" + data + "\",\"total\":" +
+                        std::to_string(total) + ",\"itens\":[" + itens + "]}";
+  if (!mesmoIgual && payload == ultimoDentro) return;
+  ultimoDentro = payload;
+  publicar(TOPICO_DENTRO, payload, true);
+}
+
+// O dia (aaaammdd) ficou mais de --dias antes do último da linha do tempo
+static bool foraDaJanela(int32_t dia) {
+  if (linhaDoTempo.empty() || dia == 0) return false;
+  int32_t ultimo = linhaDoTempo.rbegin()->dia;
+  return ultimo > 0 && diaCivil(ultimo) - diaCivil(dia) > janelaDias;
+}
+
+// Tira do começo da linha do tempo o que saiu da janela
+static void podarLinhaDoTempo() {
+  while (!linhaDoTempo.empty() && foraDaJanela(linhaDoTempo.begin()->dia)) {
+    const Evento &e = *linhaDoTempo.begin();
+    porChave.erase(ChaveEvento(e.portaria, e.offset));
+    linhaDoTempo.erase(linhaDoTempo.begin());
+  }
+}
+
+static void pedirHistorico(const std::string &id) {
+  Portaria &p = portarias[id];
+  if (p.pedido) return;
+  p.pedido = true;
+  std::string pedido = "{\"cmd\":\"get_history\",\"format\":\"json\"";
+  if (p.temOffset) pedido += ",\"apos\":" + std::to_string(p.maiorOffset);
+  pedido += "}";
+  publicar(("portaria/" + id + "/comandos").c_str(), pedido, false);
+}
+
+// Uma movimentação de portaria/<id>/movimentacoes. false se repetida ou inválida.
+static bool receberMovimentacao(const std::string &topico, const std::string &payload) {
+  Evento e;
+  std::string acao, offset;
+  if (!campoJson(payload, "usuario", e.usuario) || !campoJson(payload, "acao", acao) ||
+      !campoJson(payload, "data", e.data) || !campoJson(payload, "hora", e.hora)) {
+    fprintf(stderr, "movimentacao sem os campos esperados em %s: %s\n", topico.c_str(), payload.c_str());
+    return false;
+  }
+  campoJson(payload, "funcionario", e.funcionario);
+  if (!campoJson(payload, "portaria", e.portaria)) {
+    // firmware antigo: o id só no tópico
+    size_t ini = topico.find('/') + 1, fim = topico.rfind('/');
+    e.portaria = (fim > ini) ? topico.substr(ini, fim - ini) : topico;
+  }
+  e.offset  = campoJson(payload, "offset", offset) ? (uint32_t)strtoul(offset.c_str(), nullptr, 10) : 0;
+  e.entrada = (acao == "entrada" || acao == "recebeu");
+  e.dia     = diaDeData(e.data);
+
+  Portaria &p = portarias[e.portaria];
+  if (!p.temOffset || e.offset > p.maiorOffset) p.maiorOffset = e.offset;
+  p.temOffset = true;
+  if (foraDaJanela(e.dia)) return false;
+
+  ChaveEvento chave(e.portaria, e.offset);
+  auto it = porChave.find(chave);
+  if (it != porChave.end()) {
+    const Evento &v = it->second;
+    bool igual = v.dia == e.dia && v.hora == e.hora && v.usuario == e.usuario &&
+                 v.funcionario == e.funcionario && v.entrada == e.entrada;
+    if (igual) return false;
+    // mesmo offset com outro conteúdo: o log daquela portaria recomeçou
+    linhaDoTempo.erase(v);
+  }
+  porChave[chave] = e;
+  linhaDoTempo.insert(e);
+  publicar(TOPICO_MOV, jsonEvento(e), false);
+  podarLinhaDoTempo();
+  return true;
+}
+
+static void receberComando(const std::string &payload) {
+  std::string cmd;
+  if (!campoJson(payload, "cmd", cmd)) return;
+  if (cmd == "get_history") {
+    for (const Evento &e : linhaDoTempo) publicar(TOPICO_MOV, jsonEvento(e), false);
+  } else if (cmd == "get_inside_today") {
+    publicarDentro(true);
+  }
+}
+
+// "portaria/<id><sufixo>" -> id; vazio se o tópico for outro
+static std::string portariaDoTopico(const std::string &t, const std::string &sufixo) {
+  const std::string prefixo = "portaria/";
+  if (t.size() <= prefixo.size() + sufixo.size() || t.compare(0, prefixo.size(), prefixo) != 0 ||
+      t.compare(t.size() - sufixo.size(), sufixo.size(), sufixo) != 0) {
+    return "";
+  }
+  std::string id = t.substr(prefixo.size(), t.size() - prefixo.size() - sufixo.size());
+  return id.find('/') == std::string::npos ? id : "";
+}
+
+static void receber(const std::string &topico, const std::string &payload) {
+  if (topico == TOPICO_CMD) {
+    receberComando(payload);
+  } else if (!portariaDoTopico(topico, "/movimentacoes").empty()) {
+    if (receberMovimentacao(topico, payload)) publicarDentro(false);
+  } else {
+    std::string id = portariaDoTopico(topico, "/estado/hoje");
+    if (!id.empty() && !payload.empty()) pedirHistorico(id);
+  }
+}
+
+// ======================= Broker =======================
+
+static void aoConectar(struct mosquitto *m, void *, int rc) {
+  if (rc != 0) {
+    fprintf(stderr, "conexao recusada pelo broker: %s\n", mosquitto_connack_string(rc));
+    return;
+  }
+  mosquitto_subscribe(m, nullptr, TOPICO_MOV_PORTARIAS, 1);
+  mosquitto_subscribe(m, nullptr, TOPICO_HOJE_PORTARIAS, 1);
+  mosquitto_subscribe(m, nullptr, TOPICO_CMD, 1);
+  // conexão nova: cada portaria conhecida recebe um pedido (só o que falta)
+  for (auto &kv : portarias) kv.second.pedido = false;
+  for (auto &kv : portarias) pedirHistorico(kv.first);
+  fprintf(stderr, "conectado; %zu evento(s) na linha do tempo, %zu portaria(s)\n",
+          linhaDoTempo.size(), portarias.size());
+}
+
+static void aoReceber(struct mosquitto *, void *, const struct mosquitto_message *msg) {
+  std::string payload((const char *)msg->payload, msg->payloadlen);
+  receber(msg->topic, payload);
+}
+
+static int rodarNoBroker(const char *broker, int porta) {
+  mosquitto_lib_init();
+  struct mosquitto *m = mosquitto_new("portaria-agregador", true, nullptr);
+  if (!m) {
+    fprintf(stderr, "mosquitto_new falhou\n");
+    return 1;
+  }
+  mosquitto_connect_callback_set(m, aoConectar);
+  mosquitto_message_callback_set(m, aoReceber);
+  publicar = [m](const char *topico, const std::string &payload, bool retida) {
+    mosquitto_publish(m, nullptr, topico, (int)payload.size(), payload.data(), 1, retida);
+  };
+
+  if (mosquitto_connect(m, broker, porta, 60) != MOSQ_ERR_SUCCESS) {
+    fprintf(stderr, "nao foi possivel conectar em %s:%d\n", broker, porta);
+    return 1;
+  }
+  int rc = mosquitto_loop_forever(m, -1, 1);   // reconecta sozinho
+  mosquitto_destroy(m);
+  mosquitto_lib_cleanup();
+  return rc == MOSQ_ERR_SUCCESS ? 0 : 1;
+}
+
+// ======================= Replay =======================
+
+static int rodarReplay(const char *arquivo) {
+  FILE *f = strcmp(arquivo, "-") == 0 ? stdin : fopen(arquivo, "r");
+  if (!f) {
+    fprintf(stderr, "nao foi possivel abrir %s\n", arquivo);
+    return 1;
+  }
+  publicar = [](const char *topico, const std::string &payload, bool retida) {
+    printf(">> [%s]%s %s\n", topico, retida ? " (retida)" : "", payload.c_str());
+  };
+
+  char buf[2048];
+  while (fgets(buf, sizeof(buf), f)) {
+    std::string linha(buf);
+    while (!linha.empty() && (linha.back() == '\n' || linha.back() == '\r')) linha.pop_back();
+
+    std::string topico, payload;
+    if (linha.compare(0, 4, ">> [") == 0) {
+      size_t fim = linha.find(']');
+      if (fim == std::string::npos) continue;
+      topico = linha.substr(4, fim - 4);
+      size_t ini = linha.find('{', fim);
+      payload = ini == std::string::npos ? "" : linha.substr(ini);   // vazia: retida apagada
+    } else {
+      size_t esp = linha.find(' ');
+      if (esp == std::string::npos) continue;
+      topico  = linha.substr(0, esp);
+      payload = linha.substr(esp + 1);
+    }
+    receber(topico, payload);
+  }
+  if (f != stdin) fclose(f);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *broker = "127.0.0.1";
+  int         porta  = 1883;
+  const char *replay = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--broker") == 0 && i + 1 < argc)      broker = argv[++i];
+    else if (strcmp(argv[i], "--porta") == 0 && i + 1 < argc)  porta  = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replay = argv[++i];
+    else if (strcmp(argv[i], "--dias") == 0 && i + 1 < argc)   janelaDias = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "uso: %s [--broker host] [--porta n] [--dias n] [--replay arquivo|-]\n", argv[0]);
+      return 1;
+    }
+  }
+  return replay ? rodarReplay(replay) : rodarNoBroker(broker, porta);
+}
@@ -0,0 +1,458 @@
+// Benchmarks do núcleo da portaria no PC (env:bench).
+//
+//   pio run -e bench && .pio/build/bench/program [--rapido] [--fs dir] > resultados.jsonl
+//
+// Gera cadastros sintéticos (100 a 10k UIDs) e logs de movimentação (1k a 1M
+// linhas, vários meses) e mede a montagem da imagem do cadastro,
+// isRegistered() (busca binária na imagem mapeada), a recusa de cartões de
+// fora pelo filtro de Bloom ("recusar_desconhecido"), parseMovLine() (e
+// "parseMovLine_string", o parser com String de antes dos trechos),
+// listarUsuariosDentroHoje(), publishMovHistoryToMQTT() e o boot do estado
+// derivado com checkpoint ("restaurar_checkpoint") e sem ("restaurar_log").
+// "serializar_mov_*" compara o payload de uma movimentação montado com String
+// (como era) e com o Serializador em JSON e MessagePack; "bytes" é o tamanho.
+//
+// Saída: uma linha JSON por medição no stdout, por exemplo
+//   {"op":"isRegistered","cadastro":1000,"log":0,"n":500,"ops_s":...,
+//    "p50_us":...,"p99_us":...,"heap_pico_bytes":...}
+// Mensagens de progresso vão para o stderr. A Serial da portaria fica muda.
+//
+// heap_pico_bytes é o maior volume de memória alocada via new/delete (String,
+// buffers) acima do que já estava alocado antes da medição.
+#include <Arduino.h>
+#include <MFRC522v2.h>
+#include <PubSubClient.h>
+#include <SPIFFS.h>
+#include <esp_partition.h>
+
+#include <relogio_fake.h>
+#include <portaria.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+MFRC522      mfrc522;
+PubSubClient mqttClient;
+
+// ---------------- Contagem de heap (new/delete) ----------------
+
+static size_t heapAtual = 0;
+static size_t heapPico  = 0;
+
+// cada bloco leva o tamanho num cabeçalho que preserva o alinhamento do malloc
+static const size_t CABECALHO = alignof(std::max_align_t);
+
+__attribute__((noinline)) void *operator new(size_t n) {
+  char *p = (char *)malloc(n + CABECALHO);
+  if (!p) throw std::bad_alloc();
+  *(size_t *)p = n;
+  heapAtual += n;
+  if (heapAtual > heapPico) heapPico = heapAtual;
+  return p + CABECALHO;
+}
+
+void *operator new[](size_t n) { return operator new(n); }
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  if (!p) return;
+  char *h = (char *)p - CABECALHO;
+  heapAtual -= *(size_t *)h;
+  free(h);
+}
+
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+// ---------------- Medição ----------------
+
+typedef std::chrono::steady_clock Relogio;
+
+struct Medicao {
+  std::vector<double> us;       // latência de cada operação
+  size_t              heapBase = 0;
+  double              totalUs  = 0;
+
+  void iniciar() {
+    us.clear();
+    us.reserve(4096);
+    heapBase = heapAtual;
+    heapPico = heapAtual;
+    totalUs  = 0;
+  }
+};
+
+template <typename Fn>
+static void medir(Medicao &m, Fn fn) {
+  Relogio::time_point t0 = Relogio::now();
+  fn();
+  double d = std::chrono::duration<double, std::micro>(Relogio::now() - t0).count();
+  m.us.push_back(d);
+  m.totalUs += d;
+}
+
+static double percentil(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(p * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+// 'porAmostra' > 1 quando cada amostra cronometrada cobre um lote de operações
+// 'bytes' > 0 acrescenta o tamanho do que foi produzido (payloads)
+static void reportar(const char *op, size_t cadastro, size_t log, const Medicao &m,
+                     size_t porAmostra = 1, size_t bytes = 0) {
+  size_t n    = m.us.size() * porAmostra;
+  double opsS = m.totalUs > 0 ? n * 1e6 / m.totalUs : 0;
+  printf("{\"op\":\"%s\",\"cadastro\":%zu,\"log\":%zu,\"n\":%zu,"
+         "\"ops_s\":%.1f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"heap_pico_bytes\":%zu",
+         op, cadastro, log, n, opsS,
+         percentil(m.us, 0.50) / porAmostra, percentil(m.us, 0.99) / porAmostra,
+         heapPico - m.heapBase);
+  if (bytes) printf(",\"bytes\":%zu", bytes);
+  printf("}\n");
+  fflush(stdout);
+}
+
+// ---------------- Dados sintéticos ----------------
+
+static uint32_t semente = 12345;
+static uint32_t aleatorio() {           // xorshift32: mesmos dados em toda execução
+  semente ^= semente << 13;
+  semente ^= semente >> 17;
+  semente ^= semente << 5;
+  return semente;
+}
+
+static std::string uidSintetico(uint32_t i, char prefixo) {
+  char buf[UID_MAX_LEN + 1];
+  snprintf(buf, sizeof(buf), "%c%07x", prefixo, (unsigned)(i * 2654435761u) & 0x0fffffffu);
+  return buf;
+}
+
+static void gerarCadastro(const char *arquivo, size_t n, char prefixo, std::vector<std::string> &uids) {
+  uids.clear();
+  File f = abrirArquivo(arquivo, FILE_WRITE);
+  for (size_t i = 0; i < n; i++) {
+    uids.push_back(uidSintetico((uint32_t)i, prefixo));
+    f.print(uids.back().c_str());
+    f.print("\n");
+  }
+  f.close();
+}
+
+static void formatarData(int32_t diaNum, char *buf, size_t cap) {
+  time_t t = (time_t)diaNum * 86400;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(buf, cap, "%d/%m/%Y", &tm);
+}
+
+// Log com 'linhas' movimentações espalhadas por vários dias terminando em 'ultimoDia':
+// cada visita é um par recebeu/liberou; a última parte do último dia fica em aberto.
+static void gerarLog(size_t linhas, int32_t ultimoDia,
+                     const std::vector<std::string> &usuarios,
+                     const std::vector<std::string> &funcionarios) {
+  int32_t dias = (int32_t)std::min<size_t>(180, std::max<size_t>(1, linhas / 50));
+  size_t  porDia = std::max<size_t>(2, linhas / dias);
+
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_WRITE);
+  char linha[128], data[11];
+  size_t escritas = 0;
+  for (int32_t d = ultimoDia - dias + 1; d <= ultimoDia && escritas < linhas; d++) {
+    formatarData(d, data, sizeof(data));
+    size_t nesteDia = (d == ultimoDia) ? linhas - escritas : std::min(porDia, linhas - escritas);
+    for (size_t k = 0; k < nesteDia; k++) {
+      const std::string &usu = usuarios[aleatorio() % usuarios.size()];
+      const std::string &fun = funcionarios[aleatorio() % funcionarios.size()];
+      bool entrada = (k % 2 == 0) || (d == ultimoDia && k > nesteDia / 2);
+      uint32_t seg = 7 * 3600 + (uint32_t)(k * 36000 / nesteDia);
+      int n = snprintf(linha, sizeof(linha), "-%s- %s -%s- às -%02u:%02u:%02u- do dia -%s-",
+                       fun.c_str(), entrada ? "recebeu" : "liberou", usu.c_str(),
+                       seg / 3600, (seg / 60) % 60, seg % 60, data);
+      montarMolduraRegistro(linha, n, linha + n);
+      f.print(linha);
+      f.print("\n");
+      escritas++;
+    }
+  }
+  f.close();
+}
+
+// ---------------- Benchmarks ----------------
+
+static void benchIsRegistered(size_t tamCadastro, size_t n) {
+  std::vector<std::string> usuarios;
+  gerarCadastro(CARDS_FILE, tamCadastro, 'a', usuarios);
+
+  Medicao m;
+  m.iniciar();
+  medir(m, [] { reconstruirImagemCadastro(); });   // os arquivos foram trocados por fora
+  reportar("montar_imagem_cadastro", tamCadastro, 0, m);
+
+  std::vector<String> consultas;
+  for (size_t i = 0; i < n; i++) {
+    if (i % 2 == 0) consultas.push_back(String(usuarios[aleatorio() % usuarios.size()].c_str()));
+    else            consultas.push_back(String(uidSintetico(aleatorio(), 'f').c_str()));  // ausente
+  }
+
+  m.iniciar();
+  for (size_t i = 0; i < n; i++) {
+    medir(m, [&] { isRegistered(CARDS_FILE, consultas[i]); });
+  }
+  reportar("isRegistered", tamCadastro, 0, m);
+
+  // Cartões de fora: param no filtro de Bloom; os falsos positivos vão para a busca
+  std::vector<String> desconhecidos;
+  for (size_t i = 0; i < n; i++) desconhecidos.push_back(String(uidSintetico(aleatorio(), 'f').c_str()));
+  zerarEstatisticasFiltro();
+  m.iniciar();
+  for (size_t i = 0; i < n; i++) {
+    medir(m, [&] { papeisDoUid(desconhecidos[i]); });
+  }
+  reportar("recusar_desconhecido", tamCadastro, 0, m);
+  EstatisticasFiltro f;
+  estatisticasFiltroCadastro(f);
+  fprintf(stderr, "  filtro: %lu bits, k=%u: %lu de %lu recusados, %lu falso(s) positivo(s)\n",
+          (unsigned long)f.bits, (unsigned)f.hashes, (unsigned long)f.recusados,
+          (unsigned long)f.consultas, (unsigned long)f.falsosPositivos);
+}
+
+// parseMovLine() como era antes dos trechos: cópia da linha e um substring()
+// por campo, para comparar com o de movimentacoes.cpp nas mesmas linhas
+static bool parseMovLineString(const String &line, String &uidFunc, String &uidUser,
+                               String &hora, String &data, String &acao) {
+  String s = line;
+  s.trim();
+  if (!s.length()) return false;
+
+  int firstDash = s.indexOf('-');
+  if (firstDash != 0) return false;
+  int secondDash = s.indexOf('-', firstDash + 1);
+  if (secondDash < 0) return false;
+  uidFunc = s.substring(firstDash + 1, secondDash);
+  uidFunc.trim();
+
+  const String padRecebeu = " recebeu -";
+  const String padLiberou = " liberou -";
+  int idxTok = s.indexOf(padRecebeu, secondDash);
+  int lenTok = padRecebeu.length();
+  if (idxTok >= 0) {
+    acao = "recebeu";
+  } else {
+    idxTok = s.indexOf(padLiberou, secondDash);
+    lenTok = padLiberou.length();
+    if (idxTok < 0) return false;
+    acao = "liberou";
+  }
+
+  int uidUserStart = idxTok + lenTok;
+  int uidUserEnd   = s.indexOf('-', uidUserStart);
+  if (uidUserEnd < 0) return false;
+  uidUser = s.substring(uidUserStart, uidUserEnd);
+  uidUser.trim();
+
+  const String padHora = " às -";
+  int idxHora = s.indexOf(padHora, uidUserEnd);
+  if (idxHora < 0) return false;
+  int horaStart = idxHora + padHora.length();
+  int horaEnd   = s.indexOf('-', horaStart);
+  if (horaEnd < 0) return false;
+  hora = s.substring(horaStart, horaEnd);
+  hora.trim();
+
+  const String padData = " do dia -";
+  int idxData = s.indexOf(padData, horaEnd);
+  if (idxData < 0) return false;
+  int dataStart = idxData + padData.length();
+  int dataEnd   = s.indexOf('-', dataStart);
+  if (dataEnd < 0) return false;
+  data = s.substring(dataStart, dataEnd);
+  data.trim();
+  return true;
+}
+
+static void benchParseMovLine(size_t tamLog) {
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  std::vector<std::string> linhas;
+  String l;
+  while (f.available() && linhas.size() < 20000) {
+    l = f.readStringUntil('\n');
+    linhas.push_back(l.c_str());
+  }
+  f.close();
+
+  // lotes de 100 linhas: uma linha sozinha fica abaixo da resolução do relógio
+  const size_t LOTE = 100;
+  Medicao m;
+  m.iniciar();
+  MovLinha mov;
+  size_t ok = 0;
+  for (size_t i = 0; i + LOTE <= linhas.size(); i += LOTE) {
+    medir(m, [&] {
+      for (size_t k = i; k < i + LOTE; k++) ok += parseMovLine(linhas[k].data(), linhas[k].size(), mov);
+    });
+  }
+  reportar("parseMovLine", 0, tamLog, m, LOTE);
+  if (ok == 0) fprintf(stderr, "aviso: nenhuma linha reconhecida por parseMovLine\n");
+
+  std::vector<String> linhasString;
+  for (const std::string &s : linhas) linhasString.push_back(String(s.c_str()));
+  String func, user, hora, data, acao;
+  size_t okString = 0;
+  m.iniciar();
+  for (size_t i = 0; i + LOTE <= linhasString.size(); i += LOTE) {
+    medir(m, [&] {
+      for (size_t k = i; k < i + LOTE; k++) okString += parseMovLineString(linhasString[k], func, user, hora, data, acao);
+    });
+  }
+  reportar("parseMovLine_string", 0, tamLog, m, LOTE);
+  if (okString != ok) fprintf(stderr, "aviso: parseMovLine_string reconheceu %zu linhas, parseMovLine %zu\n", okString, ok);
+}
+
+static void benchRelatorios(size_t tamLog, size_t repDentro, size_t repHistorico) {
+  Medicao m;
+  m.iniciar();
+  for (size_t i = 0; i < repDentro; i++) {
+    medir(m, [] { listarUsuariosDentroHoje(); });
+  }
+  reportar("listarUsuariosDentroHoje", 1000, tamLog, m);
+
+  m.iniciar();
+  for (size_t i = 0; i < repHistorico; i++) {
+    // a primeira fatia sai aqui, as outras pela filaComandos
+    medir(m, [] { publishMovHistoryToMQTT(); while (processarProximoComando()) {} });
+  }
+  reportar("publishMovHistoryToMQTT", 1000, tamLog, m);
+}
+
+// Payload de uma movimentação ao vivo: concatenação de String (como era antes
+// do Serializador) contra o Serializador, em JSON e em MessagePack
+static void benchSerializar(size_t n) {
+  const String func = "e1a2b3c4", user = "a5d6e7f8", acao = "entrada", data = "17/10/2025", hora = "17:05:09";
+  const size_t offset = 123456;
+  const size_t LOTE   = 100;
+  size_t bytes = 0;
+  Medicao m;
+
+  m.iniciar();
+  for (size_t i = 0; i < n; i += LOTE) {
+    medir(m, [&] {
+      for (size_t k = 0; k < LOTE; k++) {
+        String payload = "{";
+        payload += "\"portaria\":\"";    payload += PORTARIA_ID; payload += "\",";
+        payload += "\"offset\":"          + String((unsigned long)offset) + ",";
+        payload += "\"funcionario\":\"" + func + "\",";
+        payload += "\"usuario\":\""     + user + "\",";
+        payload += "\"acao\":\""        + acao + "\",";
+        payload += "\"data\":\""        + data + "\",";
+        payload += "\"hora\":\""        + hora + "\"";
+        payload += "}";
+        bytes = payload.length();
+      }
+    });
+  }
+  reportar("serializar_mov_string", 0, 0, m, LOTE, bytes);
+
+  const FormatoCarga formatos[] = { FORMATO_JSON, FORMATO_MSGPACK };
+  const char *nomes[] = { "serializar_mov_json", "serializar_mov_msgpack" };
+  Trecho tf = { func.c_str(), func.length() }, tu = { user.c_str(), user.length() };
+  Trecho td = { data.c_str(), data.length() }, th = { hora.c_str(), hora.length() };
+  for (int f = 0; f < 2; f++) {
+    m.iniciar();
+    for (size_t i = 0; i < n; i += LOTE) {
+      medir(m, [&] {
+        for (size_t k = 0; k < LOTE; k++) {
+          char buf[192];
+          Serializador s(buf, sizeof(buf), formatos[f]);
+          serializarMovimentacao(s, offset, tf, tu, acao.c_str(), td, th);
+          bytes = s.tamanho();
+        }
+      });
+    }
+    reportar(nomes[f], 0, 0, m, LOTE, bytes);
+  }
+}
+
+// Boot com o checkpoint em dia (só o tail depois dele) contra reconstruir as
+// semanas de presença do log: o primeiro não deve crescer com o log.
+static void benchRestaurar(size_t tamLog, size_t rep) {
+  Medicao m;
+  removerArquivo(CHECKPOINT_FILE);
+  restaurarEstadoDerivado();   // grava o checkpoint
+
+  m.iniciar();
+  for (size_t i = 0; i < rep; i++) {
+    medir(m, [] { restaurarEstadoDerivado(); });
+  }
+  reportar("restaurar_checkpoint", 1000, tamLog, m);
+
+  m.iniciar();
+  for (size_t i = 0; i < rep; i++) {
+    removerArquivo(CHECKPOINT_FILE);
+    medir(m, [] { restaurarEstadoDerivado(); });
+  }
+  reportar("restaurar_log", 1000, tamLog, m);
+}
+
+int main(int argc, char **argv) {
+  bool rapido       = false;
+  const char *dirFs = "fs_nativo/bench";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rapido") == 0)                  rapido = true;
+    else if (strcmp(argv[i], "--fs") == 0 && i + 1 < argc) dirFs = argv[++i];
+  }
+
+  backendArquivos.fs.definirRaiz(dirFs);
+  particaoDefinirArquivo(IMAGEM_PARTICAO, (std::string(dirFs) + "-cadastro.img").c_str());
+#ifndef PORTARIA_FS_SPIFFS
+  SPIFFS.definirRaiz((std::string(dirFs) + "-spiffs").c_str());   // sem partição antiga: nada a migrar
+#endif
+  Serial.silenciar(true);
+  backendArquivos.montar(true);
+  backendArquivos.formatar();
+  inicializarPortaria();
+  mqttClient.definirConectado(true);
+
+  const int32_t ultimoDia = diasDesdeEpoch(2025, 10, 17);   // sexta-feira
+  relogioDefinirEpochLocal((int64_t)ultimoDia * 86400 + 17 * 3600);
+
+  std::vector<size_t> cadastros = { 100, 1000, 10000 };
+  std::vector<size_t> logs      = { 1000, 10000, 100000, 1000000 };
+  if (rapido) {
+    cadastros = { 100, 1000 };
+    logs      = { 1000, 10000 };
+  }
+
+  for (size_t c : cadastros) {
+    fprintf(stderr, "isRegistered: cadastro de %zu UIDs\n", c);
+    benchIsRegistered(c, c >= 10000 ? 100 : 500);
+  }
+
+  fprintf(stderr, "serializar: payload de movimentacao\n");
+  benchSerializar(rapido ? 10000 : 100000);
+
+  std::vector<std::string> usuarios, funcionarios;
+  gerarCadastro(CARDS_FILE, 1000, 'a', usuarios);
+  gerarCadastro(ADMINS_FILE, 50, 'e', funcionarios);
+  reconstruirImagemCadastro();
+
+  for (size_t n : logs) {
+    fprintf(stderr, "log de %zu linhas: gerando...\n", n);
+    gerarLog(n, ultimoDia, usuarios, funcionarios);
+    reconstruirIndiceMovimentacoes();
+    benchRestaurar(n, n >= 1000000 ? 3 : 10);   // também deixa o estado derivado do log novo
+
+    benchParseMovLine(n);
+    benchRelatorios(n, n >= 1000000 ? 5 : 20, n >= 100000 ? 1 : 5);
+  }
+
+  return 0;
+}
@@ -0,0 +1,261 @@
+// Portaria no PC (env:native): roda o núcleo de lib/portaria com os fakes de
+// lib/fakes_nativo, lendo um roteiro de comandos do stdin ou de um arquivo.
+//
+//   .pio/build/native/program [-q] [--fs <dir>] [--fs-spiffs <dir>] [--id <portaria>] [--limpar]
+//                             [--http <porta>] [--flash-abrir-us <us>] [--flash-kb-us <us>]
+//                             [roteiro.txt]
+//
+// --fs é o diretório da partição do backend (LittleFS, padrão
+// fs_nativo/littlefs); --fs-spiffs é o da partição SPIFFS antiga, migrada no
+// boot (padrão fs_nativo/spiffs, ou "<dir do --fs>-spiffs" se houver --fs).
+// A partição "cadastro" é o arquivo fs_nativo/cadastro.img (ou
+// "<dir do --fs>-cadastro.img"), mapeado com mmap(). --id troca o PORTARIA_ID
+// (padrão: do MAC de mentira, 000001), para simular várias portarias.
+// --http abre a exportação do log (exportacao_http.h) num socket de verdade
+// nessa porta; o roteiro precisa de um "http <s>" para atender:
+//   program --http 8080 roteiro.txt &   (roteiro terminando em "http 30")
+//   curl http://127.0.0.1:8080/movimentacoes.ndjson
+// --flash-abrir-us/--flash-kb-us: tempo virtual de cada open() e de cada KB
+// gravado/lido, como no env sim (padrão 0: a flash não custa nada e o "B"
+// mede 0 us).
+//
+// Comandos do roteiro (um por linha, '#' = comentário):
+//   relogio dd/mm/aaaa hh:mm:ss   acerta o relógio (antes disso = sem NTP)
+//   avancar <ms>                  avança o tempo virtual
+//   aproximar <uid>               coloca o cartão no leitor, sem processar
+//   cartao <uid>                  aproxima e roda um passo do loop + TaskProcessaCartoes
+//   serial <texto>                digita <texto> + '\n' na Serial (ex.: "serial e", "serial d a1b2")
+//   digitar <texto>               digita <texto> sem ENTER (a linha continua no próximo passo)
+//   mqtt <json>                   entrega <json> em portaria/<id>/comandos
+//   mqtt_todas <json>             entrega <json> em portaria/comandos (todas as portarias)
+//   mqtt_on | mqtt_off            liga/desliga a conexão com o broker
+//   http <segundos>               roda o loop por <segundos> de tempo real (com --http)
+//   sair
+//
+// Cada publicação MQTT sai no stdout como ">> [topico] payload"; MessagePack
+// sai como ">> [topico] (msgpack N B) <o mesmo em JSON>".
+// Com -q a Serial é descartada e só as publicações aparecem.
+#include <Arduino.h>
+#include <MFRC522v2.h>
+#include <PubSubClient.h>
+#include <SPIFFS.h>
+#include <esp_partition.h>
+
+#include <relogio_fake.h>
+#include <portaria.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+MFRC522      mfrc522;
+PubSubClient mqttClient;
+
+// MessagePack (só o que o Serializador escreve) de volta para JSON, para ler no terminal
+static bool msgpackParaJson(const uint8_t *&p, const uint8_t *fim, std::string &out) {
+  auto be = [&](int n, uint64_t &v) {
+    if (fim - p < n) return false;
+    v = 0;
+    for (int i = 0; i < n; i++) v = (v << 8) | *p++;
+    return true;
+  };
+  if (p >= fim) return false;
+  uint8_t  b = *p++;
+  uint64_t n = 0;
+  int      tipo;   // 0 = map, 1 = lista, 2 = texto
+  if (b <= 0x7f) { out += std::to_string(b); return true; }
+  if (b >= 0xe0) { out += std::to_string((int8_t)b); return true; }
+  if ((b & 0xf0) == 0x80)      { tipo = 0; n = b & 0x0f; }
+  else if ((b & 0xf0) == 0x90) { tipo = 1; n = b & 0x0f; }
+  else if ((b & 0xe0) == 0xa0) { tipo = 2; n = b & 0x1f; }
+  else {
+    switch (b) {
+      case 0xc0: out += "null";  return true;
+      case 0xc2: out += "false"; return true;
+      case 0xc3: out += "true";  return true;
+      case 0xcc: case 0xcd: case 0xce: case 0xcf:
+        if (!be(1 << (b - 0xcc), n)) return false;
+        out += std::to_string(n);
+        return true;
+      case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+        int bytes = 1 << (b - 0xd0);
+        if (!be(bytes, n)) return false;
+        int64_t v = (int64_t)(n << (64 - 8 * bytes)) >> (64 - 8 * bytes);
+        out += std::to_string(v);
+        return true;
+      }
+      case 0xd9: tipo = 2; if (!be(1, n)) return false; break;
+      case 0xda: tipo = 2; if (!be(2, n)) return false; break;
+      case 0xdc: tipo = 1; if (!be(2, n)) return false; break;
+      case 0xde: tipo = 0; if (!be(2, n)) return false; break;
+      default: return false;
+    }
+  }
+  if (tipo == 2) {
+    if ((uint64_t)(fim - p) < n) return false;
+    out += '"';
+    out.append((const char *)p, n);
+    out += '"';
+    p += n;
+    return true;
+  }
+  out += tipo == 0 ? '{' : '[';
+  for (uint64_t i = 0; i < n; i++) {
+    if (i) out += ',';
+    if (tipo == 0) {
+      if (!msgpackParaJson(p, fim, out)) return false;
+      out += ':';
+    }
+    if (!msgpackParaJson(p, fim, out)) return false;
+  }
+  out += tipo == 0 ? '}' : ']';
+  return true;
+}
+
+static void imprimirPublicacao(const MensagemMqtt &msg) {
+  const uint8_t *p   = (const uint8_t *)msg.payload.data();
+  const uint8_t *fim = p + msg.payload.size();
+  std::string    json;
+  // MessagePack só sai em portaria/<id>/mp/... (serializador.h)
+  if (msg.topico.find("/mp/") != std::string::npos) {
+    bool ok = msgpackParaJson(p, fim, json) && p == fim;
+    printf(">> [%s]%s (msgpack %u B) %s\n", msg.topico.c_str(), msg.retida ? " (retida)" : "",
+           (unsigned)msg.payload.size(), ok ? json.c_str() : "<invalido>");
+  } else {
+    printf(">> [%s]%s %s\n", msg.topico.c_str(), msg.retida ? " (retida)" : "", msg.payload.c_str());
+  }
+  fflush(stdout);
+}
+
+// Um passo do loop() do ESP32 seguido da TaskProcessaCartoes esvaziando a fila
+static void passo() {
+  processarProximoComando();
+  publicarTelemetriaPeriodica();
+  completarMovimentacoesSemHora();
+  salvarCheckpointPeriodico();
+  manterEstadoRetido();
+  atenderExportacaoHttp();
+  processarConsoleSerial();
+  verificarLeitorCartoes();
+  while (processarProximoCartao(0)) {}
+}
+
+static bool executarLinha(const std::string &linhaBruta) {
+  std::string linha = linhaBruta;
+  while (!linha.empty() && (linha.back() == '\r' || linha.back() == '\n' || linha.back() == ' ')) linha.pop_back();
+  size_t ini = linha.find_first_not_of(' ');
+  if (ini == std::string::npos || linha[ini] == '#') return true;
+  linha = linha.substr(ini);
+
+  size_t esp       = linha.find(' ');
+  std::string cmd  = linha.substr(0, esp);
+  std::string arg  = (esp == std::string::npos) ? "" : linha.substr(esp + 1);
+
+  if (cmd == "sair") return false;
+
+  if (cmd == "relogio") {
+    if (!relogioDefinirDataHora(arg.c_str())) fprintf(stderr, "relogio: data/hora invalida: %s\n", arg.c_str());
+  } else if (cmd == "avancar") {
+    relogioAvancarMs(strtoull(arg.c_str(), nullptr, 10));
+  } else if (cmd == "aproximar" || cmd == "cartao") {
+    if (!mfrc522.aproximar(arg.c_str())) {
+      fprintf(stderr, "%s: UID invalido: %s\n", cmd.c_str(), arg.c_str());
+    } else if (cmd == "cartao") {
+      passo();
+    }
+  } else if (cmd == "serial" || cmd == "digitar") {
+    Serial.injetar((cmd == "serial" ? arg + "\n" : arg).c_str());
+    passo();
+  } else if (cmd == "mqtt" || cmd == "mqtt_todas") {
+    mqttClient.injetar(cmd == "mqtt" ? MQTT_TOPIC_CMD : MQTT_TOPIC_CMD_TODAS, arg.c_str());
+    passo();
+  } else if (cmd == "mqtt_on" || cmd == "mqtt_off") {
+    mqttClient.definirConectado(cmd == "mqtt_on");
+    if (cmd == "mqtt_on") estadoRetidoConectado();   // como o conectarMQTT() do ESP32
+  } else if (cmd == "http") {
+    // o relógio virtual acompanha o real, para os prazos do servidor valerem
+    long fimMs = strtol(arg.c_str(), nullptr, 10) * 1000;
+    for (long ms = 0; ms < fimMs; ms += 5) {
+      passo();
+      if (!exportacaoHttpOcupada()) {
+        usleep(5000);
+        relogioAvancarMs(5);
+      }
+    }
+  } else {
+    fprintf(stderr, "comando desconhecido: %s\n", cmd.c_str());
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *roteiro = nullptr;
+  const char *dirFs   = nullptr;
+  const char *dirSpiffs = nullptr;
+  bool silencioso     = false;
+  bool limpar         = false;
+  uint16_t portaHttp  = 0;
+  int flashAbrirUs    = 0;
+  int flashKbUs       = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0)                     silencioso = true;
+    else if (strcmp(argv[i], "--limpar") == 0)          limpar = true;
+    else if (strcmp(argv[i], "--fs") == 0 && i + 1 < argc) dirFs = argv[++i];
+    else if (strcmp(argv[i], "--fs-spiffs") == 0 && i + 1 < argc) dirSpiffs = argv[++i];
+    else if (strcmp(argv[i], "--id") == 0 && i + 1 < argc) PORTARIA_ID = argv[++i];
+    else if (strcmp(argv[i], "--http") == 0 && i + 1 < argc) portaHttp = (uint16_t)atoi(argv[++i]);
+    else if (strcmp(argv[i], "--flash-abrir-us") == 0 && i + 1 < argc) flashAbrirUs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--flash-kb-us") == 0 && i + 1 < argc) flashKbUs = atoi(argv[++i]);
+    else                                                roteiro = argv[i];
+  }
+
+  FILE *entrada = roteiro ? fopen(roteiro, "r") : stdin;
+  if (!entrada) {
+    fprintf(stderr, "nao foi possivel abrir %s\n", roteiro);
+    return 1;
+  }
+
+  std::string imagemCadastro = dirFs ? std::string(dirFs) + "-cadastro.img" : "";
+  if (dirFs) {
+    backendArquivos.fs.definirRaiz(dirFs);
+    particaoDefinirArquivo(IMAGEM_PARTICAO, imagemCadastro.c_str());
+  }
+#ifndef PORTARIA_FS_SPIFFS
+  std::string spiffsPadrao = dirFs ? std::string(dirFs) + "-spiffs" : "";
+  if (dirSpiffs)  SPIFFS.definirRaiz(dirSpiffs);
+  else if (dirFs) SPIFFS.definirRaiz(spiffsPadrao.c_str());
+#else
+  (void)dirSpiffs;   // o próprio backend é o SPIFFS: nada a migrar
+#endif
+  Serial.silenciar(silencioso);
+  if (limpar) {
+    backendArquivos.montar(true);
+    backendArquivos.formatar();
+#ifndef PORTARIA_FS_SPIFFS
+    if (SPIFFS.begin(false)) SPIFFS.format();   // a partição antiga também
+#endif
+  }
+
+  backendArquivos.fs.definirCustoFlash((uint32_t)flashAbrirUs, (uint32_t)flashKbUs);
+
+  mqttClient.observar(imprimirPublicacao);
+  mqttClient.setCallback(mqttCallback);
+
+  inicializarPortaria();
+  if (mqttClient.connected()) estadoRetidoConectado();
+  if (portaHttp) iniciarExportacaoHttp(portaHttp);
+  marcarBoot(BOOT_PRONTO);
+  if (!silencioso) mostrarAjudaComandos();
+
+  char buf[1024];
+  while (fgets(buf, sizeof(buf), entrada)) {
+    if (!executarLinha(buf)) break;
+  }
+
+  if (entrada != stdin) fclose(entrada);
+  return 0;
+}
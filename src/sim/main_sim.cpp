@@ -0,0 +1,316 @@
+// Simulador determinístico de um dia de portaria (env:sim).
+//
+//   pio run -e sim && .pio/build/sim/program [opções] [roteiro.txt] > resultado.jsonl
+//
+// Alimenta toques de cartão no mesmo caminho do ESP32 (verificarLeitorCartoes
+// -> filaCartoes -> processarProximoCartao) sob tempo virtual. Os delay() dos
+// LEDs, a latência de cada publish MQTT e o acesso à flash avançam o relógio, e os toques que
+// chegam enquanto a TaskProcessaCartoes está ocupada entram na fila (ou são
+// descartados se ela estiver cheia), como no aparelho.
+//
+// Sem roteiro, gera um pico de chegada (07:30-08:15) com rajadas, irmãos
+// (dois cartões de usuário seguidos), ordem errada (funcionário primeiro),
+// leituras repetidas e cartões não cadastrados. Roteiro: uma linha por toque,
+//   <ms desde o início> <uid>
+//
+// Opções:
+//   --familias N        famílias no pico gerado (padrão 150)
+//   --semente N         semente do gerador (padrão 1)
+//   --fila N            profundidade da filaCartoes (padrão FILA_CARTOES_TAM)
+//   --escala-led F      multiplica os delay() do firmware (padrão 1.0)
+//   --mqtt-ms N         latência de cada publish em ms (padrão 20)
+//   --flash-abrir-us N  custo de cada open() no sistema de arquivos em µs (padrão 1500)
+//   --flash-kb-us N     custo por KB lido/gravado em µs (padrão 150)
+//   --rearmar-ms N      tempo até o operador reabrir a leitura (start_entrada) após
+//                       cada par; -1 = nunca reabre (padrão 300)
+//   --fs dir
+//
+// Com SIM_SERIAL=1 no ambiente, a Serial do firmware sai no stdout junto.
+//
+// Saída (stdout, uma linha JSON cada):
+//   {"tipo":"minuto", ...}   toques, registros, descartes e fila máxima por minuto
+//   {"tipo":"resumo", ...}   totais e latência toque->registro (p50/p99/máx)
+#include <Arduino.h>
+#include <MFRC522v2.h>
+#include <PubSubClient.h>
+#include <SPIFFS.h>
+#include <esp_partition.h>
+
+#include <relogio_fake.h>
+#include <portaria.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+MFRC522      mfrc522;
+PubSubClient mqttClient;
+
+struct Toque {
+  uint64_t    us;     // desde o início da simulação
+  std::string uid;
+};
+
+struct Minuto {
+  uint32_t toques    = 0;
+  uint32_t registros = 0;
+  uint32_t descartes = 0;
+  uint32_t ignorados = 0;   // leitura desabilitada (esperando o operador)
+  uint32_t filaMax   = 0;
+};
+
+static uint64_t inicioUs = 0;
+static std::map<uint32_t, Minuto> minutos;
+static std::vector<double> latenciasMs;
+static uint64_t chegadaEmProcessamento = 0;
+static uint32_t totalRegistros = 0;
+
+static Minuto &minutoAtual(uint64_t us) {
+  return minutos[(uint32_t)((us - inicioUs) / 60000000ULL)];
+}
+
+// Cada movimentação publicada marca o fim do par: latência desde o toque que o completou
+static void aoPublicar(const MensagemMqtt &msg) {
+  if (msg.topico != MQTT_TOPIC_MOV) return;
+  uint64_t agora = relogioAgoraUs();
+  latenciasMs.push_back((agora - chegadaEmProcessamento) / 1000.0);
+  minutoAtual(agora).registros++;
+  totalRegistros++;
+}
+
+// ---------------- Geração do pico ----------------
+
+static uint32_t semente = 1;
+static uint32_t aleatorio() {
+  semente ^= semente << 13;
+  semente ^= semente >> 17;
+  semente ^= semente << 5;
+  return semente;
+}
+
+static uint32_t entre(uint32_t a, uint32_t b) { return a + aleatorio() % (b - a + 1); }
+static bool     chance(uint32_t porcento) { return aleatorio() % 100 < porcento; }
+
+static std::string uidDe(char prefixo, uint32_t i) {
+  char buf[UID_MAX_LEN + 1];
+  snprintf(buf, sizeof(buf), "%c%07x", prefixo, (unsigned)i);
+  return buf;
+}
+
+// Chegadas em rajadas; no leitor as famílias passam uma de cada vez (fila física),
+// então cada uma começa depois que a anterior terminou de encostar os cartões.
+static void gerarPico(int familias, int funcionarios, std::vector<Toque> &toques) {
+  const uint64_t janelaMs = 45ULL * 60 * 1000;   // 07:30 -> 08:15
+  uint64_t chegada = 0;
+  uint64_t livre   = 0;                           // leitor livre a partir de
+  for (int f = 0; f < familias; f++) {
+    // metade das chegadas vem em grupos quase colados
+    chegada += chance(50) ? entre(200, 2000) : entre(5000, (uint32_t)(2 * janelaMs / familias));
+    if (chegada > janelaMs) chegada = janelaMs;
+
+    std::string usuario     = chance(4) ? uidDe('b', aleatorio()) : uidDe('a', f);   // 4% não cadastrados
+    std::string funcionario = uidDe('e', (uint32_t)entre(0, funcionarios - 1));
+    uint64_t    tt          = std::max(chegada, livre + entre(300, 1200));
+
+    if (chance(5)) {                        // ordem errada: funcionário encosta antes
+      toques.push_back({ tt * 1000, funcionario });
+      tt += entre(800, 2000);
+    }
+    toques.push_back({ tt * 1000, usuario });
+    if (chance(10)) toques.push_back({ (tt + entre(80, 250)) * 1000, usuario });   // leitura repetida
+    if (chance(15)) {                       // irmão: segundo cartão de usuário em seguida
+      tt += entre(700, 1500);
+      toques.push_back({ tt * 1000, uidDe('a', familias + f) });
+    }
+    tt += entre(1500, 4000);
+    toques.push_back({ tt * 1000, funcionario });
+    livre = tt;
+  }
+  std::stable_sort(toques.begin(), toques.end(),
+                   [](const Toque &a, const Toque &b) { return a.us < b.us; });
+}
+
+static void gerarCadastros(int familias, int funcionarios) {
+  File u = abrirArquivo(CARDS_FILE, FILE_WRITE);
+  for (int i = 0; i < 2 * familias; i++) { u.print(uidDe('a', i).c_str()); u.print("\n"); }
+  u.close();
+  File a = abrirArquivo(ADMINS_FILE, FILE_WRITE);
+  for (int i = 0; i < funcionarios; i++) { a.print(uidDe('e', i).c_str()); a.print("\n"); }
+  a.close();
+}
+
+static bool lerRoteiro(const char *arquivo, std::vector<Toque> &toques) {
+  FILE *f = fopen(arquivo, "r");
+  if (!f) return false;
+  char linha[128];
+  while (fgets(linha, sizeof(linha), f)) {
+    unsigned long long ms;
+    char uid[UID_MAX_LEN + 1];
+    if (linha[0] == '#') continue;
+    if (sscanf(linha, "%llu %20s", &ms, uid) == 2) toques.push_back({ ms * 1000, uid });
+  }
+  fclose(f);
+  std::stable_sort(toques.begin(), toques.end(),
+                   [](const Toque &a, const Toque &b) { return a.us < b.us; });
+  return true;
+}
+
+// ---------------- Simulação ----------------
+
+static std::deque<uint64_t> chegadasNaFila;   // espelha a filaCartoes (FIFO)
+static uint32_t totalDescartes = 0;
+static uint32_t totalIgnorados = 0;
+
+// Toque que chegou em 'us'. 'leituraAtiva' é o estado da leitura naquele instante.
+static void admitirToque(const Toque &t, bool leituraAtiva) {
+  uint64_t us = inicioUs + t.us;
+  Minuto &m   = minutoAtual(us);
+  m.toques++;
+
+  if (!leituraAtiva) {
+    m.ignorados++;
+    totalIgnorados++;
+    return;
+  }
+
+  bool leituraAgora = leituraHabilitada;
+  leituraHabilitada = true;
+  UBaseType_t antes = uxQueueMessagesWaiting(filaCartoes);
+  mfrc522.aproximar(t.uid.c_str());
+  verificarLeitorCartoes();
+  leituraHabilitada = leituraAgora;
+
+  if (uxQueueMessagesWaiting(filaCartoes) > antes) {
+    chegadasNaFila.push_back(us);
+  } else {
+    m.descartes++;
+    totalDescartes++;
+  }
+  uint32_t prof = (uint32_t)uxQueueMessagesWaiting(filaCartoes);
+  if (prof > m.filaMax) m.filaMax = prof;
+}
+
+static double percentil(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p * (v.size() - 1) + 0.5)];
+}
+
+int main(int argc, char **argv) {
+  int familias      = 150;
+  int funcionarios  = 4;
+  int fila          = FILA_CARTOES_TAM;
+  double escalaLed  = 1.0;
+  int mqttMs        = 20;
+  int flashAbrirUs  = 1500;
+  int flashKbUs     = 150;
+  long rearmarMs    = 300;
+  const char *dirFs = "fs_nativo/sim";
+  const char *roteiro = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    bool temValor = i + 1 < argc;
+    if      (!strcmp(argv[i], "--familias")        && temValor) familias     = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--semente")         && temValor) semente      = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--fila")            && temValor) fila         = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--escala-led")      && temValor) escalaLed    = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--mqtt-ms")         && temValor) mqttMs       = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--flash-abrir-us")  && temValor) flashAbrirUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--flash-kb-us")     && temValor) flashKbUs    = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--rearmar-ms")      && temValor) rearmarMs    = atol(argv[++i]);
+    else if (!strcmp(argv[i], "--fs")              && temValor) dirFs        = argv[++i];
+    else roteiro = argv[i];
+  }
+  if (semente == 0) semente = 1;
+
+  backendArquivos.fs.definirRaiz(dirFs);
+  particaoDefinirArquivo(IMAGEM_PARTICAO, (std::string(dirFs) + "-cadastro.img").c_str());
+#ifndef PORTARIA_FS_SPIFFS
+  SPIFFS.definirRaiz((std::string(dirFs) + "-spiffs").c_str());   // sem partição antiga: nada a migrar
+#endif
+  Serial.silenciar(getenv("SIM_SERIAL") == nullptr);
+  backendArquivos.montar(true);
+  backendArquivos.formatar();
+
+  gerarCadastros(familias, funcionarios);
+  std::vector<Toque> toques;
+  if (roteiro) {
+    if (!lerRoteiro(roteiro, toques)) {
+      fprintf(stderr, "nao foi possivel abrir %s\n", roteiro);
+      return 1;
+    }
+  } else {
+    gerarPico(familias, funcionarios, toques);
+  }
+
+  relogioDefinirDataHora("13/10/2025 07:30:00");
+  relogioEscalaDelay(escalaLed);
+  backendArquivos.fs.definirCustoFlash((uint32_t)flashAbrirUs, (uint32_t)flashKbUs);
+  inicializarPortaria();
+  vQueueDelete(filaCartoes);
+  filaCartoes = xQueueCreate(fila, sizeof(EventoCartao));
+
+  mqttClient.definirLatenciaUs((uint32_t)mqttMs * 1000);
+  mqttClient.observar(aoPublicar);
+  mqttClient.setCallback(mqttCallback);
+  mqttClient.injetar(MQTT_TOPIC_CMD, "{\"cmd\":\"start_entrada\"}");
+  inicioUs = relogioAgoraUs();
+
+  size_t   prox       = 0;
+  uint64_t rearmarEm  = 0;     // 0 = nenhum rearme pendente
+
+  while (prox < toques.size() || uxQueueMessagesWaiting(filaCartoes) > 0) {
+    if (uxQueueMessagesWaiting(filaCartoes) > 0) {
+      // TaskProcessaCartoes ocupada do início ao fim do processamento
+      bool leituraNoInicio   = leituraHabilitada;
+      chegadaEmProcessamento = chegadasNaFila.front();
+      chegadasNaFila.pop_front();
+      processarProximoCartao(0);
+
+      // o loop() continuou lendo cartões nesse meio tempo
+      while (prox < toques.size() && inicioUs + toques[prox].us <= relogioAgoraUs()) {
+        admitirToque(toques[prox++], leituraNoInicio);
+      }
+      if (!leituraHabilitada && rearmarMs >= 0 && rearmarEm == 0) {
+        rearmarEm = relogioAgoraUs() + (uint64_t)rearmarMs * 1000;
+      }
+      continue;
+    }
+
+    if (prox >= toques.size()) break;
+    uint64_t proxToque = inicioUs + toques[prox].us;
+
+    if (rearmarEm && rearmarEm <= proxToque) {
+      if (rearmarEm > relogioAgoraUs()) relogioAvancarUs(rearmarEm - relogioAgoraUs());
+      rearmarEm = 0;
+      mqttClient.injetar(MQTT_TOPIC_CMD, "{\"cmd\":\"start_entrada\"}");
+      continue;
+    }
+
+    if (proxToque > relogioAgoraUs()) relogioAvancarUs(proxToque - relogioAgoraUs());
+    admitirToque(toques[prox++], leituraHabilitada);
+  }
+
+  uint64_t duracaoUs = relogioAgoraUs() - inicioUs;
+  for (const auto &par : minutos) {
+    const Minuto &m = par.second;
+    printf("{\"tipo\":\"minuto\",\"minuto\":%u,\"toques\":%u,\"registros\":%u,"
+           "\"descartes\":%u,\"ignorados\":%u,\"fila_max\":%u}\n",
+           par.first, m.toques, m.registros, m.descartes, m.ignorados, m.filaMax);
+  }
+
+  double minutosTotais = duracaoUs / 60e6;
+  printf("{\"tipo\":\"resumo\",\"toques\":%zu,\"registros\":%u,\"descartes\":%u,\"ignorados\":%u,"
+         "\"fila\":%d,\"escala_led\":%.2f,\"mqtt_ms\":%d,\"flash_abrir_us\":%d,\"flash_kb_us\":%d,\"rearmar_ms\":%ld,\"duracao_min\":%.2f,"
+         "\"registros_por_min\":%.2f,\"latencia_p50_ms\":%.1f,\"latencia_p99_ms\":%.1f,"
+         "\"latencia_max_ms\":%.1f}\n",
+         toques.size(), totalRegistros, totalDescartes, totalIgnorados,
+         fila, escalaLed, mqttMs, flashAbrirUs, flashKbUs, rearmarMs, minutosTotais,
+         minutosTotais > 0 ? totalRegistros / minutosTotais : 0.0,
+         percentil(latenciasMs, 0.50), percentil(latenciasMs, 0.99),
+         latenciasMs.empty() ? 0.0 : *std::max_element(latenciasMs.begin(), latenciasMs.end()));
+  return 0;
+}
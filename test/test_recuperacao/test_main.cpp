@@ -0,0 +1,188 @@
+// Recuperação do log e do checkpoint no boot, no PC (env:native):
+//
+//   pio test -e native
+//
+// Cada "boot" é um inicializarPortaria() sobre o mesmo diretório de arquivos,
+// como depois de um reset: o log e o /estado.ckp são mexidos por fora entre
+// um boot e outro, do jeito que um corte de energia os deixaria.
+#include <Arduino.h>
+#include <MFRC522v2.h>
+#include <PubSubClient.h>
+#include <SPIFFS.h>
+#include <esp_partition.h>
+
+#include <relogio_fake.h>
+#include <portaria.h>
+
+#include <unity.h>
+
+#include <string>
+
+MFRC522      mfrc522;
+PubSubClient mqttClient;
+
+static const char *DIR_FS = "fs_nativo/teste_recuperacao";
+
+static const char *FUNC   = "e1000000";
+static const char *USER_A = "a1000000";   // atrasado (08:40)
+static const char *USER_B = "a2000000";   // no horário, já saiu
+static const char *USER_C = "a3000000";   // entrou duas vezes, está dentro
+
+static void gravarArquivo(const char *path, const char *conteudo) {
+  File f = abrirArquivo(path, FILE_WRITE);
+  TEST_ASSERT_TRUE(f);
+  f.print(conteudo);
+  f.close();
+}
+
+static void registrar(const char *uid, bool entrada, const char *hora, const char *data) {
+  String corpo = String("-") + FUNC + "- " + (entrada ? "recebeu" : "liberou") + " -" + uid +
+                 "- às -" + hora + "- do dia -" + data + "-";
+  TEST_ASSERT_TRUE(appendRegistro(MOVIMENTACOES_FILE, corpo));
+}
+
+static size_t tamanhoLog() {
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_READ);
+  size_t n = f ? f.size() : 0;
+  if (f) f.close();
+  return n;
+}
+
+static void reiniciar() {
+  TEST_ASSERT_TRUE(inicializarPortaria());
+}
+
+// Dentro, atrasos e a semana de cada UID numa string só, para comparar dois boots
+static std::string retratoEstado() {
+  std::string r = "dentro:";
+  ContagemDentro *dentro;
+  int numDentro = 0;
+  size_t pendencias = 0;
+  TEST_ASSERT_TRUE(coletarUsuariosDentroHoje(dentro, numDentro, pendencias));
+  for (int i = 0; i < numDentro; i++) {
+    r += std::string(" ") + dentro[i].uid + "=" + std::to_string(dentro[i].count);
+  }
+  free(dentro);
+
+  r += " atrasos:";
+  PrimeiraEntrada *atrasos;
+  String hoje;
+  size_t numAtrasos = coletarAtrasosHoje(atrasos, hoje);
+  for (size_t i = 0; i < numAtrasos; i++) {
+    r += std::string(" ") + atrasos[i].uid + "@" + horaStrFromSegundos(atrasos[i].segundos).c_str();
+  }
+  free(atrasos);
+
+  const char *uids[] = { USER_A, USER_B, USER_C };
+  for (const char *uid : uids) {
+    for (int semanasAtras = 0; semanasAtras < 2; semanasAtras++) {
+      bool dias[7];
+      String normalizado;
+      computeDiasSemanaPorUid(String(uid), dias, normalizado, semanasAtras);
+      r += std::string(" ") + uid + "/" + std::to_string(semanasAtras) + ":";
+      for (int d = 0; d < 7; d++) r += dias[d] ? '1' : '0';
+    }
+  }
+  return r;
+}
+
+void setUp() {
+  backendArquivos.fs.definirRaiz(DIR_FS);
+  particaoDefinirArquivo(IMAGEM_PARTICAO, "fs_nativo/teste_recuperacao-cadastro.img");
+  Serial.silenciar(true);
+  backendArquivos.montar(true);
+  backendArquivos.formatar();
+#ifndef PORTARIA_FS_SPIFFS
+  // a partição antiga vazia: nada do fs_nativo/spiffs migra para o teste
+  SPIFFS.definirRaiz("fs_nativo/teste_recuperacao-spiffs");
+  if (SPIFFS.begin(true)) SPIFFS.format();
+#endif
+  relogioDefinirDataHora("14/10/2025 09:00:00");
+
+  gravarArquivo(CARDS_FILE, "a1000000\na2000000\na3000000\n");
+  gravarArquivo(ADMINS_FILE, "e1000000\n");
+}
+
+void tearDown() {}
+
+// Reset no meio de um append: o registro cortado é descartado e marcado com
+// '#', os inteiros continuam valendo, e o boot seguinte não o conta de novo
+static void test_registro_cortado_no_boot() {
+  registrar(USER_A, true, "08:40:00", "14/10/2025");
+  registrar(USER_B, true, "07:50:00", "14/10/2025");
+  registrar(USER_C, true, "07:55:00", "14/10/2025");
+
+  size_t inicioCortado = tamanhoLog();
+  File f = abrirArquivo(MOVIMENTACOES_FILE, FILE_APPEND);
+  TEST_ASSERT_TRUE(f);
+  f.print("-e1000000- liberou -a2000000- às -08:5");   // sem moldura nem '\n'
+  f.close();
+
+  reiniciar();
+  TEST_ASSERT_EQUAL_UINT32(3, registrosRecuperados());
+  TEST_ASSERT_EQUAL_UINT32(1, registrosDescartados());
+
+  char marca = 0;
+  TEST_ASSERT_EQUAL(1, lerTrechoArquivo(MOVIMENTACOES_FILE, inicioCortado, &marca, 1));
+  TEST_ASSERT_EQUAL_CHAR('#', marca);
+  char fim = 0;
+  TEST_ASSERT_EQUAL(1, lerTrechoArquivo(MOVIMENTACOES_FILE, tamanhoLog() - 1, &fim, 1));
+  TEST_ASSERT_EQUAL_CHAR('\n', fim);
+
+  // a saída cortada não conta: B continua dentro
+  TEST_ASSERT_EQUAL(1, contagemDentro(USER_B, diaNumFromStr("14/10/2025")));
+
+  reiniciar();
+  TEST_ASSERT_EQUAL_UINT32(0, registrosDescartados());
+
+  // o próximo registro começa numa linha nova
+  registrar(USER_B, false, "08:50:00", "14/10/2025");
+  reiniciar();
+  TEST_ASSERT_EQUAL_UINT32(0, registrosDescartados());
+}
+
+// /estado.ckp corrompido: o boot volta a reaplicar o log e chega no mesmo
+// dentro/presença/atrasos que o checkpoint tinha
+static void test_checkpoint_corrompido_refaz_do_log() {
+  registrar(USER_A, true,  "08:00:00", "07/10/2025");   // semana anterior
+  registrar(USER_A, false, "12:00:00", "07/10/2025");
+  registrar(USER_C, true,  "07:40:00", "13/10/2025");
+  registrar(USER_C, false, "12:00:00", "13/10/2025");
+  registrar(USER_A, true,  "08:40:00", "14/10/2025");
+  registrar(USER_B, true,  "07:50:00", "14/10/2025");
+  registrar(USER_B, false, "08:30:00", "14/10/2025");
+  registrar(USER_C, true,  "07:55:00", "14/10/2025");
+  registrar(USER_C, true,  "08:05:00", "14/10/2025");
+
+  reiniciar();                          // monta do log e grava o checkpoint
+  TEST_ASSERT_NOT_EQUAL(SIZE_MAX, offsetCheckpoint());
+  reiniciar();                          // agora carregado do checkpoint
+  std::string doCheckpoint = retratoEstado();
+  TEST_ASSERT_TRUE(doCheckpoint.find(std::string(USER_C) + "=2") != std::string::npos);
+  TEST_ASSERT_TRUE(doCheckpoint.find(std::string(USER_A) + "@08:40:00") != std::string::npos);
+
+  File ckp = abrirArquivo(CHECKPOINT_FILE, "r+");
+  TEST_ASSERT_TRUE(ckp);
+  size_t meio = ckp.size() / 2;
+  uint8_t b = 0;
+  TEST_ASSERT_TRUE(ckp.seek(meio));
+  TEST_ASSERT_EQUAL(1, ckp.read(&b, 1));
+  b ^= 0xFF;
+  TEST_ASSERT_TRUE(ckp.seek(meio));
+  TEST_ASSERT_EQUAL(1, ckp.write(&b, 1));
+  ckp.close();
+
+  reiniciar();
+  TEST_ASSERT_EQUAL_STRING(doCheckpoint.c_str(), retratoEstado().c_str());
+
+  // e o checkpoint regravado volta a valer
+  reiniciar();
+  TEST_ASSERT_EQUAL_STRING(doCheckpoint.c_str(), retratoEstado().c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_registro_cortado_no_boot);
+  RUN_TEST(test_checkpoint_corrompido_refaz_do_log);
+  return UNITY_END();
+}